@@ -0,0 +1,89 @@
+// Lexer throughput benchmark.
+// Generates a large Lox source and reports lexing speed in MB/s for every
+// scanning implementation the CPU supports.
+//
+// Usage: lexer_bench [megabytes=32] [repetitions=5]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "error.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
+
+namespace {
+std::string generate_source(size_t megabytes) {
+  const size_t target = megabytes * 1024 * 1024;
+  std::string source;
+  source.reserve(target + 1024);
+
+  for (size_t i = 0; source.size() < target; ++i) {
+    const auto n = std::to_string(i);
+    source += "// Helper number " + n + " computes something useful\n";
+    source += "fn computeSomethingUseful" + n + "(firstArgument, second) {\n";
+    source += "    let accumulatedValue = firstArgument * " + n + ".25;\n";
+    source += "    /* Block comment spanning\n       multiple lines */\n";
+    source += "    if (accumulatedValue >= 1234567 and second != nil) {\n";
+    source += "        print(\"A fairly long string literal number " + n +
+              " that needs scanning\");\n";
+    source += "    }\n";
+    source += "    return accumulatedValue + second;\n";
+    source += "}\n\n";
+  }
+  return source;
+}
+
+double lex_seconds(const std::string &source,
+                   const std::shared_ptr<ErrorHandler> &err_handler) {
+  Lexer lexer{source, err_handler};
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto tokens = lexer.lex();
+  const auto end = std::chrono::steady_clock::now();
+
+  if (tokens.size() < 2 || err_handler->has_error()) {
+    std::cerr << "Lexing the generated source failed\n";
+    std::exit(1);
+  }
+  return std::chrono::duration<double>(end - start).count();
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const int megabytes = argc > 1 ? std::atoi(argv[1]) : 32;
+  const int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+  if (argc > 3 || megabytes <= 0 || repetitions <= 0) {
+    std::cerr << "Usage: lexer_bench [megabytes=32] [repetitions=5]\n";
+    return 64;
+  }
+
+  const auto source = generate_source(static_cast<size_t>(megabytes));
+  const double size_mb = static_cast<double>(source.size()) / (1024 * 1024);
+  auto err_handler = std::make_shared<CerrHandler>();
+
+  std::cout << "Lexing " << std::fixed << std::setprecision(1) << size_mb
+            << " MB, best of " << repetitions << " runs\n";
+
+  using Scan::Implementation;
+  for (auto implementation :
+       {Implementation::SCALAR, Implementation::SSE2, Implementation::AVX2}) {
+    Scan::set_implementation(implementation);
+    if (Scan::active_implementation() != implementation) {
+      continue; // Not supported on this CPU or compiler
+    }
+
+    std::vector<double> seconds;
+    for (int i = 0; i < repetitions; ++i) {
+      seconds.push_back(lex_seconds(source, err_handler));
+    }
+    const double best = *std::min_element(seconds.begin(), seconds.end());
+
+    std::cout << std::setw(8) << Scan::to_string(implementation) << ": "
+              << std::setw(8) << size_mb / best << " MB/s\n";
+  }
+  return 0;
+}
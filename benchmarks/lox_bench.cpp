@@ -0,0 +1,298 @@
+// Interpreter benchmark suite.
+// Runs every workload of a directory of Lox scripts, by default
+// benchmarks/workloads, and prints the median and p95 wall time, the peak RSS
+// and the number of allocations of each as JSON.
+// Each workload runs in a fresh process, which lox_bench spawns from its own
+// executable: first the warmup runs, then the measured runs, each in a new
+// Isolate. So the measured runs see warm caches and a warm allocator, but no
+// globals of earlier runs. Wall time covers compiling and running the script,
+// and allocations count operator new. The peak RSS is the highest of the
+// measured runs, read from the spawned process, so it includes the
+// interpreter's own footprint but nothing of lox_bench. On Linux the peak is
+// reset before each run, and the growth of the peak over the RSS at the start
+// of the run is reported too, as memory an earlier run leaked stays resident.
+// Elsewhere the peak is that of the whole process.
+//
+// Usage: lox_bench [--runs=N] [--warmup=N] [--filter=text] [directory]
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "isolate.hpp"
+
+extern char **environ;
+
+namespace {
+std::atomic<uint64_t> allocations = 0;
+
+/// Written by the spawned process to its stdout for every measured run
+struct Measurement {
+  uint64_t nanoseconds = 0;
+  uint64_t allocations = 0;
+  /// Both 0 if they can't be read
+  uint64_t start_rss_kb = 0;
+  uint64_t peak_rss_kb = 0;
+};
+
+/// Reset the peak RSS of this process to its current RSS. False if the
+/// kernel doesn't support it
+bool reset_peak_rss() {
+  std::ofstream clear_refs{"/proc/self/clear_refs"};
+  return static_cast<bool>(clear_refs << "5" << std::flush);
+}
+
+/// Field of /proc/self/status in kB, like "VmHWM" for the peak RSS since the
+/// last reset, or 0 if unknown
+uint64_t status_kb(std::string_view field) {
+  std::ifstream status{"/proc/self/status"};
+  for (std::string line; std::getline(status, line);) {
+    if (line.starts_with(field) && line.size() > field.size() &&
+        line[field.size()] == ':') {
+      return std::strtoull(line.c_str() + line.find(':') + 1, nullptr, 10);
+    }
+  }
+  return 0;
+}
+
+struct Result {
+  std::vector<double> milliseconds;
+  long peak_rss_kb = 0;
+  /// Empty if unknown
+  std::optional<uint64_t> peak_rss_growth_kb;
+  uint64_t allocations = 0;
+};
+
+/// Body of the spawned process: run the script warmup + runs times, and
+/// report the measured runs on stdout
+int run_spawned(const std::filesystem::path &script, int warmup, int runs) {
+  for (int i = 0; i < warmup + runs; ++i) {
+    std::ostream null_out{nullptr};
+    // Like Lox, which only logs errors. Those go to stderr, as stdout carries
+    // the measurements
+    Isolate isolate{Isolate::Options{
+        .out = &null_out,
+        .logging = {Logging::LogLevel::ERROR, &std::cerr}}};
+
+    const bool peak_reset = reset_peak_rss();
+    const auto start_rss_kb = peak_reset ? status_kb("VmRSS") : 0;
+    allocations = 0;
+    const auto start = std::chrono::steady_clock::now();
+    const bool succeeded = isolate.run_file(script);
+    const auto end = std::chrono::steady_clock::now();
+    if (!succeeded) {
+      return 1;
+    }
+
+    if (i >= warmup) {
+      const Measurement measurement{
+          static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count()),
+          allocations.load(), start_rss_kb,
+          peak_reset ? status_kb("VmHWM") : 0};
+      if (write(STDOUT_FILENO, &measurement, sizeof(measurement)) !=
+          static_cast<ssize_t>(sizeof(measurement))) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/// Run the script in a process spawned from executable. Empty if it failed
+std::optional<Result> run_workload(const char *executable,
+                                   const std::filesystem::path &script,
+                                   int warmup, int runs) {
+  int pipes[2];
+  if (pipe(pipes) != 0) {
+    return std::nullopt;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipes[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, pipes[0]);
+  posix_spawn_file_actions_addclose(&actions, pipes[1]);
+
+  const std::string workload = "--workload=" + script.string();
+  const std::string warmup_arg = "--warmup=" + std::to_string(warmup);
+  const std::string runs_arg = "--runs=" + std::to_string(runs);
+  std::vector<char *> arguments{
+      const_cast<char *>(executable), const_cast<char *>(workload.c_str()),
+      const_cast<char *>(warmup_arg.c_str()),
+      const_cast<char *>(runs_arg.c_str()), nullptr};
+
+  pid_t child = 0;
+  const int spawned = posix_spawnp(&child, executable, &actions, nullptr,
+                                   arguments.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipes[1]);
+  if (spawned != 0) {
+    close(pipes[0]);
+    return std::nullopt;
+  }
+
+  std::string received;
+  char chunk[4096];
+  for (ssize_t count; (count = read(pipes[0], chunk, sizeof(chunk))) != 0;) {
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      break;
+    }
+    received.append(chunk, static_cast<size_t>(count));
+  }
+  close(pipes[0]);
+
+  int status = 0;
+  rusage usage{};
+  if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0 ||
+      received.size() != runs * sizeof(Measurement)) {
+    return std::nullopt;
+  }
+
+  Result result;
+  result.peak_rss_kb = usage.ru_maxrss;
+  long per_run_peak = 0;
+  for (size_t i = 0; i < received.size(); i += sizeof(Measurement)) {
+    Measurement measurement;
+    std::copy_n(received.data() + i, sizeof(measurement),
+                reinterpret_cast<char *>(&measurement));
+    result.milliseconds.push_back(
+        static_cast<double>(measurement.nanoseconds) / 1e6);
+    result.allocations = measurement.allocations;
+    if (measurement.start_rss_kb > 0 && measurement.peak_rss_kb > 0) {
+      per_run_peak = std::max(per_run_peak,
+                              static_cast<long>(measurement.peak_rss_kb));
+      result.peak_rss_growth_kb =
+          std::max(result.peak_rss_growth_kb.value_or(0),
+                   measurement.peak_rss_kb -
+                       std::min(measurement.start_rss_kb,
+                                measurement.peak_rss_kb));
+    }
+  }
+  if (per_run_peak > 0) {
+    result.peak_rss_kb = per_run_peak;
+  }
+  return result;
+}
+
+/// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double percent) {
+  const auto rank =
+      static_cast<size_t>(std::ceil(percent / 100 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+} // namespace
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+int main(int argc, char *argv[]) {
+  int runs = 10;
+  int warmup = 2;
+  std::string_view filter;
+  std::filesystem::path directory = LOX_BENCH_DIR;
+  // Given to the spawned processes only
+  std::optional<std::filesystem::path> workload;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg.starts_with("--runs=")) {
+      runs = std::atoi(argv[i] + arg.find('=') + 1);
+    } else if (arg.starts_with("--warmup=")) {
+      warmup = std::atoi(argv[i] + arg.find('=') + 1);
+    } else if (arg.starts_with("--filter=")) {
+      filter = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--workload=")) {
+      workload = arg.substr(arg.find('=') + 1);
+    } else if (!arg.starts_with("--")) {
+      directory = arg;
+    } else {
+      runs = 0;
+    }
+  }
+  if (runs <= 0 || warmup < 0) {
+    std::cerr << "Usage: lox_bench [--runs=N] [--warmup=N] [--filter=text] "
+                 "[directory]\n";
+    return 64;
+  }
+  if (workload.has_value()) {
+    return run_spawned(*workload, warmup, runs);
+  }
+
+  std::vector<std::filesystem::path> scripts;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator{directory, error}) {
+    const auto name = entry.path().stem().string();
+    if (entry.path().extension() == ".lox" &&
+        name.find(filter) != std::string::npos) {
+      scripts.push_back(entry.path());
+    }
+  }
+  if (error || scripts.empty()) {
+    std::cerr << "No workloads in " << directory << '\n';
+    return 1;
+  }
+  std::sort(scripts.begin(), scripts.end());
+
+  bool failed = false;
+  std::cout << "{\n  \"runs\": " << runs << ",\n  \"warmup\": " << warmup
+            << ",\n  \"benchmarks\": [";
+  for (size_t i = 0; i < scripts.size(); ++i) {
+    const auto name = scripts[i].stem().string();
+    std::cerr << "Running " << name << '\n';
+
+    auto result = run_workload(argv[0], scripts[i], warmup, runs);
+    std::cout << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << name
+              << '"';
+    if (!result.has_value()) {
+      std::cerr << name << " failed\n";
+      std::cout << ", \"error\": \"failed\"}";
+      failed = true;
+      continue;
+    }
+    auto &milliseconds = result->milliseconds;
+    std::sort(milliseconds.begin(), milliseconds.end());
+    std::cout << std::fixed << std::setprecision(3)
+              << ", \"median_ms\": " << percentile(milliseconds, 50)
+              << ", \"p95_ms\": " << percentile(milliseconds, 95)
+              << ", \"min_ms\": " << milliseconds.front()
+              << ", \"peak_rss_kb\": " << result->peak_rss_kb;
+    if (result->peak_rss_growth_kb.has_value()) {
+      std::cout << ", \"peak_rss_growth_kb\": "
+                << *result->peak_rss_growth_kb;
+    }
+    std::cout << ", \"allocations\": " << result->allocations << '}';
+  }
+  std::cout << "\n  ]\n}\n";
+  return failed ? 1 : 0;
+}
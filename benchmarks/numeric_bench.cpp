@@ -0,0 +1,96 @@
+// Float64Array kernel benchmark.
+// Runs the numeric kernels over arrays of random doubles and reports the
+// throughput in millions of elements per second for every implementation the
+// CPU supports. Also checks that sums and dot products match the scalar ones.
+//
+// Usage: numeric_bench [millions of elements=4] [repetitions=5]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "numeric_kernels.hpp"
+
+namespace {
+double best_seconds(int repetitions, const std::function<void()> &kernel) {
+  std::vector<double> seconds;
+  for (int i = 0; i < repetitions; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    kernel();
+    const auto end = std::chrono::steady_clock::now();
+    seconds.push_back(std::chrono::duration<double>(end - start).count());
+  }
+  return *std::min_element(seconds.begin(), seconds.end());
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t millions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+  const int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+  const size_t n = millions * 1000 * 1000;
+
+  std::mt19937_64 random{42};
+  std::uniform_real_distribution<double> distribution{-1000, 1000};
+  std::vector<double> a(n);
+  std::vector<double> b(n);
+  std::generate(a.begin(), a.end(), [&] { return distribution(random); });
+  std::generate(b.begin(), b.end(), [&] { return distribution(random); });
+  std::vector<double> out(n);
+
+  std::cout << "Kernels over " << millions << "M doubles, best of "
+            << repetitions << " runs, in M elements/s\n";
+
+  using NumericKernels::Implementation;
+  double scalar_sum = 0;
+  double scalar_dot = 0;
+  for (auto implementation : {Implementation::SCALAR, Implementation::AVX2}) {
+    NumericKernels::set_implementation(implementation);
+    if (NumericKernels::active_implementation() != implementation) {
+      continue; // Not supported on this CPU or compiler
+    }
+
+    double sum = 0;
+    double dot = 0;
+    const std::vector<std::pair<std::string, std::function<void()>>> kernels{
+        {"sum", [&] { sum = NumericKernels::sum(a.data(), n); }},
+        {"max", [&] { NumericKernels::max(a.data(), n); }},
+        {"dot", [&] { dot = NumericKernels::dot(a.data(), b.data(), n); }},
+        {"axpy", [&] { NumericKernels::axpy(0.5, a.data(), out.data(), n); }},
+        {"add",
+         [&] { NumericKernels::add(a.data(), b.data(), out.data(), n); }},
+        {"scale", [&] { NumericKernels::scale(a.data(), 3, out.data(), n); }},
+    };
+
+    std::cout << NumericKernels::to_string(implementation) << ":";
+    for (const auto &[name, kernel] : kernels) {
+      const double seconds = best_seconds(repetitions, kernel);
+      std::cout << ' ' << name << ' ' << std::fixed << std::setprecision(0)
+                << static_cast<double>(n) / 1e6 / seconds;
+    }
+    std::cout << '\n';
+
+    if (implementation == Implementation::SCALAR) {
+      scalar_sum = sum;
+      scalar_dot = dot;
+    } else if (sum != scalar_sum || dot != scalar_dot) {
+      std::cerr << "Results differ from the scalar kernels\n";
+      return 1;
+    }
+  }
+
+  std::vector<double> sorted = a;
+  const double seconds = best_seconds(1, [&] {
+    NumericKernels::sort(sorted.data(), n);
+  });
+  if (!std::is_sorted(sorted.begin(), sorted.end())) {
+    std::cerr << "sort didn't sort\n";
+    return 1;
+  }
+  std::cout << "sort: " << static_cast<double>(n) / 1e6 / seconds << '\n';
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server_protocol.hpp"
+
+// Thin client of 'Lox --serve=<socket>'. Sends a script to the server and
+// exits with its status once the server ran it, printing its output
+// meanwhile. Links nothing of the interpreter, so it starts quickly
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: lox_client <socket> <script|->\n";
+    return 64;
+  }
+  const std::string_view socket_path{argv[1]};
+  const std::string_view script{argv[2]};
+
+  // The server may run in another directory, so paths are made absolute
+  auto kind = ServerProtocol::Request::PATH;
+  std::string payload;
+  if (script == "-") {
+    kind = ServerProtocol::Request::SOURCE;
+    payload.assign(std::istreambuf_iterator<char>{std::cin}, {});
+  } else {
+    std::error_code error;
+    payload = std::filesystem::absolute(script, error).string();
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path " << socket_path << " is too long\n";
+    return 64;
+  }
+  std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+
+  const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0 ||
+      ::connect(server, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0 ||
+      !ServerProtocol::write_frame(server, static_cast<uint8_t>(kind),
+                                   payload)) {
+    std::cerr << "Can't reach the server at " << socket_path << ": "
+              << std::strerror(errno) << '\n';
+    return 69;
+  }
+
+  while (auto frame = ServerProtocol::read_frame(server)) {
+    const auto &[reply, contents] = *frame;
+    switch (static_cast<ServerProtocol::Reply>(reply)) {
+    case ServerProtocol::Reply::OUT:
+      std::cout.write(contents.data(),
+                      static_cast<std::streamsize>(contents.size()));
+      break;
+    case ServerProtocol::Reply::ERR:
+      std::cout.flush();
+      std::cerr << contents;
+      break;
+    case ServerProtocol::Reply::EXIT: {
+      int32_t status = 70;
+      if (contents.size() == sizeof(status)) {
+        std::memcpy(&status, contents.data(), sizeof(status));
+      }
+      return status;
+    }
+    }
+  }
+  std::cerr << "The server closed the connection before the script ended\n";
+  return 69;
+}
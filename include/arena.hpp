@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// Bump allocator owning the AST nodes of one compilation unit.
+/// Objects are allocated contiguously in large blocks and are never freed
+/// individually. Destroying the arena runs the destructors of the objects that
+/// need one, in reverse creation order, and then releases all blocks at once.
+struct Arena {
+  Arena() = default;
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&) = delete;
+  Arena &operator=(Arena &&) = delete;
+
+  /// Construct a T in the arena. The pointer stays valid for the arena's
+  /// lifetime
+  template <typename T, typename... Args> T *create(Args &&...args) {
+    void *memory = allocate(sizeof(T), alignof(T));
+    T *object = new (memory) T(std::forward<Args>(args)...);
+
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors.push_back(
+          {[](void *destroyed) { static_cast<T *>(destroyed)->~T(); }, object});
+    }
+    return object;
+  }
+
+  /// Total bytes handed out by create()
+  [[nodiscard]] size_t bytes_used() const;
+
+private:
+  void *allocate(size_t size, size_t alignment);
+
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::byte *cursor = nullptr;
+  std::byte *block_end = nullptr;
+  size_t used = 0;
+
+  struct Destructor {
+    void (*destroy)(void *);
+    void *object;
+  };
+  std::vector<Destructor> destructors;
+};
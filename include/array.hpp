@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "object.hpp"
+
+struct Array;
+using ArrayPtr = std::shared_ptr<Array>;
+
+/// Growable array of values stored contiguously, created by '[a, b, c]'.
+/// 'array[i]' reads and assigns elements, 'array[start:end]' copies a range
+/// into a new array, where omitted bounds default to the whole array. Indices
+/// must be integers within bounds, or a RuntimeError is thrown.
+/// Methods: push(value) appends in amortized constant time, pop() removes and
+/// returns the last element. 'for (var value in array)' visits the elements,
+/// including those pushed meanwhile
+struct Array : public Object, public std::enable_shared_from_this<Array> {
+  explicit Array(std::vector<Token::Value> _elements = {});
+
+  /// The element at index. Throws a RuntimeError at bracket if index isn't an
+  /// integer in [0, size)
+  Token::Value &at(const Token::Value &index, const Operator &bracket);
+
+  /// Copy of the elements in [start, end). Bounds that are nil default to the
+  /// start and end of the array. Throws a RuntimeError at bracket unless
+  /// 0 <= start <= end <= size
+  [[nodiscard]] ArrayPtr slice(const Token::Value &start,
+                               const Token::Value &end,
+                               const Operator &bracket) const;
+
+  [[nodiscard]] std::string to_string() const override;
+
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+  [[nodiscard]] std::shared_ptr<Iterator> iterate() override;
+
+  std::vector<Token::Value> elements;
+};
+
+/// Bounds checks shared by the indexable types
+
+/// index as a position in a sequence of size elements. Throws a RuntimeError at
+/// bracket if index isn't an integer in [0, size)
+size_t checked_index(const Token::Value &index, size_t size,
+                     const Operator &bracket);
+
+/// [start, end) of a sequence of size elements, with the bounds of
+/// Array::slice()
+std::pair<size_t, size_t> checked_range(const Token::Value &start,
+                                        const Token::Value &end, size_t size,
+                                        const Operator &bracket);
+
+/// Strings are indexed and sliced like arrays of one-character strings
+
+/// The character at index, with the bounds of Array::at()
+std::string index_string(const std::string &string, const Token::Value &index,
+                         const Operator &bracket);
+
+/// Characters [start, end), with the bounds of Array::slice()
+std::string slice_string(const std::string &string, const Token::Value &start,
+                         const Token::Value &end, const Operator &bracket);
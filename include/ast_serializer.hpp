@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "arena.hpp"
+#include "stmt.hpp"
+
+/// Binary encoding of a resolved AST, including the resolver's depth, field and
+/// suspension annotations, so a program can be rebuilt without lexing,
+/// parsing or resolving it again. Bodies deferred by a lazy parse can't be
+/// encoded, so the AST must come from an eager compile.
+/// The encoding uses native byte order and is only meant to be read back by
+/// the same build, see ast_schema_fingerprint()
+std::string serialize_ast(const std::vector<stmt> &statements);
+
+/// Function and lambda declarations of an AST in a fixed order, so the
+/// declarations of a deserialized AST correspond to those it was serialized
+/// from by index
+using FunctionDeclarations =
+    std::vector<std::variant<FunctionStmt *, Lambda *>>;
+
+/// serialize_ast(), also listing the declarations in the AST in functions
+std::string serialize_ast(const std::vector<stmt> &statements,
+                          FunctionDeclarations &functions);
+
+/// Rebuild the statements encoded by serialize_ast() in arena.
+/// Returns nullopt if data is truncated or malformed
+std::optional<std::vector<stmt>> deserialize_ast(std::string_view data,
+                                                 Arena &arena);
+
+/// deserialize_ast(), also listing the declarations in the AST in functions
+std::optional<std::vector<stmt>>
+deserialize_ast(std::string_view data, Arena &arena,
+                FunctionDeclarations &functions);
+
+/// Changes whenever the layout of AST nodes or the numbering of token types
+/// changes, which invalidates previously serialized ASTs
+uint64_t ast_schema_fingerprint();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// Building blocks of the binary files and messages of the interpreter: cached
+/// scripts, snapshots and channel messages. Values are stored in native byte
+/// order, as only the same build reads them back
+namespace BinaryFormat {
+/// Header of a file only this build of the interpreter reads back, followed
+/// by fields of the file kind and then the payload
+struct FileHeader {
+  char magic[4];
+  uint32_t byte_order;
+  /// build_id()
+  uint64_t version;
+  /// ast_schema_fingerprint()
+  uint64_t schema;
+  uint64_t payload_size;
+  uint64_t payload_checksum;
+};
+
+/// The header this build writes for a file of kind magic with payload
+FileHeader file_header(const char (&magic)[4], std::string_view payload);
+
+/// True if header was written by this build for a file of kind magic with
+/// payload, and the payload is intact
+bool is_valid(const FileHeader &header, const char (&magic)[4],
+              std::string_view payload);
+
+/// Append the bytes of value to out
+template <typename T> void put(std::string &out, T value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/// Append string to out, prefixed by its size as a uint32_t
+void put_string(std::string &out, std::string_view string);
+} // namespace BinaryFormat
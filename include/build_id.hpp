@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+/// Identifies the interpreter binary, for files only it may read back, like
+/// cached scripts and snapshots. Changes with the project version, with every
+/// compile of build_id.cpp, and on Linux with every relink of the executable,
+/// so a rebuilt interpreter ignores files written by the one before
+uint64_t build_id();
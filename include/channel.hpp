@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "object.hpp"
+
+/// A value in transit between interpreters, detached from the sender's heap.
+/// Numbers, strings, booleans, nil and shareable objects are carried as is.
+/// Instances are serialized as their class name and fields, and rebuilt by the
+/// receiver as an instance of its class of that name, or of a method-less
+/// class if it has none. Arrays, Float64Arrays and maps are copied element by
+/// element. Functions and classes can't be sent
+struct Message {
+  struct Record;
+  struct List;
+  struct Dict;
+
+  /// Throws a RuntimeError for values that can't be sent, or instances,
+  /// arrays and maps that contain themselves
+  static Message encode(const Token::Value &value);
+
+  /// Move the value into the heap of interpreter
+  Token::Value decode(Interpreter &interpreter) &&;
+
+  /// Append the message to out as bytes, for another process. Throws a
+  /// RuntimeError for objects, which only exist in this process
+  void serialize(std::string &out) const;
+
+  /// Read a message written by serialize() from the front of in, and remove
+  /// it. Throws a RuntimeError if in doesn't start with a complete message
+  static Message deserialize(std::string_view &in);
+
+  std::variant<NullType, double, bool, std::string, ObjectPtr,
+               std::unique_ptr<Record>, std::unique_ptr<List>,
+               std::unique_ptr<Dict>, std::vector<double>>
+      value;
+
+private:
+  /// enclosing holds the instances, arrays and maps being encoded around value
+  static Message encode(const Token::Value &value,
+                        std::unordered_set<const void *> &enclosing);
+};
+
+struct Message::Record {
+  std::string class_name;
+  std::vector<std::pair<std::string, Message>> fields;
+};
+
+struct Message::List {
+  std::vector<Message> elements;
+};
+
+struct Message::Dict {
+  std::vector<std::pair<Message, Message>> entries;
+};
+
+/// Bounded multi-producer multi-consumer queue of messages, created by
+/// 'Channel(capacity)'. Sending and receiving are lock-free while the channel
+/// is neither full nor empty. Otherwise they block, and the thread pool starts
+/// a spare thread for a blocked worker.
+/// Methods: send(value) waits while the channel is full and fails once it is
+/// closed. recv() waits while it is empty and returns nil once it is closed
+/// and drained. tryRecv() returns nil instead of waiting. close() wakes all
+/// waiting senders and receivers. The 'closed' property tells if close() was
+/// called
+struct Channel : public Object, public std::enable_shared_from_this<Channel> {
+  explicit Channel(size_t _capacity);
+
+  /// Throws a RuntimeError if the channel is closed
+  void send(Message message);
+
+  /// nullopt once the channel is closed and empty
+  std::optional<Message> recv();
+
+  /// nullopt if the channel is empty
+  std::optional<Message> try_recv();
+
+  void close();
+
+  [[nodiscard]] std::string to_string() const override;
+
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+  [[nodiscard]] bool is_shareable() const override;
+
+private:
+  // Bounded queue by Dmitry Vyukov. The sequence number of a cell tells
+  // whether it is free for the sender at a position, or holds the message for
+  // the receiver at a position
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Message message;
+  };
+
+  bool try_push(Message &message);
+  std::optional<Message> try_pop();
+
+  [[nodiscard]] bool has_room() const;
+  [[nodiscard]] bool has_messages() const;
+
+  void block_until(const std::function<bool()> &ready);
+  void wake_waiters();
+
+  const size_t capacity;
+  std::unique_ptr<Cell[]> cells;
+
+  // On separate cache lines, so senders and receivers don't contend
+  alignas(64) std::atomic<size_t> tail{0};
+  alignas(64) std::atomic<size_t> head{0};
+
+  alignas(64) std::atomic<bool> closed{false};
+  /// Threads blocked in send() or recv(). Others never need waking
+  std::atomic<size_t> waiters{0};
+};
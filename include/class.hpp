@@ -1,5 +1,9 @@
 #pragma once
 
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "function.hpp"
 
 struct Class : public Callable, public std::enable_shared_from_this<Class> {
@@ -8,7 +12,10 @@ struct Class : public Callable, public std::enable_shared_from_this<Class> {
   using ClassFunctions =
       std::tuple<Class::FunctionMap, Class::FunctionMap, Class::FunctionMap>;
 
-  Class(std::string _name, ClassPtr superclass, ClassFunctions);
+  /// Record classes have fields, and so do their subclasses, which inherit
+  /// the fields of the superclass and can't declare their own
+  Class(std::string _name, ClassPtr superclass, ClassFunctions,
+        std::vector<std::string> _fields = {});
 
   Token::Value call(Interpreter &,
                     const std::vector<Token::Value> &arguments) override;
@@ -25,13 +32,26 @@ struct Class : public Callable, public std::enable_shared_from_this<Class> {
 
   [[nodiscard]] const std::string &name() const;
 
+  /// Instances of record classes store exactly these fields, in this order
+  [[nodiscard]] const std::vector<std::string> &fields() const;
+
+  [[nodiscard]] bool is_record() const;
+
+  [[nodiscard]] std::optional<size_t>
+  field_index(const std::string &name) const;
+
 private:
+  friend struct SnapshotWriter;
+  friend struct ValueCopier;
+
   ClassPtr superclass;
 
   FunctionMap methods;
   FunctionMap unbounds;
   FunctionMap getters;
 
+  std::vector<std::string> m_fields;
+
   const std::string m_name;
 
   const FunctionPtr nullRef = nullptr;
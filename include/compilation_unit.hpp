@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+#include "stmt.hpp"
+#include "token.hpp"
+
+struct ErrorHandler;
+
+enum class ParseMode {
+  /// Parse and resolve everything up front, reporting all syntax errors
+  EAGER,
+  /// Only brace-match function, method and lambda bodies. They are parsed and
+  /// resolved on their first call
+  LAZY,
+};
+
+/// The result of compiling one piece of source: its tokens and its AST.
+/// All AST nodes live in the unit's arena, so the AST is valid exactly as long
+/// as the unit and is torn down in one go with it. Functions keep the unit
+/// they were declared in alive.
+struct CompilationUnit : public std::enable_shared_from_this<CompilationUnit> {
+  Arena arena;
+
+  ParseMode mode = ParseMode::EAGER;
+
+  std::vector<Token> tokens;
+
+  /// Top-level statements of the program
+  std::vector<stmt> statements;
+
+  /// File the source was read from, if any. Relative imports start here
+  std::filesystem::path path;
+
+  /// Serializes materializing deferred bodies, which allocates in the arena,
+  /// when functions of the unit run on several threads
+  std::mutex materialize_mutex;
+};
+
+using CompilationUnitPtr = std::shared_ptr<CompilationUnit>;
+
+/// Lex, parse and resolve source into a new CompilationUnit.
+/// Errors are reported to err_handler, in which case nullptr is returned
+CompilationUnitPtr compile(std::string_view source,
+                           const std::shared_ptr<ErrorHandler> &err_handler,
+                           ParseMode mode = ParseMode::EAGER);
+
+/// Parse and resolve the deferred body of a function before its first call.
+/// Does nothing if the body was parsed eagerly or is already materialized.
+/// Errors are reported to err_handler and then raised as a RuntimeError, on
+/// this and every later call
+void materialize(FunctionStmt &function,
+                 const std::shared_ptr<ErrorHandler> &err_handler);
+void materialize(Lambda &lambda,
+                 const std::shared_ptr<ErrorHandler> &err_handler);
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <memory>
 #include <string_view>
+#include <vector>
 
 // Thrown by builtin exit() function to stop execution of the interpreter
 struct Exit : public std::runtime_error {
@@ -15,6 +16,8 @@ struct RuntimeError : public std::runtime_error {
 
   RuntimeError(Token::Value value, const std::string &msg, unsigned int line);
 
+  RuntimeError(const Operator &op, const std::string &msg);
+
   // Reports an error without a line. Only use this if better information is not
   // available
   explicit RuntimeError(const std::string &msg);
@@ -31,6 +34,10 @@ struct CompiletimeError : public std::runtime_error {
   const Token token;
 };
 
+/// Text of an error or warning as CerrHandler prints it, ending with a newline
+std::string format_report(unsigned int line, std::string_view where,
+                          std::string_view message, bool is_error);
+
 struct ErrorHandler {
   ErrorHandler() = default;
   virtual ~ErrorHandler();
@@ -50,6 +57,8 @@ struct ErrorHandler {
 
   virtual void reset_error();
   [[nodiscard]] virtual bool has_error() const;
+  /// Number of errors reported so far. Unlike has_error(), never reset
+  [[nodiscard]] virtual size_t error_count() const;
 
   [[nodiscard]] virtual bool has_runtime_error() const;
 
@@ -58,6 +67,7 @@ private:
                       std::string_view message, bool is_error) = 0;
   bool had_error = false;
   bool had_runtime_error = false;
+  size_t errors = 0;
 };
 
 struct CerrHandler : public ErrorHandler {
@@ -68,6 +78,25 @@ private:
               std::string_view message, bool is_error) override;
 };
 
+/// Records reports instead of printing them, so errors found on a worker
+/// thread can be reported later on the thread that needs them
+struct BufferedErrorHandler : public ErrorHandler {
+  /// Report the recorded errors and warnings to target, prefixing each
+  /// message with context
+  void replay(ErrorHandler &target, std::string_view context) const;
+
+private:
+  void report(unsigned int line, std::string_view where,
+              std::string_view message, bool is_error) override;
+
+  struct Report {
+    unsigned int line;
+    std::string message;
+    bool is_error;
+  };
+  std::vector<Report> reports;
+};
+
 struct FileErrorHandler : public ErrorHandler {
   explicit FileErrorHandler(std::string_view filename);
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Runs callbacks for timers, file reads and file changes on the thread that
+/// calls run(). It sleeps in epoll until the next timer is due, a file read on
+/// the thread pool signals an eventfd, or inotify reports a change to a
+/// watched file. No descriptors are opened until a read or watch needs them.
+/// Callbacks may add and cancel events. Exceptions thrown by a callback
+/// propagate out of run(), leaving the remaining events pending
+struct EventLoop {
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+  using ReadCallback = std::function<void(std::optional<std::string>)>;
+  using Id = uint64_t;
+
+  EventLoop() = default;
+  ~EventLoop();
+
+  EventLoop(const EventLoop &) = delete;
+  EventLoop(EventLoop &&) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+  EventLoop &operator=(EventLoop &&) = delete;
+
+  /// Call callback once delay passed, and then every interval if given.
+  /// Intervals are at least a millisecond
+  Id set_timer(Clock::duration delay, std::optional<Clock::duration> interval,
+               Callback callback);
+
+  /// False if the timer doesn't exist (anymore)
+  bool cancel_timer(Id id);
+
+  /// Read the file on the thread pool, then call done with its contents, or
+  /// nullopt if it can't be read
+  void read_file(std::filesystem::path path, ReadCallback done);
+
+  /// Call changed whenever the file at path is modified, until it is deleted
+  /// or unwatched. nullopt if the file can't be watched
+  std::optional<Id> watch_file(const std::filesystem::path &path,
+                               Callback changed);
+
+  /// False if the watch doesn't exist (anymore)
+  bool unwatch_file(Id id);
+
+  /// Whether any timer, read or watch is left for run() to wait for
+  [[nodiscard]] bool has_pending() const;
+
+  /// Wait for and handle events until none are pending
+  void run();
+
+  /// Wait for the next events and handle them. False if nothing was pending
+  bool run_once();
+
+private:
+  struct Timer {
+    Clock::time_point due;
+    std::optional<Clock::duration> interval;
+    Callback callback;
+  };
+
+  struct Watch {
+    int descriptor;
+    Callback changed;
+  };
+
+  /// Results of reads, filled by pool threads. Shared with the reads, which
+  /// may finish after the loop is gone
+  struct Completions {
+    Completions();
+    ~Completions();
+
+    Completions(const Completions &) = delete;
+    Completions(Completions &&) = delete;
+    Completions &operator=(const Completions &) = delete;
+    Completions &operator=(Completions &&) = delete;
+
+    std::mutex mutex;
+    std::vector<std::pair<Id, std::optional<std::string>>> results;
+    /// Signalled for every result
+    const int event_fd;
+  };
+
+  void ensure_epoll();
+  /// Wait up to timeout for descriptors to be ready, and queue their events
+  void poll(int timeout_ms);
+  void collect_completions();
+  void collect_changes();
+
+  Id next_id = 1;
+
+  std::unordered_map<Id, Timer> timers;
+  /// Timers by due time, then by creation for timers due at the same time
+  std::set<std::pair<Clock::time_point, Id>> schedule;
+
+  std::unordered_map<Id, ReadCallback> reads;
+  std::shared_ptr<Completions> completions;
+
+  std::unordered_map<Id, Watch> watches;
+
+  /// Finished reads and changed watches, whose callbacks are yet to run
+  std::deque<std::pair<Id, std::optional<std::string>>> finished_reads;
+  std::deque<Id> changed_watches;
+
+  int epoll_fd = -1;
+  int inotify_fd = -1;
+};
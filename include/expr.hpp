@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <type_traits>
 #include <vector>
 
+#include "arena.hpp"
 #include "token.hpp"
 #include "visitor.hpp"
 
@@ -24,38 +27,55 @@ struct Expr {
   // How many environments out from the current one the correct definition is.
   std::optional<int> depth = std::nullopt;
 };
-using expr = std::unique_ptr<Expr>;
+
+// Resolver state of Get and Set besides depth
+struct FieldAccess {
+  // For Get and Set on 'this' in a record class, the index of the field.
+  std::optional<uint32_t> field_index = std::nullopt;
+};
+struct NoFieldAccess {};
+// AST nodes are owned by the Arena of their CompilationUnit. Links between
+// nodes are plain pointers into that arena
+using expr = Expr *;
 
 template <int id, typename... Types> struct ExprProduction;
 
 struct Statement;
-using stmt = std::unique_ptr<Statement>;
+using stmt = Statement *;
+
+// Function body skipped by a lazy parse. Defined in stmt.hpp
+struct DeferredBody;
 
 // ---------------------Alias definitions for convenience---------------------
 
 // clang-format off
-using Binary = ExprProduction<0, expr, Token, expr>;                                      // expr bin_op expr
+using Binary = ExprProduction<0, expr, Operator, expr>;                                   // expr bin_op expr
 using Grouping = ExprProduction<1, expr>;                                                 // (expr)
 using Literal = ExprProduction<2, Token::Value>;                                          // value
-using Unary = ExprProduction<3, Token, expr>;                                             // unary_op expr
-using Ternary = ExprProduction<4, expr, Token, expr, Token, expr>;                        // expr op expr op expr
+using Unary = ExprProduction<3, Operator, expr>;                                          // unary_op expr
+using Ternary = ExprProduction<4, expr, Operator, expr, Operator, expr>;                  // expr op expr op expr
 using Malformed = ExprProduction<5, bool, std::string>;                                   // is_critical message
 using Variable = ExprProduction<6, Token>;                                                // name
-using VarPtr = std::unique_ptr<Variable>;
+using VarPtr = Variable *;
 using Empty = ExprProduction<7>;                                                          // No data (for empty variable initializer)
 using Assign = ExprProduction<8, Token, expr>;                                            // name value
-using Logical = ExprProduction<9, expr, Token, expr>;                                     // left op right	(where op is "and" or "or")
-using Call = ExprProduction<10, expr, Token, std::vector<expr>>;                          // callee paren arguments
-using Lambda = ExprProduction<11, std::vector<Token>, std::vector<stmt>>;                 // params body
+using Logical = ExprProduction<9, expr, Operator, expr>;                                  // left op right	(where op is "and" or "or")
+using Call = ExprProduction<10, expr, Operator, std::vector<expr>>;                       // callee paren arguments
+using Lambda = ExprProduction<11, std::vector<Token>, std::vector<stmt>, DeferredBody *>; // params body deferred_body
 using Get = ExprProduction<12, expr, Token>;                                              // object name
 using Set = ExprProduction<13, expr, Token, expr>;                                        // object name value
 using This = ExprProduction<14, Token>;                                                   // 'this'
 using Super = ExprProduction<15, Token, Token, bool>;                                     // 'super' accessed_method is_unbound
+using ArrayLiteral = ExprProduction<16, Operator, std::vector<expr>>;                     // '[' elements
+using Index = ExprProduction<17, expr, Operator, expr>;                                   // object '[' index
+using IndexSet = ExprProduction<18, expr, Operator, expr, expr>;                          // object '[' index value
+using Slice = ExprProduction<19, expr, Operator, expr, expr>;                             // object '[' start end (Empty if omitted)
 // clang-format on
 
 #define EXPR_TYPES                                                             \
   Literal, Grouping, Unary, Binary, Ternary, Malformed, Variable, Empty,       \
-      Assign, Logical, Call, Lambda, Get, Set, This, Super
+      Assign, Logical, Call, Lambda, Get, Set, This, Super, ArrayLiteral,      \
+      Index, IndexSet, Slice
 
 using ExprVisitableBase = Visitable<EXPR_TYPES>;
 template <int id, typename... Types>
@@ -67,8 +87,13 @@ using ExprVisitor = Visitor<EXPR_TYPES>;
 
 /// A generic production for an expression. id is for disambiguation
 template <int id, typename... Types>
-struct ExprProduction : public Expr,
-                        public ExprProductionVisitableImpl<id, Types...> {
+struct ExprProduction
+    : public Expr,
+      public ExprProductionVisitableImpl<id, Types...>,
+      public std::conditional_t<
+          std::is_same_v<ExprProduction<id, Types...>, Get> ||
+              std::is_same_v<ExprProduction<id, Types...>, Set>,
+          FieldAccess, NoFieldAccess> {
   explicit ExprProduction(Types &&... args)
       : derivatives(std::forward<Types>(args)...) {}
 
@@ -94,7 +119,8 @@ struct ExprProduction : public Expr,
 std::ostream &operator<<(std::ostream &os, const std::vector<expr> &rhs);
 
 std::ostream &operator<<(std::ostream &os, const Expr &rhs);
-std::ostream &operator<<(std::ostream &os, const expr &rhs);
+std::ostream &operator<<(std::ostream &os, const Expr *rhs);
+std::ostream &operator<<(std::ostream &os, const DeferredBody *rhs);
 
 #define DECLARE_EXPR_VISIT_METHODS                                             \
   void visit(Assign &) override;                                               \
@@ -112,9 +138,13 @@ std::ostream &operator<<(std::ostream &os, const expr &rhs);
   void visit(Get &) override;                                                  \
   void visit(Set &) override;                                                  \
   void visit(This &) override;                                                 \
-  void visit(Super &) override;
+  void visit(Super &) override;                                                \
+  void visit(ArrayLiteral &) override;                                         \
+  void visit(Index &) override;                                                \
+  void visit(IndexSet &) override;                                             \
+  void visit(Slice &) override;
 
 template <typename Type, typename... arg_types>
-expr new_expr(arg_types &&... args) {
-  return std::make_unique<Type>(std::forward<arg_types>(args)...);
+expr new_expr(Arena &arena, arg_types &&... args) {
+  return arena.create<Type>(std::forward<arg_types>(args)...);
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object.hpp"
+
+struct Float64Array;
+using Float64ArrayPtr = std::shared_ptr<Float64Array>;
+
+/// Fixed-size array of unboxed doubles, created by 'Float64Array(size)' with
+/// zeros, or 'Float64Array(array)' from an array of numbers. Indexed and sliced
+/// like arrays, but elements must be numbers.
+/// Methods run the native kernels of numeric_kernels.hpp: sum(), min(), max(),
+/// dot(other), prefixSum(), add(other), mul(other) and scale(k) return new
+/// values. axpy(alpha, x) adds alpha * x to the array and sort() sorts it,
+/// both in place. Arrays combined with other must have the same length
+struct Float64Array : public Object,
+                      public std::enable_shared_from_this<Float64Array> {
+  explicit Float64Array(std::vector<double> _elements = {});
+
+  /// The element at index. Throws a RuntimeError at bracket if index isn't an
+  /// integer in [0, size)
+  double &at(const Token::Value &index, const Operator &bracket);
+
+  /// Copy of the elements in [start, end), with the bounds of Array::slice()
+  [[nodiscard]] Float64ArrayPtr slice(const Token::Value &start,
+                                      const Token::Value &end,
+                                      const Operator &bracket) const;
+
+  [[nodiscard]] std::string to_string() const override;
+
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+  [[nodiscard]] std::shared_ptr<Iterator> iterate() override;
+
+  std::vector<double> elements;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "callable.hpp"
+#include "token.hpp"
+
+struct Interpreter;
+
+/// Call function with each of inputs in worker processes forked from this one,
+/// and return the results in the order of inputs. Workers start with a
+/// copy-on-write image of the interpreter, so they see its globals without
+/// copying or running anything again, but their changes to them are lost.
+/// Worker i calls function with inputs i, i + workers, ... and streams each
+/// result back over a pipe as soon as it is computed, serialized like a
+/// channel message. Output of the workers goes to the inherited stdout.
+///
+/// Throws a RuntimeError if function fails in a worker, returns a value that
+/// can't be sent, or a worker dies. Workers have no thread pool, so
+/// function must not spawn tasks or wait for channels.
+/// Also throws if the process runs other threads, checked on Linux: once
+/// spawn(), readFileAsync() or a script server started threads, forking could
+/// copy a lock they hold into the workers, which would wait for it forever
+std::vector<Token::Value> fork_map(Interpreter &interpreter,
+                                   const std::vector<Token::Value> &inputs,
+                                   const CallablePtr &function, size_t workers);
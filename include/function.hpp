@@ -3,13 +3,15 @@
 #include <vector>
 
 #include "callable.hpp"
+#include "compilation_unit.hpp"
 #include "environment.hpp"
 #include "stmt.hpp"
 
 struct Function : public Callable {
   Function(
-      const std::variant<const FunctionStmt *, const Lambda *> &declaration,
-      std::shared_ptr<Environment> closure, FunctionKind kind);
+      const std::variant<FunctionStmt *, Lambda *> &declaration,
+      std::shared_ptr<Environment> closure, FunctionKind kind,
+      std::shared_ptr<CompilationUnit> unit, Environment *globals);
 
   Token::Value call(Interpreter &interpreter,
                     const std::vector<Token::Value> &arguments) override;
@@ -17,6 +19,9 @@ struct Function : public Callable {
   [[nodiscard]] size_t arity() const override;
   [[nodiscard]] std::string to_string() const override;
 
+  /// Declared name, or "lambda" for lambdas
+  [[nodiscard]] const std::string &name() const;
+
   [[nodiscard]] const std::vector<Token> &parameters() const;
   [[nodiscard]] const std::vector<stmt> &body() const;
 
@@ -31,7 +36,15 @@ struct Function : public Callable {
   FunctionPtr bind(InstancePtr);
 
 private:
-  const std::variant<const FunctionStmt *, const Lambda *> declaration;
+  friend struct SnapshotWriter;
+  friend struct ValueCopier;
+
+  const std::variant<FunctionStmt *, Lambda *> declaration;
   std::shared_ptr<Environment> closure;
   const FunctionKind kind;
+  /// Owns the AST of the declaration. Null for ASTs not owned by a unit
+  std::shared_ptr<CompilationUnit> unit;
+  /// Global scope of the module the function was declared in. Kept alive by
+  /// the closure
+  Environment *globals;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "compilation_unit.hpp"
+#include "environment.hpp"
+#include "object.hpp"
+#include "stmt.hpp"
+
+/// Suspended call of a generator function, any function containing 'yield'.
+/// Calling one binds its arguments and returns a generator, without running
+/// the body. Each next() runs the body up to the next 'yield' and returns the
+/// yielded value, or nil once the body returned. The 'done' property tells if
+/// it did. 'for (var value in generator)' runs the loop body for every value.
+/// Instead of a suspended C++ stack, a generator keeps the blocks and loops
+/// the 'yield' is nested in as frames. Statements without a 'yield' run on the
+/// interpreter as usual, so resuming costs about as much as a function call
+struct Generator : public Iterator {
+  Generator(std::shared_ptr<Environment> parameters,
+            const std::vector<stmt> &body,
+            std::shared_ptr<CompilationUnit> _unit, Environment *_globals);
+
+  /// Throws a RuntimeError if the body fails, which ends the generator
+  std::optional<Token::Value> next(Interpreter &interpreter) override;
+
+  [[nodiscard]] std::string to_string() const override;
+
+  /// The 'next()' method and the 'done' property
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+private:
+  /// A block or loop the body is suspended in
+  struct Frame {
+    /// Statements of a block, else nullptr for a loop
+    const std::vector<stmt> *block;
+    /// Index of the next statement of a block
+    size_t next;
+    /// A WhileStmt or ForInStmt, else nullptr for a block
+    Statement *loop;
+    /// Values of a ForInStmt
+    std::shared_ptr<Iterator> iterator;
+    std::shared_ptr<Environment> environment;
+  };
+
+  /// Run frames until a 'yield' or the end of the body
+  std::optional<Token::Value> resume(Interpreter &interpreter);
+
+  /// Run statement in environment. Statements with a 'yield' instead push a
+  /// frame, or suspend at once. Returns the yielded value if they did
+  std::optional<Token::Value> enter(Interpreter &interpreter,
+                                    Statement *statement,
+                                    std::shared_ptr<Environment> environment);
+
+  /// Empty once the body returned
+  std::vector<Frame> frames;
+  bool running = false;
+
+  /// Owns the AST of the body. Null for ASTs not owned by a unit
+  std::shared_ptr<CompilationUnit> unit;
+  Environment *globals;
+};
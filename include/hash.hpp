@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+inline constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+inline constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+/// 64-bit FNV-1a hash. Pass a previous result as hash to continue hashing
+/// over several pieces of data
+constexpr uint64_t fnv1a(std::string_view data,
+                         uint64_t hash = FNV_OFFSET_BASIS) {
+  for (const char c : data) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
@@ -1,23 +1,69 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 #include "class.hpp"
 
+/// New instance of klass. Instances of record classes are a single allocation
+/// with their field values stored inline, starting out nil
+InstancePtr make_instance(ClassPtr klass);
+
 struct Instance : public std::enable_shared_from_this<Instance> {
-  explicit Instance(ClassPtr);
+  /// Room for the field values of a record, placed after the instance by
+  /// make_instance()
+  struct RecordStorage {
+    Token::Value *values = nullptr;
+  };
+
+  Instance(ClassPtr, const RecordStorage &);
+  ~Instance();
+
+  Instance(const Instance &) = delete;
+  Instance &operator=(const Instance &) = delete;
 
   [[nodiscard]] std::string to_string() const;
 
   [[nodiscard]] Token::Value get_field(const Token &name, Interpreter &);
 
+  /// Throws a RuntimeError if a getter by this name exists, or the instance
+  /// is a record without such a field
   void set_field(const Token &name, Token::Value);
 
+  /// Field of a record by its index in Class::fields()
+  [[nodiscard]] Token::Value &field_at(size_t index) { return values[index]; }
+
 private:
-  // Field are more general than properties. A field is anything defined on an
-  // instance, like a method or property
-  std::unordered_map<std::string, Token::Value> fields;
+  friend struct SnapshotWriter;
+  friend struct SnapshotReader;
+  friend struct ValueCopier;
+  friend struct Message;
+
+  /// Visit every field as visit(name, value)
+  template <typename Visit> void for_each_field(Visit &&visit) const {
+    const auto &names = klass->fields();
+    for (size_t i = 0; i < names.size(); ++i) {
+      visit(names[i], values[i]);
+    }
+    if (fields != nullptr) {
+      for (const auto &[name, value] : *fields) {
+        visit(name, value);
+      }
+    }
+  }
+
+  /// Set a field without the checks of set_field(), to rebuild an instance.
+  /// Fields a record doesn't have are a RuntimeError
+  void restore_field(const std::string &name, Token::Value);
 
   ClassPtr klass;
+
+  /// The fields of a record, klass->fields().size() of them
+  Token::Value *values;
+
+  // Field are more general than properties. A field is anything defined on an
+  // instance, like a method or property. Created with the first field of an
+  // instance that isn't a record
+  std::unique_ptr<std::unordered_map<std::string, Token::Value>> fields;
 };
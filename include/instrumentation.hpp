@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "expr.hpp"
+#include "stmt.hpp"
+
+struct CompilationUnit;
+
+/// Deterministic execution counters, compiled in with the CMake option
+/// LOX_INSTRUMENT. Every statement and call is counted and timed per source
+/// line, and so are the iterations of loops. Time spent in nested statements
+/// and calls is subtracted from the self time of a line. report() writes the
+/// lines with the most self time to stderr, or to $LOX_INSTRUMENT_REPORT as
+/// text, or as JSON if that ends in ".json".
+/// Without the option, Scope is empty and count_iteration() does nothing, so
+/// the interpreter has no trace of the hooks
+namespace Instrumentation {
+#ifdef LOX_INSTRUMENT
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+/// Write the report. Called at exit in instrumented builds
+void report();
+
+namespace detail {
+struct Counters;
+
+/// Counts a statement, or a call on a line, and times it until destroyed
+struct Timer {
+  Timer(Statement &, const CompilationUnit *);
+  Timer(unsigned line, const CompilationUnit *);
+  ~Timer();
+
+  Timer(const Timer &) = delete;
+  Timer &operator=(const Timer &) = delete;
+
+private:
+  void start();
+
+  Counters *counters;
+  std::chrono::steady_clock::time_point started;
+  /// Time of the nested timers, in nanoseconds
+  uint64_t nested = 0;
+  uint64_t *enclosing_nested = nullptr;
+};
+
+struct NoTimer {
+  template <typename... Args> explicit NoTimer(Args &&...) {}
+};
+
+void count_iteration(Statement &loop, const CompilationUnit *);
+} // namespace detail
+
+using Scope = std::conditional_t<enabled, detail::Timer, detail::NoTimer>;
+
+inline void count_iteration([[maybe_unused]] Statement &loop,
+                            [[maybe_unused]] const CompilationUnit *unit) {
+  if constexpr (enabled) {
+    detail::count_iteration(loop, unit);
+  }
+}
+} // namespace Instrumentation
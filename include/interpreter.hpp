@@ -2,15 +2,27 @@
 
 #include "environment.hpp"
 
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
 #include "class.hpp"
+#include "compilation_unit.hpp"
 #include "error.hpp"
+#include "event_loop.hpp"
 #include "expr.hpp"
+#include "object.hpp"
 #include "stmt.hpp"
 
-struct Parser;
+struct Module;
+using ModulePtr = std::shared_ptr<Module>;
 
+/// All values except nil and false are truthy, including "", 0 and callables
+bool is_truthy(const Token::Value &value);
+
+/// Tree-walking interpreter. Interpreters share no mutable state, so several
+/// can run on different threads at once. An interpreter and the values it
+/// created must only be used by one thread at a time, see Isolate
 struct Interpreter : public ExprVisitor, public StmtVisitor {
   explicit Interpreter(std::ostream &_os,
                        std::shared_ptr<ErrorHandler> _err_handler);
@@ -23,18 +35,40 @@ struct Interpreter : public ExprVisitor, public StmtVisitor {
 
   /// Interprets a list of statements, representing a program
   void interpret(std::vector<stmt> &statements);
+  /// Interprets the program of a unit. Functions declared by it keep the unit
+  /// alive. Modules it imports are compiled ahead, in parallel
+  void interpret(CompilationUnit &unit);
+
+  void execute(Statement *statement);
+
+  /// Runs the callbacks of timers, file reads and watches until none are
+  /// pending. A runtime error in a callback is reported and ends the loop
+  void run_event_loop();
 
-  void execute(const stmt &statement);
+  /// Call callee like a call expression at location: within the recursion
+  /// limit, on the profiler's stack and counted by the instrumentation.
+  /// Natives calling back into Lox, like event loop callbacks, call through
+  /// here
+  Token::Value call(Callable &callee,
+                    const std::vector<Token::Value> &arguments,
+                    const Operator &location);
 
   void execute_block(const std::vector<stmt> &body,
                      std::shared_ptr<Environment> enclosing_env);
 
   std::ostream &out_stream;
 
+  /// Builtin functions. Encloses the globals of the script and of each module
+  const std::shared_ptr<Environment> builtins;
+
   const std::shared_ptr<Environment> globals;
 
   std::shared_ptr<Environment> environment;
 
+  /// Global scope of the module whose code is executing, else globals.
+  /// Variables the resolver didn't find in a local scope are looked up here
+  Environment *current_globals;
+
   /// Used to unwind the interpreter execution when functions return
   struct Return : std::exception {
     explicit Return(Token::Value _val) : val(std::move(_val)) {}
@@ -47,8 +81,25 @@ struct Interpreter : public ExprVisitor, public StmtVisitor {
 
   std::string interpreter_path;
 
+  /// Timers, file reads and watches created by the script's builtins
+  EventLoop event_loop;
+
+  /// False for interpreters whose event loop never runs: those of spawned
+  /// tasks and forkMap workers. The event loop builtins fail there
+  bool runs_event_loop = true;
+
+  /// The unit whose code is executing. Functions created now capture it
+  CompilationUnit *current_unit = nullptr;
+
+  /// Create a function for a declaration in the current environment, unit and
+  /// global scope
+  [[nodiscard]] FunctionPtr
+  make_function(const std::variant<FunctionStmt *, Lambda *> &declaration,
+                FunctionKind kind) const;
+
   struct CheckedRecursiveDepth {
     CheckedRecursiveDepth(Interpreter &, const Token &location);
+    CheckedRecursiveDepth(Interpreter &, const Operator &location);
     ~CheckedRecursiveDepth();
 
     CheckedRecursiveDepth(const CheckedRecursiveDepth &) = delete;
@@ -61,16 +112,53 @@ struct Interpreter : public ExprVisitor, public StmtVisitor {
     static constexpr size_t MAX_RECURSION_DEPTH = 1000;
   };
 
+  /// Makes a unit and the global scope its code runs in the current ones for
+  /// the lifetime of the guard
+  struct CurrentUnit {
+    CurrentUnit(Interpreter &, CompilationUnit *unit, Environment *globals);
+    ~CurrentUnit();
+
+    CurrentUnit(const CurrentUnit &) = delete;
+    CurrentUnit operator=(const CurrentUnit &) = delete;
+    CurrentUnit(CurrentUnit &&) = delete;
+    CurrentUnit operator=(CurrentUnit &&) = delete;
+
+    Interpreter &interpreter;
+    CompilationUnit *previous_unit;
+    Environment *previous_globals;
+  };
+
 private:
+  friend struct Generator;
+
   DECLARE_STMT_VISIT_METHODS
 
   DECLARE_EXPR_VISIT_METHODS
 
   size_t recursion_depth = 0;
 
-  Token::Value get_evaluated(const expr &expression);
+  /// Modules imported so far by canonical path. nullptr while a module's
+  /// top-level code runs, to detect circular imports
+  std::unordered_map<std::string, ModulePtr> modules;
+
+  /// The module at path, loading and running it on first import
+  ModulePtr import_module(const Token &keyword, const std::string &path);
+
+  /// The iterator for 'for (var value in iterable)'. Throws a RuntimeError at
+  /// keyword if iterable can't be iterated
+  std::shared_ptr<Iterator> iterate(const Token &keyword,
+                                    const Token::Value &iterable);
+
+  Token::Value get_evaluated(Expr *expression);
   Token::Value get_evaluated(Expr &expression);
 
+  /// The evaluated arguments of a call. Throws a RuntimeError unless there are
+  /// arity of them
+  std::vector<Token::Value> arguments_of(Call &node, size_t arity);
+
+  /// Property name of object, for 'object.name'
+  Token::Value get_property(Token::Value object, const Token &name);
+
   [[nodiscard]] Class::ClassFunctions split_class_functions(
       const std::vector<FunctionStmtPtr> &class_functions) const;
 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+#include "compilation_unit.hpp"
+#include "error.hpp"
+#include "interpreter.hpp"
+#include "logging.hpp"
+
+/// An interpreter with its own globals, output, error handler and logging
+/// configuration, for embedding several in one process. Isolates only share
+/// the thread-safe ModuleCache, so different isolates may run on different
+/// threads concurrently. One isolate must only be used by one thread at a time,
+/// but may move between threads between calls
+struct Isolate {
+  struct Options {
+    std::ostream *out = &std::cout;
+    std::shared_ptr<ErrorHandler> err_handler =
+        std::make_shared<CerrHandler>();
+    Logging::Config logging{};
+    ParseMode mode = ParseMode::LAZY;
+  };
+
+  explicit Isolate(Options _options);
+  Isolate() : Isolate(Options{}) {}
+
+  /// Compile and run source as a script read from path, if any. Returns false
+  /// on compile or runtime errors, which are reported to the error handler
+  bool run(std::string_view source, const std::filesystem::path &path = {});
+
+  /// Run the script at path. Returns false if it can't be read or has errors
+  bool run_file(const std::filesystem::path &path);
+
+  /// Run the script at path, compiled through the ModuleCache. Later runs of
+  /// the unchanged file, by any isolate, skip compiling it. Returns false if
+  /// it can't be read or has errors
+  bool run_cached(const std::filesystem::path &path);
+
+  /// Define the globals of a snapshot image, see load_snapshot()
+  [[nodiscard]] bool load_prelude(const std::filesystem::path &image);
+
+  /// True once a script called exit(). Later runs do nothing
+  [[nodiscard]] bool exited() const;
+
+  [[nodiscard]] Interpreter &interpreter();
+
+  [[nodiscard]] ErrorHandler &errors();
+
+private:
+  /// Run a compiled unit, and then the event loop
+  bool run_unit(CompilationUnit &unit);
+
+  Options options;
+  Interpreter m_interpreter;
+  bool m_exited = false;
+};
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 #include "error.hpp"
@@ -10,16 +10,13 @@
 struct Lexer {
   using Type = Token::TokenType;
 
-  explicit Lexer(std::string _source,
+  /// The source is not copied and must outlive lex()
+  explicit Lexer(std::string_view _source,
                  std::shared_ptr<ErrorHandler> _err_handler =
                      std::make_shared<CerrHandler>());
 
   std::vector<Token> lex();
 
-  // clang-format off
-  static const std::unordered_map<std::string, Type> keywords;
-  // clang-format on
-
 private:
   [[nodiscard]] bool is_at_end() const;
   char advance();
@@ -33,7 +30,11 @@ private:
   void identifier();
   void slash_or_comment();
 
-  std::string source;
+  // Helpers for the bulk scanning functions in scan.hpp
+  [[nodiscard]] const char *end() const;
+  [[nodiscard]] unsigned int position(const char *scanned) const;
+
+  std::string_view source;
   std::vector<Token> tokens;
   unsigned int start = 0;
   unsigned int current = 0;
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 namespace Logging {
@@ -14,17 +15,48 @@ enum class LogLevel {
 
 std::ostream &operator<<(std::ostream &, LogLevel level);
 
+/// Logging configuration of a thread. Every thread starts out with the
+/// defaults, so interpreters on different threads log independently
+struct Config {
+  LogLevel level = LogLevel::WARNING;
+  std::ostream *stream = &std::cout;
+};
+
+/// The calling thread's configuration
+Config &config();
+
+/// Makes config the calling thread's configuration for the lifetime of the
+/// guard. Changes made meanwhile, e.g. by setLogLevel(), are written back
+struct ScopedConfig {
+  explicit ScopedConfig(Config &_config);
+  ~ScopedConfig();
+
+  ScopedConfig(const ScopedConfig &) = delete;
+  ScopedConfig(ScopedConfig &&) = delete;
+  ScopedConfig &operator=(const ScopedConfig &) = delete;
+  ScopedConfig &operator=(ScopedConfig &&) = delete;
+
+private:
+  Config &config;
+  Config previous;
+};
+
+/// Set the log level of the calling thread
 void set_log_level(LogLevel level);
 
+/// The log level of the calling thread
 LogLevel get_log_level();
 
 template <typename... Arg>
 void log(const std::string &filename, int line, const Arg &...args) {
-  std::cout << filename << ":" << line << ": ";
+  // Written in one go, so lines logged by different threads don't interleave
+  std::ostringstream message;
+  message << filename << ":" << line << ": ";
 
-  ((std::cout << args), ...); // Print all variadic args
+  ((message << args), ...); // Print all variadic args
 
-  std::cout << std::endl;
+  message << '\n';
+  *config().stream << message.str() << std::flush;
 }
 
 void newline(LogLevel);
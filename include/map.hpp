@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object.hpp"
+
+struct Map;
+using MapPtr = std::shared_ptr<Map>;
+
+/// Hash map created by 'Map()'. Keys are numbers, strings, booleans and nil by
+/// value, and functions, classes, instances and objects by identity.
+/// 'map[key]' reads a value, or nil if the key is missing, and
+/// 'map[key] = value' inserts or replaces it.
+/// Methods: has(key), get(key, default), remove(key) returns whether the key
+/// was present, keys() and values() return arrays. 'for (var key in map)'
+/// visits the keys, and fails if keys are added meanwhile.
+/// Open addressing in the style of Swiss tables: a control byte per slot holds
+/// 7 bits of the key's hash, and lookups match a group of 16 control bytes at
+/// once. Full hashes are stored with the entries, so string keys are only
+/// hashed once and only compared if their hashes are equal
+struct Map : public Object, public std::enable_shared_from_this<Map> {
+  Map() = default;
+
+  /// The value of key, or nullptr if key is missing
+  [[nodiscard]] Token::Value *find(const Token::Value &key);
+
+  /// The value of key, inserted as nil if key is missing. Throws a
+  /// RuntimeError on line for keys that can't be hashed (NaN)
+  Token::Value &insert(const Token::Value &key, unsigned int line);
+
+  /// Returns false if key was missing
+  bool remove(const Token::Value &key);
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  /// Call visit(key, value) for every entry
+  template <typename Visit> void for_each(Visit &&visit) const {
+    for (size_t i = 0; i < controls.size(); ++i) {
+      if (controls[i] >= 0) {
+        visit(slots[i].key, slots[i].value);
+      }
+    }
+  }
+
+  [[nodiscard]] std::string to_string() const override;
+
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+  [[nodiscard]] std::shared_ptr<Iterator> iterate() override;
+
+  /// Number of keys added so far, to detect additions during iteration
+  [[nodiscard]] size_t additions() const { return added; }
+
+  /// Key in slot, or nullptr if the slot is free. Slots are numbered from 0 to
+  /// capacity()
+  [[nodiscard]] const Token::Value *key_at(size_t slot) const;
+  [[nodiscard]] size_t capacity() const { return controls.size(); }
+
+private:
+  struct Slot {
+    Token::Value key;
+    Token::Value value;
+    uint64_t hash = 0;
+  };
+
+  /// Slot holding key with hash, or -1
+  [[nodiscard]] std::ptrdiff_t find_slot(const Token::Value &key,
+                                         uint64_t hash) const;
+
+  /// A free slot on the probe sequence of hash
+  [[nodiscard]] size_t find_free(uint64_t hash) const;
+
+  /// Rebuild the table with new_capacity slots, dropping deleted ones
+  void rehash(size_t new_capacity);
+
+  /// Per slot: -128 if empty, -2 if deleted, else the low 7 bits of the hash
+  /// of its key. The capacity is 0 or a power of two of at least 16
+  std::vector<int8_t> controls;
+  std::vector<Slot> slots;
+  size_t count = 0;
+  /// Empty slots left before the table must grow
+  size_t growth_left = 0;
+  size_t added = 0;
+};
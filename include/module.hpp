@@ -0,0 +1,92 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "compilation_unit.hpp"
+#include "environment.hpp"
+#include "error.hpp"
+#include "object.hpp"
+#include "script_cache.hpp"
+
+/// A module after its top-level code ran, bound by 'import "path" as name;'.
+/// All globals of the module are exported, including those it defines later.
+/// 'name.export' reads the current value of the export, so later assignments
+/// inside the module are visible
+struct Module : public Object {
+  Module(std::string _name, CompilationUnitPtr _unit,
+         std::shared_ptr<Environment> _globals);
+
+  [[nodiscard]] std::string to_string() const override;
+
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+private:
+  friend struct SnapshotWriter;
+  friend struct SnapshotReader;
+  friend struct ValueCopier;
+
+  std::string name;
+  CompilationUnitPtr unit;
+  std::shared_ptr<Environment> globals;
+};
+
+/// Process-wide cache of compiled modules, keyed by canonical path and checked
+/// against the file's modification time on every load. Modules are compiled
+/// eagerly, and independent modules in parallel by prefetch().
+/// Thread-safe. Isolates share the compiled units, whose eagerly parsed ASTs
+/// are never modified after compilation
+struct ModuleCache {
+  struct Entry {
+    /// nullptr if the module had compile errors
+    CompilationUnitPtr unit;
+    /// Errors and warnings from compiling the module, for the importer to
+    /// report
+    std::shared_ptr<BufferedErrorHandler> diagnostics;
+    std::filesystem::file_time_type modified;
+  };
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  static ModuleCache &instance();
+
+  /// The compiled module at the canonical path, compiling it if it isn't
+  /// cached or changed on disk. nullptr if the file can't be read
+  EntryPtr load(const std::filesystem::path &path);
+
+  /// Compile what unit imports at top level, their imports and so on. Each
+  /// level of the import graph is compiled in parallel on worker threads
+  void prefetch(const CompilationUnit &unit);
+
+  /// Also cache compiled modules on disk. nullopt disables the disk cache
+  void set_script_cache(std::optional<ScriptCache> cache);
+
+private:
+  ModuleCache() = default;
+
+  /// The cached entry if it is up to date with the file. Otherwise copies
+  /// the script cache to disk_cache, for compiling without holding the lock
+  EntryPtr cached(const std::filesystem::path &path,
+                  std::filesystem::file_time_type modified,
+                  std::optional<ScriptCache> &disk_cache);
+
+  static EntryPtr
+  compile_module(const std::filesystem::path &path,
+                 std::filesystem::file_time_type modified,
+                 const std::optional<ScriptCache> &disk_cache);
+
+  std::mutex mutex;
+  std::unordered_map<std::string, EntryPtr> entries;
+  std::optional<ScriptCache> script_cache;
+};
+
+/// Canonical path of an import. Relative paths start at the directory of the
+/// importing unit's file, or at fallback_directory for units without a file.
+/// ".lox" is appended if the path has no extension
+std::filesystem::path
+resolve_import(const CompilationUnit *importer, std::string_view path,
+               const std::filesystem::path &fallback_directory);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/// Kernels over arrays of doubles used by Float64Array.
+/// Every function takes arrays of n elements, and output arrays may be the
+/// same as input arrays. The AVX2 implementation processes 4 doubles per
+/// instruction and is selected at runtime based on the CPU. The scalar
+/// implementation defines the behavior: sums and dot products add up 16
+/// interleaved partial sums in the same order in both, so their results are
+/// identical
+namespace NumericKernels {
+enum class Implementation { SCALAR, AVX2 };
+
+double sum(const double *a, size_t n);
+
+/// NaN if any element is NaN. n must not be 0
+double min(const double *a, size_t n);
+double max(const double *a, size_t n);
+
+double dot(const double *a, const double *b, size_t n);
+
+/// y = alpha * x + y
+void axpy(double alpha, const double *x, double *y, size_t n);
+
+/// out = a + b, out = a * b and out = a * k, elementwise
+void add(const double *a, const double *b, double *out, size_t n);
+void mul(const double *a, const double *b, double *out, size_t n);
+void scale(const double *a, double k, double *out, size_t n);
+
+/// out[i] = a[0] + ... + a[i], added up in order. A vectorized scan would
+/// reassociate the additions, so this one is scalar everywhere
+void prefix_sum(const double *a, double *out, size_t n);
+
+/// Sort ascending in the IEEE 754 total order, so -0 comes before 0 and NaNs
+/// come last (or first if negative). A radix sort on the bits of the doubles,
+/// scalar everywhere
+void sort(double *a, size_t n);
+
+/// Best implementation the current CPU supports
+Implementation best_implementation();
+
+/// Implementation used by the functions above. Defaults to the best one
+Implementation active_implementation();
+
+/// Select an implementation, e.g. for benchmarking the scalar fallback.
+/// Requesting an unsupported implementation selects the best supported one
+void set_implementation(Implementation);
+
+std::string_view to_string(Implementation);
+} // namespace NumericKernels
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "callable.hpp"
+#include "token.hpp"
+
+struct Interpreter;
+struct Iterator;
+
+/// Base of runtime values implemented natively that are neither callables nor
+/// class instances, like modules
+struct Object {
+  [[nodiscard]] virtual std::string to_string() const = 0;
+
+  /// Property access 'object.name'. Throws a RuntimeError unless overridden
+  [[nodiscard]] virtual Token::Value get(const Token &name, Interpreter &);
+
+  /// Property assignment 'object.name = value'. Throws a RuntimeError unless
+  /// overridden
+  virtual void set(const Token &name, Token::Value value);
+
+  /// True if the object may be used from several threads at once. Shareable
+  /// objects are passed to other interpreters by reference, others are copied
+  [[nodiscard]] virtual bool is_shareable() const;
+
+  /// Iterator over the values of the object, for 'for (var value in object)'.
+  /// nullptr unless overridden
+  [[nodiscard]] virtual std::shared_ptr<Iterator> iterate();
+
+  // Base class boilerplate
+  Object() = default;
+  virtual ~Object() = default;
+  Object(const Object &) = delete;
+  Object &operator=(const Object &) = delete;
+  Object(Object &&) = delete;
+  Object &operator=(Object &&) = delete;
+};
+
+/// Object producing a sequence of values, like a generator
+struct Iterator : public Object, public std::enable_shared_from_this<Iterator> {
+  /// The next value, or nullopt once the sequence ended
+  virtual std::optional<Token::Value> next(Interpreter &) = 0;
+
+  /// Iterators iterate themselves
+  [[nodiscard]] std::shared_ptr<Iterator> iterate() override;
+};
+
+/// Method of a native object, bound to the object by the body it calls
+struct NativeMethod : public Callable {
+  using Body = std::function<Token::Value(
+      Interpreter &, const std::vector<Token::Value> &arguments)>;
+
+  NativeMethod(std::string _name, size_t _arity, Body _body);
+
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override;
+
+  [[nodiscard]] size_t arity() const override;
+
+  [[nodiscard]] std::string to_string() const override;
+
+private:
+  const std::string name;
+  const size_t m_arity;
+  Body body;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include "compilation_unit.hpp"
 #include "error.hpp"
 #include "expr.hpp"
 #include "stmt.hpp"
@@ -7,9 +8,10 @@
 #include <vector>
 
 /// Parse an collection of Token to return an AST representation of it's syntax.
-/// This is a recursive descent parser
+/// This is a recursive descent parser. Parses the tokens of a CompilationUnit,
+/// allocating the AST in the unit's arena
 struct Parser {
-  explicit Parser(std::vector<Token> _tokens,
+  explicit Parser(CompilationUnit &unit,
                   std::shared_ptr<ErrorHandler> _err_handler =
                       std::make_shared<CerrHandler>());
 
@@ -18,26 +20,36 @@ struct Parser {
   [[nodiscard]] const Token &previous() const;
 
   std::vector<stmt> parse();
+  /// Parse the statements of a body skipped by a lazy parse
+  std::vector<stmt> parse_body(const DeferredBody &deferred);
 
   std::shared_ptr<ErrorHandler> err_handler;
 
+  Arena &arena;
+
 private:
   // Statements
   stmt declaration();
   stmt var_declaration();
   stmt class_declaration();
+  stmt import_declaration();
   FunctionStmtPtr function_declaration(FunctionKind kind);
   FunctionStmtPtr getter_declaration(Token name);
   stmt statement();
   // This returns a vector so we can inspect the statements for functions and
   // classes, rather than just evaluating the value
   std::vector<stmt> block();
+  /// In lazy mode, brace-match a function body whose '{' was just consumed and
+  /// record it for parsing on first call. Returns nullptr in eager mode,
+  /// without consuming anything
+  DeferredBody *defer_body();
   stmt for_statement();
   stmt while_statement();
   stmt if_statement();
   stmt print_statement();
   stmt expression_statement();
   stmt return_statement();
+  stmt yield_statement();
 
   // Expressions
   expr expression();
@@ -58,6 +70,9 @@ private:
 
   expr finish_call(expr callee);
 
+  /// 'object[index]' or a slice 'object[start:end]', after the '['
+  expr finish_index(expr object);
+
   /// Consume the next token if it matches type, else error with message
   const Token &consume(Token::TokenType type, const std::string &message);
 
@@ -82,6 +97,9 @@ private:
   [[nodiscard]] bool check(Token::TokenType type) const;
   const Token &advance();
 
-  const std::vector<Token> tokens;
+  CompilationUnit &unit;
+  const std::vector<Token> &tokens;
   unsigned int current = 0;
+  /// Parsing stops at this token index. Bounds the parse of a deferred body
+  size_t end;
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+struct Callable;
+
+/// Sampling profiler for Lox code, enabled by 'Lox --profile=<file>'.
+/// Calls of Lox functions and classes push a frame with the callee's name and
+/// the line of the call on a shadow stack of their thread. A SIGPROF timer
+/// samples the stack of the thread using the CPU, and the samples are written
+/// at exit as folded stacks for flamegraph.pl, one line per distinct stack:
+/// 'main:20;fib:7;fib:7 42'. Native functions count as their caller
+namespace Profiler {
+/// Start sampling frequency times per second of CPU time, and write the
+/// profile to path at exit. False if the timer could not be set up
+bool start(std::string path, unsigned frequency);
+
+/// Stop sampling and write the profile. Does nothing unless started by this
+/// process
+void finish();
+
+namespace detail {
+inline std::atomic<bool> active = false;
+
+bool push(const Callable &callee, unsigned line);
+void pop();
+} // namespace detail
+
+/// Frame of a call on the shadow stack while it runs. Costs a load of a flag
+/// while the profiler is off
+struct Scope {
+  Scope(const Callable &callee, unsigned line) {
+    if (detail::active.load(std::memory_order_relaxed)) {
+      pushed = detail::push(callee, line);
+    }
+  }
+  ~Scope() {
+    if (pushed) {
+      detail::pop();
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  bool pushed = false;
+};
+} // namespace Profiler
@@ -1,39 +1,63 @@
 #pragma once
 
+#include <memory>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-#include "interpreter.hpp"
+#include "error.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
 
+/// Annotates variable uses with the depth of their declaration's scope and
+/// reports static errors. Only depends on an error handler, so units can be
+/// resolved on any thread
 struct Resolver : public ExprVisitor, public StmtVisitor {
-  explicit Resolver(Interpreter &);
+  explicit Resolver(std::shared_ptr<ErrorHandler> _err_handler);
 
   void resolve(const std::vector<stmt> &);
-  void resolve(const stmt &);
+  void resolve(Statement *);
+
+  /// Resolve a materialized deferred body in the scopes recorded when its
+  /// declaration was resolved
+  void resolve_deferred(FunctionStmt &);
+  void resolve_deferred(Lambda &);
 
 private:
   DECLARE_STMT_VISIT_METHODS
 
   DECLARE_EXPR_VISIT_METHODS
 
-  void resolve(const expr &);
   void resolve(Expr *);
 
   void declare(const Token &identifier);
   void define(const Token &identifier);
 
-  enum class ClassKind { NONE, CLASS, SUBCLASS };
-
   void resolve_local(Expr &node, const Token &identifier);
+  /// Annotate a Get or Set of a field of 'this' in a record class
+  void resolve_field(FieldAccess &node, Expr *object, const Token &name);
+  /// Deferred bodies that are not yet materialized only get the current
+  /// scopes recorded
   void resolve_function(const std::vector<Token> &params,
-                        const std::vector<stmt> &body, FunctionKind);
+                        const std::vector<stmt> &body, FunctionKind,
+                        DeferredBody *deferred);
 
-  Interpreter &interpreter;
+  std::shared_ptr<ErrorHandler> err_handler;
 
   // The bool represents whether the variable is initialized
   std::vector<std::unordered_map<std::string, bool>> scopes;
 
   std::optional<FunctionKind> function_kind = std::nullopt;
   ClassKind class_kind = ClassKind::NONE;
+  /// Fields of the record class whose methods are resolved. 'this.field' in
+  /// them is resolved to the index of the field
+  const std::vector<Token> *record_fields = nullptr;
 
   bool function_needs_return = false;
+
+  /// Statements around the one being resolved, innermost last. Those of the
+  /// current function start at index function_statements
+  std::vector<Statement *> enclosing_statements;
+  size_t function_statements = 0;
 };
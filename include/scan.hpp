@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string_view>
+
+/// Bulk character-class scanning used by the Lexer.
+/// Every function scans the half-open range [first, last) and returns a
+/// pointer to the first character that stops the scan, or last. The
+/// SSE2/AVX2 implementations process 16/32 bytes per step and are selected at
+/// runtime based on the CPU. The scalar implementation defines the behavior.
+namespace Scan {
+enum class Implementation { SCALAR, SSE2, AVX2 };
+
+/// Skip ' ', '\t', '\r' and '\n'. Newlines skipped are added to newlines
+const char *skip_whitespace(const char *first, const char *last,
+                            unsigned int &newlines);
+
+/// Skip [A-Za-z0-9], the characters that may continue an identifier
+const char *skip_identifier(const char *first, const char *last);
+
+/// Skip [0-9]
+const char *skip_digits(const char *first, const char *last);
+
+/// Find the first occurrence of c. Newlines before it are added to newlines
+const char *find(const char *first, const char *last, char c,
+                 unsigned int &newlines);
+
+/// Find the first '\n' (for line comments)
+const char *find_newline(const char *first, const char *last);
+
+/// Best implementation the current CPU supports
+Implementation best_implementation();
+
+/// Implementation used by the functions above. Defaults to the best one
+Implementation active_implementation();
+
+/// Select an implementation, e.g. for benchmarking the scalar fallback.
+/// Requesting an unsupported implementation selects the best supported one
+void set_implementation(Implementation);
+
+std::string_view to_string(Implementation);
+} // namespace Scan
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include "compilation_unit.hpp"
+
+/// On-disk cache of compiled scripts. Each entry is a .loxc file holding the
+/// resolved AST of one source text, keyed by a hash of the source and the
+/// interpreter build, see build_id(). A hit rebuilds the CompilationUnit without running
+/// the lexer, parser or resolver.
+/// Stale or corrupt entries are detected on load and ignored.
+struct ScriptCache {
+  explicit ScriptCache(std::filesystem::path _directory);
+
+  /// LOX_CACHE_DIR if set, else $XDG_CACHE_HOME/lox or ~/.cache/lox.
+  /// nullopt if caching is disabled by an empty LOX_CACHE_DIR or no directory
+  /// can be determined
+  static std::optional<std::filesystem::path> default_directory();
+
+  /// The cached unit for source, or nullptr on a miss
+  [[nodiscard]] CompilationUnitPtr load(std::string_view source) const;
+
+  /// Cache an eagerly compiled unit for source. Failures are only logged
+  void store(std::string_view source, const CompilationUnit &unit) const;
+
+  [[nodiscard]] std::filesystem::path entry_path(std::string_view source) const;
+
+private:
+  std::filesystem::path directory;
+};
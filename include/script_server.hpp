@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "compilation_unit.hpp"
+#include "logging.hpp"
+
+/// Daemon behind 'Lox --serve=<socket>'. Runs scripts sent by lox_client over
+/// a Unix domain socket and streams their output back, see server_protocol.hpp.
+/// Every request runs in a fresh isolate, so requests share no globals and
+/// run concurrently. A background thread keeps isolates warmed with the
+/// prelude, if any, ahead of requests. Scripts sent by path are compiled
+/// through the ModuleCache, so unchanged scripts and modules are only
+/// compiled once
+struct ScriptServer {
+  struct Options {
+    std::filesystem::path socket;
+    /// Snapshot image loaded into every isolate
+    std::optional<std::filesystem::path> prelude;
+    /// Parse mode of scripts sent as source
+    ParseMode mode = ParseMode::LAZY;
+    /// Isolates kept ready for requests
+    size_t warm_isolates = 4;
+  };
+
+  explicit ScriptServer(Options _options);
+  ~ScriptServer();
+
+  ScriptServer(const ScriptServer &) = delete;
+  ScriptServer(ScriptServer &&) = delete;
+  ScriptServer &operator=(const ScriptServer &) = delete;
+  ScriptServer &operator=(ScriptServer &&) = delete;
+
+  /// Serve clients until the process is terminated. Returns an exit status
+  /// if the prelude can't be loaded or the socket can't be set up
+  int serve();
+
+private:
+  struct Session;
+
+  /// A warm session, or a new one if none is ready
+  std::unique_ptr<Session> take_session();
+
+  void keep_warm(const std::stop_token &stop);
+
+  /// Run the request of one client, then close its connection
+  void handle(int connection);
+
+  /// Read and run the request of one client. Its exit status, or nullopt if
+  /// the client sent no valid request
+  std::optional<int32_t> run_request(int connection);
+
+  const Options options;
+  /// Logging configuration of the thread that created the server, for all
+  /// sessions
+  const Logging::Config logging;
+
+  std::mutex mutex;
+  std::condition_variable_any taken;
+  std::deque<std::unique_ptr<Session>> warm;
+  std::jthread warmer;
+};
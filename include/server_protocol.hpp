@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// Messages between 'Lox --serve' and lox_client over a Unix domain socket.
+/// Every message is a frame: a kind byte, the payload size as a native
+/// uint32_t, then the payload. The client sends one request frame. The
+/// server answers with output frames while the script runs, and closes the
+/// connection after an exit frame
+namespace ServerProtocol {
+enum class Request : uint8_t {
+  /// Payload is the absolute path of a script
+  PATH,
+  /// Payload is the source of a script
+  SOURCE,
+};
+
+enum class Reply : uint8_t {
+  /// Payload is written to stdout
+  OUT,
+  /// Payload is written to stderr
+  ERR,
+  /// Payload is the exit status of the script as a native int32_t
+  EXIT,
+};
+
+/// Write a whole frame to fd. False if the peer is gone
+bool write_frame(int fd, uint8_t kind, std::string_view payload);
+
+/// Largest request the server reads. The size of a frame is read before its
+/// payload, and is not allocated unless it is within the limit
+constexpr uint32_t MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+
+/// Read a whole frame from fd. nullopt if the peer closed the connection, sent
+/// a partial frame or a payload larger than max_size
+std::optional<std::pair<uint8_t, std::string>>
+read_frame(int fd, uint32_t max_size = std::numeric_limits<uint32_t>::max());
+} // namespace ServerProtocol
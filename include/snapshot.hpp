@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+
+struct Interpreter;
+
+/// A snapshot is an image of the global scope of an interpreter, usually taken
+/// after running a prelude. Loading it into a fresh interpreter restores the
+/// globals and the functions, classes, instances and modules reachable from
+/// them, without running the code that created them.
+///
+/// Functions are stored as a reference into the AST of their compilation unit,
+/// which is stored in the image too. Builtins are stored by name. Modules are
+/// stored as values, but a later import of the same path runs the module again.
+/// Like the script cache, images are only readable by the same build.
+
+/// Write the globals of interpreter to an image at path. Returns false if the
+/// image can't be written. Throws a RuntimeError if a global refers to a value
+/// that can't be stored, like a function of a lazily parsed script
+bool save_snapshot(const Interpreter &interpreter,
+                   const std::filesystem::path &path);
+
+/// Define the globals stored in the image at path in interpreter, replacing
+/// globals of the same name. Returns false, leaving the globals unchanged, if
+/// the image can't be read, is corrupt or was written by another build
+[[nodiscard]] bool load_snapshot(Interpreter &interpreter,
+                                 const std::filesystem::path &path);
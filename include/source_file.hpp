@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/// Read-only contents of a source file.
+/// Regular files are memory mapped, so they can be lexed without copying them
+/// into memory first. Pipes, devices and stdin (path "-") fall back to reading
+/// into a buffer.
+struct SourceFile {
+  explicit SourceFile(const std::filesystem::path &path);
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  SourceFile(SourceFile &&) noexcept;
+  SourceFile &operator=(SourceFile &&) noexcept;
+  ~SourceFile();
+
+  /// Whether the file could be opened and read
+  [[nodiscard]] bool is_open() const;
+  explicit operator bool() const;
+
+  /// Valid as long as this SourceFile is alive
+  [[nodiscard]] std::string_view contents() const;
+
+  [[nodiscard]] bool is_mapped() const;
+
+private:
+  void read_from(int fd);
+  void unmap();
+
+  const char *mapping = nullptr;
+  size_t mapping_size = 0;
+
+  std::string buffer; // Used when the file can't be mapped
+  bool open = false;
+};
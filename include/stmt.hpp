@@ -1,6 +1,9 @@
 #pragma once
 #include "expr.hpp"
 #include "visitor.hpp"
+#include <atomic>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 struct Statement {
@@ -12,8 +15,12 @@ struct Statement {
   Statement &operator=(const Statement &) = default;
 
   virtual void print(std::ostream &os) const = 0;
+
+  // Set by the resolver on statements that contain a 'yield' of their
+  // function. Generators execute the others without suspension points
+  bool suspends = false;
 };
-using stmt = std::unique_ptr<Statement>;
+using stmt = Statement *;
 
 template <int id, typename... Types> struct StmtProduction;
 
@@ -26,10 +33,34 @@ enum class FunctionKind {
   GETTER,
 };
 
+enum class ClassKind { NONE, CLASS, SUBCLASS };
+
 std::string str(FunctionKind);
 
 std::ostream &operator<<(std::ostream &, FunctionKind);
 
+struct CompilationUnit;
+
+/// A function or lambda body that a lazy parse only brace-matched. It is parsed
+/// and resolved on the first call of the function, see materialize()
+struct DeferredBody {
+  CompilationUnit *unit;
+  /// Token indices of the body's opening and matching closing brace
+  size_t open;
+  size_t close;
+  unsigned int line;
+
+  /// Resolver state at the declaration, recorded when it was resolved
+  std::vector<std::unordered_map<std::string, bool>> scopes{};
+  ClassKind class_kind = ClassKind::NONE;
+  const std::vector<Token> *record_fields = nullptr;
+
+  /// Set once the body is parsed and resolved. Written under the unit's
+  /// materialize_mutex, read without it by every call
+  std::atomic<bool> materialized = false;
+  bool has_errors = false;
+};
+
 // clang-format off
 using PrintStmt = StmtProduction<0, expr>;                                                                 // expression (for printing)
 using ExprStmt = StmtProduction<1, expr>;                                                                  // expression
@@ -39,15 +70,19 @@ using BlockStmt = StmtProduction<4, std::vector<stmt>>;
 using IfStmt = StmtProduction<5, expr, stmt, stmt>;                                                        //	condition then-stmt	else-stmt
 using EmptyStmt = StmtProduction<6>;
 using WhileStmt = StmtProduction<7, expr, stmt>;                                                           //	cond body
-using FunctionStmt = StmtProduction<8, Token, std::vector<Token>, std::vector<stmt>, FunctionKind>;        // name params body kind
+using FunctionStmt = StmtProduction<8, Token, std::vector<Token>, std::vector<stmt>, FunctionKind, DeferredBody *>; // name params body kind deferred_body
 using ReturnStmt = StmtProduction<9, Token, expr>;                                                         // 'return' body
-using FunctionStmtPtr = std::unique_ptr<FunctionStmt>;        
-using ClassStmt = StmtProduction<10, Token, std::vector<FunctionStmtPtr>, VarPtr>;                         // name methods superclass
+using FunctionStmtPtr = FunctionStmt *;
+using ClassStmt = StmtProduction<10, Token, std::vector<FunctionStmtPtr>, VarPtr, std::vector<Token>>;     // name methods superclass fields (empty if not a record)
+using ImportStmt = StmtProduction<11, Token, std::string, Token>;                                          // 'import' path name
+using YieldStmt = StmtProduction<12, Token, expr>;                                                         // 'yield' value
+using ForInStmt = StmtProduction<13, Token, Token, expr, stmt>;                                            // 'for' name iterable body
 // clang-format on
 
 #define STMT_TYPES                                                             \
   PrintStmt, ExprStmt, VarStmt, MalformedStmt, BlockStmt, IfStmt, EmptyStmt,   \
-      WhileStmt, FunctionStmt, ReturnStmt, ClassStmt
+      WhileStmt, FunctionStmt, ReturnStmt, ClassStmt, ImportStmt, YieldStmt,   \
+      ForInStmt
 
 template <int id, typename... Types>
 using StmtProductionVisitableImpl =
@@ -93,16 +128,19 @@ struct StmtProduction : public Statement,
   void visit(EmptyStmt &) override;                                            \
   void visit(FunctionStmt &) override;                                         \
   void visit(ReturnStmt &) override;                                           \
-  void visit(ClassStmt &) override;
+  void visit(ClassStmt &) override;                                            \
+  void visit(ImportStmt &) override;                                           \
+  void visit(YieldStmt &) override;                                            \
+  void visit(ForInStmt &) override;
 
 std::ostream &operator<<(std::ostream &os, const Statement &rhs);
 
-std::ostream &operator<<(std::ostream &os, const stmt &rhs);
+std::ostream &operator<<(std::ostream &os, const Statement *rhs);
 std::ostream &operator<<(std::ostream &os,
                          const std::vector<FunctionStmtPtr> &rhs);
 std::ostream &operator<<(std::ostream &os, const std::vector<stmt> &rhs);
 
 template <typename Type, typename... arg_types>
-stmt new_stmt(arg_types &&... args) {
-  return std::make_unique<Type>(std::forward<arg_types>(args)...);
+stmt new_stmt(Arena &arena, arg_types &&... args) {
+  return arena.create<Type>(std::forward<arg_types>(args)...);
 }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "token.hpp"
+
+/// Bound method name of string, for 'string.name(...)'. Strings are sequences
+/// of bytes:
+/// indexOf(sub) and lastIndexOf(sub) are the index of the first and last
+/// occurrence of sub, or -1. split(separator) returns an array of the parts
+/// between separators, or of the characters if separator is "". charCodeAt(i)
+/// is the byte at index i as a number from 0 to 255.
+/// Throws a RuntimeError at name for other names
+Token::Value string_method(std::string string, const Token &name);
+
+/// Arity of the string method name. Throws a RuntimeError at name for other
+/// names
+size_t string_method_arity(const Token &name);
+
+/// Call the string method name on string without binding it first, for
+/// 'string.name(...)' calls. arguments must match the arity
+Token::Value call_string_method(const std::string &string, const Token &name,
+                                const std::vector<Token::Value> &arguments);
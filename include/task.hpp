@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "error.hpp"
+#include "object.hpp"
+
+/// Result of a function run on the thread pool by spawn(). The function is
+/// deep copied into the heap of a fresh interpreter for the task, so tasks
+/// never share mutable values with the spawner or each other. Prints of a task
+/// are buffered by the future, and written to the output stream of the first
+/// interpreter that awaits it: the spawner may be gone by the time the task
+/// prints, like the session of a script server whose client left.
+/// Futures are shareable: any interpreter can wait for one, and gets its own
+/// copy of the result
+struct Future : public Object, public std::enable_shared_from_this<Future> {
+  /// Run callable, which takes no arguments, on the thread pool
+  static std::shared_ptr<Future> spawn(Interpreter &interpreter,
+                                       const CallablePtr &callable);
+
+  /// Wait for the task, running other tasks meanwhile, and copy its result
+  /// into the heap of interpreter. Throws a RuntimeError if the task failed
+  Token::Value await(Interpreter &interpreter);
+
+  [[nodiscard]] std::string to_string() const override;
+
+  /// The 'get()' method, same as await(), and the 'done' property
+  [[nodiscard]] Token::Value get(const Token &name, Interpreter &) override;
+
+  [[nodiscard]] bool is_shareable() const override;
+
+private:
+  void run(const CallablePtr &callable);
+
+  /// Output of the task. Declared first, as interpreter writes to it
+  std::ostringstream output;
+  /// Owns the heap of the task and its result
+  std::shared_ptr<Interpreter> interpreter;
+  std::shared_ptr<BufferedErrorHandler> diagnostics;
+
+  /// Set when the task finished. result and error are written before and only
+  /// read after
+  std::atomic<bool> finished = false;
+  Token::Value result;
+  std::optional<std::string> error;
+
+  /// Set once output and diagnostics were written for an awaiting interpreter
+  std::atomic<bool> reported = false;
+};
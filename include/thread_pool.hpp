@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/// Work-stealing thread pool. Every worker has its own deque of tasks: it runs
+/// its newest task first, and steals the oldest task of another worker when it
+/// runs out. Tasks submitted by a worker go to its own deque, so the subtasks
+/// of a divide-and-conquer task stay on the worker unless others are idle.
+/// Tasks submitted from outside the pool are spread round-robin
+struct ThreadPool {
+  using Task = std::function<void()>;
+
+  /// Process-wide pool with one worker per core, or $LOX_THREADS workers
+  static ThreadPool &instance();
+
+  explicit ThreadPool(size_t worker_count);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  /// Queue a task. Tasks must not throw. They run with the logging
+  /// configuration of the submitting thread
+  void submit(Task task);
+
+  /// Block until done() returns true, running queued tasks on this thread in
+  /// the meantime, so workers waiting for subtasks don't starve the pool.
+  /// Call notify() whenever done() may have become true
+  void wait_until(const std::function<bool()> &done);
+
+  /// Block until done() returns true without running other tasks, for waits
+  /// on events that queued tasks may have to produce. While a pool thread is
+  /// blocked a spare thread runs tasks in its place. Returns false instead if
+  /// the pool shuts down first. Call notify() whenever done() may have become
+  /// true
+  [[nodiscard]] bool block_until(const std::function<bool()> &done);
+
+  /// Wake threads in wait_until() and block_until() to check their condition
+  /// again
+  void notify();
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  /// Pop the newest task of worker index, else steal the oldest task of
+  /// another worker. index is size() for threads outside the pool
+  std::optional<Task> take(size_t index);
+
+  void run_worker(const std::stop_token &stop, size_t index);
+
+  /// Run tasks until no more threads are blocked than there are spares
+  void run_spare(const std::stop_token &stop, bool &retired);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<size_t> next_worker{0};
+
+  /// Tasks submitted but not taken yet
+  std::atomic<size_t> queued{0};
+  std::mutex sleep_mutex;
+  std::condition_variable_any wake;
+
+  /// Guarded by sleep_mutex
+  bool stopping = false;
+  size_t blocked = 0;
+  size_t spare_count = 0;
+  /// Spares that retired are joined and removed when the next one starts
+  std::list<std::pair<std::jthread, bool>> spares;
+
+  std::vector<std::jthread> threads;
+};
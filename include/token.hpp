@@ -2,6 +2,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -14,11 +15,13 @@ struct Callable;
 struct Class;
 struct Function;
 struct Instance;
+struct Object;
 
 using InstancePtr = std::shared_ptr<Instance>;
 using CallablePtr = std::shared_ptr<Callable>;
 using FunctionPtr = std::shared_ptr<Function>;
 using ClassPtr = std::shared_ptr<Class>;
+using ObjectPtr = std::shared_ptr<Object>;
 
 std::ostream &operator<<(std::ostream &os, const NullType &rhs);
 
@@ -29,6 +32,8 @@ struct Token {
     RIGHT_PAREN,
     LEFT_BRACE,
     RIGHT_BRACE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
     COMMA,
     DOT,
     MINUS,
@@ -73,12 +78,14 @@ struct Token {
     VAR,
     WHILE,
     UNBOUND, // For methods that aren't bound (static methods)
+    IMPORT,
+    YIELD,
 
     EOF_
   };
 
   using Value = std::variant<double, std::string, NullType, bool, CallablePtr,
-                             InstancePtr>;
+                             InstancePtr, ObjectPtr>;
 
   Token(TokenType _type, std::string _lexeme, Value _value, unsigned int _line);
 
@@ -88,6 +95,18 @@ struct Token {
   const unsigned int line;
 };
 
+/// Compact stand-in for an operator Token in the AST: its type and line.
+/// The lexeme follows from the type
+struct Operator {
+  Token::TokenType type;
+  unsigned int line;
+};
+
+/// Fixed spelling of operators and keywords. Empty for identifiers & literals
+std::string_view lexeme(Token::TokenType type);
+
+std::ostream &operator<<(std::ostream &os, const Operator &op);
+
 std::ostream &operator<<(std::ostream &os, const Token &t);
 
 std::ostream &operator<<(std::ostream &os, const Token::Value &value);
@@ -107,4 +126,13 @@ std::shared_ptr<T> get_callable_as(const Token::Value &value) {
     }
   }
   return nullptr;
-}
\ No newline at end of file
+}
+
+/// The native object held by value if it is a T, else nullptr. Valid while
+/// value holds the object
+template <typename T> T *get_object_as(const Token::Value &value) {
+  if (const auto *object = std::get_if<ObjectPtr>(&value)) {
+    return dynamic_cast<T *>(object->get());
+  }
+  return nullptr;
+}
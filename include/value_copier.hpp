@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "token.hpp"
+
+struct Array;
+struct Class;
+struct Environment;
+struct Function;
+struct Instance;
+struct Interpreter;
+struct Map;
+struct Module;
+
+/// Deep copies values from the heap of one interpreter into another, e.g. to
+/// pass a closure to a task on another thread. Copies everything a value
+/// reaches: closures and the scopes they enclose, classes, instances, arrays,
+/// Float64Arrays, maps and modules. Builtins map to the target's builtins of the same name, and
+/// compilation units are shared. Objects that are safe to use from several
+/// threads are shared instead of copied.
+/// Values reached more than once are copied once, so cycles and aliasing
+/// survive the copy. Throws a RuntimeError for values that can't be copied
+struct ValueCopier {
+  enum class GlobalScope {
+    /// Copy the global variables of the source into the target's globals, for
+    /// a target that didn't run any code yet
+    COPY,
+    /// Functions using the source's global scope use the target's instead,
+    /// which is left as is. For results copied back to the interpreter the
+    /// source's globals were copied from
+    MAP,
+  };
+
+  ValueCopier(const Interpreter &_from, Interpreter &_to, GlobalScope _globals);
+
+  [[nodiscard]] Token::Value copy(const Token::Value &value);
+
+private:
+  const Interpreter &from;
+  Interpreter &to;
+  const GlobalScope globals;
+
+  /// Builtins of to by the address of the builtin of from with the same name
+  std::unordered_map<const Callable *, CallablePtr> builtins;
+
+  /// Copies of the callables, instances and objects copied so far, by address
+  /// of the original
+  std::unordered_map<const void *, Token::Value> values;
+  std::unordered_map<const Environment *, std::shared_ptr<Environment>>
+      environments;
+
+  /// Copies whose variables or fields are still to be copied. Filled in
+  /// iteratively rather than recursively, so long chains of instances don't
+  /// exhaust the stack
+  std::vector<std::pair<const Environment *, Environment *>>
+      pending_environments;
+  std::vector<std::pair<const Instance *, Instance *>> pending_instances;
+  std::vector<std::pair<const Array *, Array *>> pending_arrays;
+  std::vector<std::pair<const Map *, Map *>> pending_maps;
+
+  Token::Value copy_shallow(const Token::Value &value);
+  void copy_pending();
+
+  std::shared_ptr<Environment> copy(const Environment *environment);
+  CallablePtr copy(const CallablePtr &callable);
+  std::shared_ptr<Function> copy(const Function &function);
+  std::shared_ptr<Class> copy(const Class &klass);
+  InstancePtr copy(const Instance &instance);
+  ObjectPtr copy(const ObjectPtr &object);
+};
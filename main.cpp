@@ -1,67 +1,59 @@
+#include <cstdlib>
 #include <filesystem>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <sstream>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "compilation_unit.hpp"
 #include "error.hpp"
-#include "expr.hpp"
+#include "instrumentation.hpp"
 #include "interpreter.hpp"
-#include "lexer.hpp"
 #include "logging.hpp"
-#include "parser.hpp"
-#include "resolver.hpp"
-
-static void log_tokens(const std::vector<Token> &tokens) {
-  LOG_DEBUG("\nTokens after parse:");
-
-  for (const auto &t : tokens) {
-    LOG_DEBUG("\t", t);
-  }
-
-  LOG_DEBUG("\n");
-}
-
-static std::vector<stmt>
-run(const std::string &source, const std::shared_ptr<ErrorHandler> &err_handler,
+#include "module.hpp"
+#include "profiler.hpp"
+#include "script_cache.hpp"
+#include "script_server.hpp"
+#include "snapshot.hpp"
+#include "source_file.hpp"
+
+static CompilationUnitPtr
+run(Interpreter &interpreter, std::string_view source,
+    const std::shared_ptr<ErrorHandler> &err_handler, ParseMode mode,
+    const ScriptCache *cache = nullptr,
     std::optional<std::string> maybe_filename = std::nullopt) {
-  static Interpreter interpreter{std::cout, err_handler};
-
   if (maybe_filename.has_value()) {
     interpreter.interpreter_path =
         std::filesystem::path(*maybe_filename).remove_filename().string();
   }
 
-  Lexer lexer{source, err_handler};
-  std::vector<Token> tokens = lexer.lex();
-
-  if (err_handler->has_error()) {
-    return {};
-  }
-
-  Parser parser{tokens, err_handler};
-  std::vector<stmt> statements = parser.parse();
-
-  log_tokens(tokens);
-
-  if (err_handler->has_error()) {
-    return {};
+  auto unit = cache != nullptr ? cache->load(source) : nullptr;
+  if (unit == nullptr) {
+    // Cached units must be complete, so they are always compiled eagerly
+    unit = compile(source, err_handler,
+                   cache != nullptr ? ParseMode::EAGER : mode);
+    if (unit == nullptr) {
+      return nullptr;
+    }
+    if (cache != nullptr) {
+      cache->store(source, *unit);
+    }
   }
-
-  Resolver resolver{interpreter};
-  resolver.resolve(statements);
-
-  if (err_handler->has_error()) {
-    return {};
+  if (maybe_filename.has_value() && *maybe_filename != "-") {
+    unit->path = *maybe_filename; // Imports are relative to the script
   }
 
   try {
-    interpreter.interpret(statements);
+    interpreter.interpret(*unit);
+    // The script has finished once no timer, read or watch is left
+    if (!err_handler->has_runtime_error()) {
+      interpreter.run_event_loop();
+    }
 
     if (err_handler->has_runtime_error()) {
-      return {};
+      return nullptr;
     }
   } catch (const Exit &e) {
     LOG_INFO("Interpretation terminated: ", e.what());
@@ -70,16 +62,13 @@ run(const std::string &source, const std::shared_ptr<ErrorHandler> &err_handler,
 
   Logging::newline(Logging::LogLevel::DEBUG);
 
-  return statements;
+  return unit;
 }
 
-static int run_prompt(const std::shared_ptr<ErrorHandler> &err_handler) {
+static int run_prompt(Interpreter &interpreter,
+                      const std::shared_ptr<ErrorHandler> &err_handler) {
   std::string line{};
 
-  // Save statements so the AST of previous prompt inputs stays alive. Required
-  // for proper handling of function declarations across input lines
-  std::vector<stmt> run_statements;
-
   while (true) {
     std::cout << "> ";
     std::getline(std::cin, line);
@@ -87,27 +76,33 @@ static int run_prompt(const std::shared_ptr<ErrorHandler> &err_handler) {
       return 0;
     }
 
-    auto newly_run_statements = run(line, err_handler);
-    run_statements.insert(run_statements.end(),
-                          std::make_move_iterator(newly_run_statements.begin()),
-                          std::make_move_iterator(newly_run_statements.end()));
+    // Functions declared on this line keep its unit alive for later lines
+    run(interpreter, line, err_handler, ParseMode::EAGER);
 
     err_handler->reset_error();
   }
 }
 
-static int run_file(const char *filename,
-                    const std::shared_ptr<ErrorHandler> &err_handler) {
-  std::ifstream ifstr(filename);
-  std::stringstream ss{};
-  ss << ifstr.rdbuf();
+static int run_file(Interpreter &interpreter, const char *filename,
+                    const std::shared_ptr<ErrorHandler> &err_handler,
+                    ParseMode mode, bool use_cache) {
+  // Lexed directly from the mapped file. "-" reads the script from stdin
+  const SourceFile source{filename};
 
-  if (!ifstr) {
+  if (!source) {
     LOG_ERROR("File ", filename, " could not be opened");
     return 42;
   }
 
-  run(ss.str(), err_handler, filename);
+  std::optional<ScriptCache> cache;
+  if (auto directory = ScriptCache::default_directory();
+      use_cache && directory.has_value()) {
+    cache.emplace(std::move(*directory));
+    ModuleCache::instance().set_script_cache(cache);
+  }
+
+  run(interpreter, source.contents(), err_handler, mode,
+      cache ? &*cache : nullptr, filename);
   if (err_handler->has_error()) {
     return 65;
   }
@@ -120,15 +115,108 @@ static int run_file(const char *filename,
 int main(int argc, char *argv[]) {
   (void)std::setprecision(3);
   Logging::set_log_level(Logging::LogLevel::ERROR);
-  if (argc > 2) {
-    std::cout << "Usage: Lox [script]";
+
+  // Scripts parse function bodies lazily on first call unless --eager is
+  // given, which reports all syntax errors before execution. --cache keeps
+  // scripts compiled on disk, which compiles them eagerly.
+  // --snapshot=<image> saves the globals after running the script, to start
+  // later runs from them with --prelude=<image>. --serve=<socket> runs
+  // scripts sent by lox_client instead, starting each from the prelude.
+  // --profile=<file> samples the Lox call stack --profile-hz times per second
+  // and writes folded stacks to the file at exit
+  ParseMode mode = ParseMode::LAZY;
+  bool use_cache = false;
+  const char *script = nullptr;
+  std::optional<std::string_view> snapshot;
+  std::optional<std::string_view> prelude;
+  std::optional<std::string_view> serve;
+  std::optional<std::string_view> profile;
+  unsigned profile_hz = 999; // Not a divisor of common timer periods
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg == "--eager") {
+      mode = ParseMode::EAGER;
+    } else if (arg == "--cache") {
+      use_cache = true;
+    } else if (arg == "--no-cache") {
+      use_cache = false;
+    } else if (arg.starts_with("--snapshot=")) {
+      snapshot = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--prelude=")) {
+      prelude = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--serve=")) {
+      serve = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--profile=")) {
+      profile = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--profile-hz=")) {
+      profile_hz = std::strtoul(argv[i] + arg.find('=') + 1, nullptr, 10);
+    } else if (script == nullptr && (arg == "-" || !arg.starts_with("--"))) {
+      script = argv[i];
+    } else {
+      std::cout << "Usage: Lox [--eager] [--cache] [--prelude=<image>] "
+                   "[--snapshot=<image> script] [--serve=<socket>] "
+                   "[--profile=<file> [--profile-hz=<n>]] [script]";
+      return 64;
+    }
+  }
+  if (snapshot.has_value() && script == nullptr) {
+    std::cout << "--snapshot requires a script";
     return 64;
   }
 
+  if constexpr (Instrumentation::enabled) {
+    std::atexit(Instrumentation::report);
+  }
+
+  if (profile.has_value() && !Profiler::start(std::string{*profile},
+                                                profile_hz)) {
+    std::cout << "Profiler could not be started";
+    return 64;
+  }
+
+  if (serve.has_value()) {
+    if (script != nullptr || snapshot.has_value()) {
+      std::cout << "--serve takes scripts from clients only";
+      return 64;
+    }
+    if (auto directory = ScriptCache::default_directory();
+        use_cache && directory.has_value()) {
+      ModuleCache::instance().set_script_cache(
+          ScriptCache{std::move(*directory)});
+    }
+    std::optional<std::filesystem::path> image;
+    if (prelude.has_value()) {
+      image = *prelude;
+    }
+    ScriptServer server{{*serve, std::move(image), mode}};
+    return server.serve();
+  }
+
   auto err_handler{std::make_shared<CerrHandler>()};
+  Interpreter interpreter{std::cout, err_handler};
+
+  if (prelude.has_value() && !load_snapshot(interpreter, *prelude)) {
+    LOG_ERROR("Snapshot ", *prelude, " could not be loaded");
+    return 66;
+  }
+
+  if (snapshot.has_value()) {
+    // Functions in a snapshot refer to their AST, so nothing is left unparsed
+    const int status =
+        run_file(interpreter, script, err_handler, ParseMode::EAGER, use_cache);
+    if (status != 0) {
+      return status;
+    }
+    try {
+      return save_snapshot(interpreter, *snapshot) ? 0 : 73;
+    } catch (const RuntimeError &e) {
+      LOG_ERROR(e.what());
+      return 70;
+    }
+  }
 
-  if (argc == 2) {
-    return run_file(argv[1], err_handler);
+  if (script != nullptr) {
+    return run_file(interpreter, script, err_handler, mode, use_cache);
   }
-  return run_prompt(err_handler);
+  return run_prompt(interpreter, err_handler);
 }
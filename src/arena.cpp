@@ -0,0 +1,33 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::~Arena() {
+  for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+    it->destroy(it->object);
+  }
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+  auto address = reinterpret_cast<std::uintptr_t>(cursor);
+  auto aligned = (address + alignment - 1) & ~(alignment - 1);
+
+  if (cursor == nullptr ||
+      aligned + size > reinterpret_cast<std::uintptr_t>(block_end)) {
+    // Oversized objects get a block of their own
+    const size_t block_size = std::max(BLOCK_SIZE, size + alignment);
+    blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+    cursor = blocks.back().get();
+    block_end = cursor + block_size;
+
+    address = reinterpret_cast<std::uintptr_t>(cursor);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+
+  cursor = reinterpret_cast<std::byte *>(aligned + size);
+  used += size;
+  return reinterpret_cast<void *>(aligned);
+}
+
+size_t Arena::bytes_used() const { return used; }
@@ -0,0 +1,148 @@
+#include "array.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "error.hpp"
+
+namespace {
+/// An index or slice bound as an integer in [0, limit]
+size_t checked_position(const Token::Value &value, size_t limit,
+                        const Operator &bracket, const char *what) {
+  const auto *number = std::get_if<double>(&value);
+  if (number == nullptr || std::trunc(*number) != *number) {
+    throw RuntimeError(bracket, std::string{what} + " must be an integer, got " +
+                                    stringify(value));
+  }
+  if (*number < 0 || *number > static_cast<double>(limit)) {
+    throw RuntimeError(bracket, std::string{what} + " " + stringify(value) +
+                                    " is out of bounds for length " +
+                                    std::to_string(limit));
+  }
+  return static_cast<size_t>(*number);
+}
+
+/// Iterates the array live, so elements pushed meanwhile are visited too
+struct ArrayIterator : public Iterator {
+  explicit ArrayIterator(ArrayPtr _array) : array(std::move(_array)) {}
+
+  std::optional<Token::Value> next(Interpreter &) override {
+    if (position >= array->elements.size()) {
+      return std::nullopt;
+    }
+    return array->elements[position++];
+  }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Array iterator>";
+  }
+
+private:
+  ArrayPtr array;
+  size_t position = 0;
+};
+
+/// Arrays being converted to strings by this thread, to print cycles as
+/// '[...]'
+thread_local std::vector<const Array *> printing;
+} // namespace
+
+size_t checked_index(const Token::Value &index, size_t size,
+                     const Operator &bracket) {
+  const auto position = checked_position(index, size, bracket, "Index");
+  if (position == size) {
+    throw RuntimeError(bracket, "Index " + stringify(index) +
+                                    " is out of bounds for length " +
+                                    std::to_string(size));
+  }
+  return position;
+}
+
+std::pair<size_t, size_t> checked_range(const Token::Value &start,
+                                        const Token::Value &end, size_t size,
+                                        const Operator &bracket) {
+  const auto first = std::holds_alternative<NullType>(start)
+                         ? 0
+                         : checked_position(start, size, bracket, "Slice start");
+  const auto last = std::holds_alternative<NullType>(end)
+                        ? size
+                        : checked_position(end, size, bracket, "Slice end");
+  if (first > last) {
+    throw RuntimeError(bracket, "Slice start " + std::to_string(first) +
+                                    " is after its end " +
+                                    std::to_string(last));
+  }
+  return {first, last};
+}
+
+Array::Array(std::vector<Token::Value> _elements)
+    : elements(std::move(_elements)) {}
+
+Token::Value &Array::at(const Token::Value &index, const Operator &bracket) {
+  return elements[checked_index(index, elements.size(), bracket)];
+}
+
+ArrayPtr Array::slice(const Token::Value &start, const Token::Value &end,
+                      const Operator &bracket) const {
+  const auto [first, last] =
+      checked_range(start, end, elements.size(), bracket);
+  return std::make_shared<Array>(std::vector<Token::Value>(
+      elements.begin() + static_cast<std::ptrdiff_t>(first),
+      elements.begin() + static_cast<std::ptrdiff_t>(last)));
+}
+
+std::string Array::to_string() const {
+  if (std::find(printing.begin(), printing.end(), this) != printing.end()) {
+    return "[...]";
+  }
+  printing.push_back(this);
+
+  std::string string = "[";
+  for (size_t i = 0; i < elements.size(); ++i) {
+    if (i > 0) {
+      string += ", ";
+    }
+    string += stringify(elements[i]);
+  }
+  printing.pop_back();
+  return string + "]";
+}
+
+Token::Value Array::get(const Token &name, Interpreter &interpreter) {
+  auto self = shared_from_this();
+  if (name.lexeme == "push") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "push", 1, [self](Interpreter &, const auto &arguments) {
+          self->elements.push_back(arguments[0]);
+          return Token::Value{NullType{}};
+        })};
+  }
+  if (name.lexeme == "pop") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "pop", 0, [self, name](Interpreter &, const auto &) {
+          if (self->elements.empty()) {
+            throw RuntimeError(name, "Can't pop from an empty array");
+          }
+          auto last = std::move(self->elements.back());
+          self->elements.pop_back();
+          return last;
+        })};
+  }
+  return Object::get(name, interpreter);
+}
+
+std::shared_ptr<Iterator> Array::iterate() {
+  return std::make_shared<ArrayIterator>(
+      shared_from_this());
+}
+
+std::string index_string(const std::string &string, const Token::Value &index,
+                         const Operator &bracket) {
+  return std::string(1, string[checked_index(index, string.size(), bracket)]);
+}
+
+std::string slice_string(const std::string &string, const Token::Value &start,
+                         const Token::Value &end, const Operator &bracket) {
+  const auto [first, last] = checked_range(start, end, string.size(), bracket);
+  return string.substr(first, last - first);
+}
@@ -0,0 +1,388 @@
+#include "ast_serializer.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "hash.hpp"
+
+namespace {
+// Bump when the encoding itself changes. Changes to the AST node types are
+// picked up by ast_schema_fingerprint() automatically
+constexpr uint32_t FORMAT_VERSION = 3;
+
+// Tag of a null child. Node tags are their index in EXPR_TYPES or STMT_TYPES
+constexpr uint8_t NULL_TAG = 0xFF;
+
+template <typename T, typename... Types> constexpr uint8_t tag_of() {
+  uint8_t tag = 0;
+  static_cast<void>(((std::is_same_v<T, Types> || (++tag, false)) || ...));
+  return tag;
+}
+
+template <typename T> struct is_vector : std::false_type {};
+template <typename T> struct is_vector<std::vector<T>> : std::true_type {};
+
+// Order of the alternatives in Token::Value
+enum class ValueTag : uint8_t { NUMBER, STRING, NIL, BOOL };
+
+struct AstWriter : public ExprVisitor, public StmtVisitor {
+  std::string out;
+  FunctionDeclarations *functions = nullptr;
+
+  DECLARE_EXPR_VISIT_METHODS
+
+  DECLARE_STMT_VISIT_METHODS
+
+  template <typename T> void put(T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  template <typename T> void write(const T &value) {
+    if constexpr (std::is_same_v<T, DeferredBody *>) {
+      assert(value == nullptr && "Deferred bodies can't be serialized");
+    } else if constexpr (std::is_pointer_v<T>) {
+      write_node(value);
+    } else if constexpr (is_vector<T>::value) {
+      put(static_cast<uint32_t>(value.size()));
+      for (const auto &element : value) {
+        write(element);
+      }
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      put(static_cast<uint32_t>(value.size()));
+      out.append(value);
+    } else if constexpr (std::is_same_v<T, Token>) {
+      write(value.type);
+      write(value.lexeme);
+      write(value.value);
+      put(value.line);
+    } else if constexpr (std::is_same_v<T, Operator>) {
+      write(value.type);
+      put(value.line);
+    } else if constexpr (std::is_same_v<T, Token::Value>) {
+      write_value(value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+      put(static_cast<uint8_t>(value));
+    } else {
+      static_assert(std::is_enum_v<T>, "Unhandled AST child type");
+      put(static_cast<std::underlying_type_t<T>>(value));
+    }
+  }
+
+  void write_value(const Token::Value &value) {
+    if (const auto *number = std::get_if<double>(&value)) {
+      put(ValueTag::NUMBER);
+      put(*number);
+    } else if (const auto *string = std::get_if<std::string>(&value)) {
+      put(ValueTag::STRING);
+      write(*string);
+    } else if (const auto *boolean = std::get_if<bool>(&value)) {
+      put(ValueTag::BOOL);
+      write(*boolean);
+    } else {
+      // Callables and instances only exist at runtime
+      assert(std::holds_alternative<NullType>(value) &&
+             "Runtime value in AST literal");
+      put(ValueTag::NIL);
+    }
+  }
+
+  template <typename Node> void write_node(const Node *node) {
+    if (node == nullptr) {
+      put(NULL_TAG);
+    } else if constexpr (std::is_base_of_v<Expr, Node>) {
+      dynamic_cast<ExprVisitableBase &>(const_cast<Node &>(*node))
+          .accept(*this);
+    } else {
+      dynamic_cast<StmtVisitableBase &>(const_cast<Node &>(*node))
+          .accept(*this);
+    }
+  }
+
+  template <typename Node> void write_production(const Node &node) {
+    if constexpr (std::is_base_of_v<Expr, Node>) {
+      put(tag_of<Node, EXPR_TYPES>());
+      put(static_cast<int32_t>(node.depth.value_or(-1)));
+      if constexpr (std::is_base_of_v<FieldAccess, Node>) {
+        put(node.field_index.has_value()
+                ? static_cast<int32_t>(*node.field_index)
+                : int32_t{-1});
+      }
+    } else {
+      put(tag_of<Node, STMT_TYPES>());
+      put(static_cast<uint8_t>(node.suspends));
+    }
+    std::apply([this](const auto &...children) { (write(children), ...); },
+               node.derivatives);
+  }
+};
+
+void AstWriter::visit(Assign &node) { write_production(node); }
+void AstWriter::visit(Logical &node) { write_production(node); }
+void AstWriter::visit(Variable &node) { write_production(node); }
+void AstWriter::visit(Empty &node) { write_production(node); }
+void AstWriter::visit(Literal &node) { write_production(node); }
+void AstWriter::visit(Unary &node) { write_production(node); }
+void AstWriter::visit(Binary &node) { write_production(node); }
+void AstWriter::visit(Ternary &node) { write_production(node); }
+void AstWriter::visit(Malformed &node) { write_production(node); }
+void AstWriter::visit(Call &node) { write_production(node); }
+void AstWriter::visit(Grouping &node) { write_production(node); }
+void AstWriter::visit(Lambda &node) {
+  write_production(node);
+  if (functions != nullptr) {
+    functions->emplace_back(&node);
+  }
+}
+void AstWriter::visit(Get &node) { write_production(node); }
+void AstWriter::visit(Set &node) { write_production(node); }
+void AstWriter::visit(ArrayLiteral &node) { write_production(node); }
+void AstWriter::visit(Index &node) { write_production(node); }
+void AstWriter::visit(IndexSet &node) { write_production(node); }
+void AstWriter::visit(Slice &node) { write_production(node); }
+void AstWriter::visit(This &node) { write_production(node); }
+void AstWriter::visit(Super &node) { write_production(node); }
+
+void AstWriter::visit(VarStmt &node) { write_production(node); }
+void AstWriter::visit(MalformedStmt &node) { write_production(node); }
+void AstWriter::visit(BlockStmt &node) { write_production(node); }
+void AstWriter::visit(PrintStmt &node) { write_production(node); }
+void AstWriter::visit(ExprStmt &node) { write_production(node); }
+void AstWriter::visit(IfStmt &node) { write_production(node); }
+void AstWriter::visit(WhileStmt &node) { write_production(node); }
+void AstWriter::visit(EmptyStmt &node) { write_production(node); }
+void AstWriter::visit(FunctionStmt &node) {
+  write_production(node);
+  if (functions != nullptr) {
+    functions->emplace_back(&node);
+  }
+}
+void AstWriter::visit(ReturnStmt &node) { write_production(node); }
+void AstWriter::visit(ClassStmt &node) { write_production(node); }
+void AstWriter::visit(ImportStmt &node) { write_production(node); }
+void AstWriter::visit(YieldStmt &node) { write_production(node); }
+void AstWriter::visit(ForInStmt &node) { write_production(node); }
+
+struct AstReader {
+  std::string_view data;
+  Arena &arena;
+  FunctionDeclarations *functions = nullptr;
+  size_t position = 0;
+
+  // Thrown on truncated or malformed data
+  struct CorruptData {};
+
+  template <typename T> T get() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (data.size() - position < sizeof(T)) {
+      throw CorruptData{};
+    }
+    T value;
+    std::memcpy(&value, data.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  size_t get_size() {
+    const auto size = get<uint32_t>();
+    if (size > data.size() - position) { // Every element takes >= 1 byte
+      throw CorruptData{};
+    }
+    return size;
+  }
+
+  template <typename T> T read() {
+    if constexpr (std::is_same_v<T, DeferredBody *>) {
+      return nullptr;
+    } else if constexpr (std::is_same_v<T, expr>) {
+      return read_node<Expr, EXPR_TYPES>();
+    } else if constexpr (std::is_same_v<T, stmt>) {
+      return read_node<Statement, STMT_TYPES>();
+    } else if constexpr (std::is_pointer_v<T>) { // A specific node type
+      using Base = std::conditional_t<
+          std::is_base_of_v<Expr, std::remove_pointer_t<T>>, expr, stmt>;
+      const auto node = read<Base>();
+      auto *typed = dynamic_cast<T>(node);
+      if (node != nullptr && typed == nullptr) {
+        throw CorruptData{};
+      }
+      return typed;
+    } else if constexpr (is_vector<T>::value) {
+      T elements;
+      const auto size = get_size();
+      elements.reserve(size);
+      for (size_t i = 0; i < size; ++i) {
+        elements.push_back(read<typename T::value_type>());
+      }
+      return elements;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      const auto size = get_size();
+      std::string string{data.substr(position, size)};
+      position += size;
+      return string;
+    } else if constexpr (std::is_same_v<T, Token>) {
+      auto type = read<Token::TokenType>();
+      auto lexeme = read<std::string>();
+      auto value = read<Token::Value>();
+      return Token{type, std::move(lexeme), std::move(value),
+                   get<unsigned int>()};
+    } else if constexpr (std::is_same_v<T, Operator>) {
+      auto type = read<Token::TokenType>();
+      return Operator{type, get<unsigned int>()};
+    } else if constexpr (std::is_same_v<T, Token::Value>) {
+      return read_value();
+    } else if constexpr (std::is_same_v<T, bool>) {
+      return get<uint8_t>() != 0;
+    } else {
+      static_assert(std::is_enum_v<T>, "Unhandled AST child type");
+      return static_cast<T>(get<std::underlying_type_t<T>>());
+    }
+  }
+
+  Token::Value read_value() {
+    switch (get<ValueTag>()) {
+    case ValueTag::NUMBER:
+      return get<double>();
+    case ValueTag::STRING:
+      return read<std::string>();
+    case ValueTag::NIL:
+      return NullType{};
+    case ValueTag::BOOL:
+      return read<bool>();
+    }
+    throw CorruptData{};
+  }
+
+  template <typename Base, typename... Nodes> Base *read_node() {
+    const auto tag = get<uint8_t>();
+    if (tag == NULL_TAG) {
+      return nullptr;
+    }
+
+    std::optional<int> depth = std::nullopt;
+    bool suspends = false;
+    if constexpr (std::is_same_v<Base, Expr>) {
+      if (const auto encoded = get<int32_t>(); encoded >= 0) {
+        depth = encoded;
+      }
+    } else {
+      suspends = read<bool>();
+    }
+
+    Base *node = nullptr;
+    uint8_t index = 0;
+    static_cast<void>(
+        ((index++ == tag && (node = read_production<Nodes>(), true)) || ...));
+    if (node == nullptr) {
+      throw CorruptData{};
+    }
+
+    if constexpr (std::is_same_v<Base, Expr>) {
+      node->depth = depth;
+    } else {
+      node->suspends = suspends;
+    }
+    return node;
+  }
+
+  template <typename Node> Node *read_production() {
+    std::optional<uint32_t> field_index = std::nullopt;
+    if constexpr (std::is_base_of_v<FieldAccess, Node>) {
+      if (const auto encoded = get<int32_t>(); encoded >= 0) {
+        field_index = static_cast<uint32_t>(encoded);
+      }
+    }
+    using Children = decltype(Node::derivatives);
+    auto *node = read_children<Node, Children>(
+        std::make_index_sequence<std::tuple_size_v<Children>>{});
+    if constexpr (std::is_base_of_v<FieldAccess, Node>) {
+      node->field_index = field_index;
+    }
+    return node;
+  }
+
+  template <typename Node, typename Children, size_t... I>
+  Node *read_children(std::index_sequence<I...>) {
+    // Braced initialization reads the children in order
+    Children children{read<std::tuple_element_t<I, Children>>()...};
+    auto *node = std::apply(
+        [this](auto &...child) {
+          return arena.create<Node>(std::move(child)...);
+        },
+        children);
+
+    // Listed after their children, in the same order as AstWriter
+    if constexpr (std::is_same_v<Node, FunctionStmt> ||
+                  std::is_same_v<Node, Lambda>) {
+      if (functions != nullptr) {
+        functions->emplace_back(node);
+      }
+    }
+    return node;
+  }
+};
+
+template <typename... Types> uint64_t hash_type_names(uint64_t hash) {
+  ((hash = fnv1a(typeid(Types).name(), hash)), ...);
+  return hash;
+}
+
+std::string write_ast(const std::vector<stmt> &statements,
+                      FunctionDeclarations *functions) {
+  AstWriter writer;
+  writer.functions = functions;
+  writer.write(statements);
+  return std::move(writer.out);
+}
+
+std::optional<std::vector<stmt>> read_ast(std::string_view data, Arena &arena,
+                                          FunctionDeclarations *functions) {
+  AstReader reader{data, arena, functions};
+  try {
+    auto statements = reader.read<std::vector<stmt>>();
+    if (reader.position != data.size()) {
+      return std::nullopt;
+    }
+    return statements;
+  } catch (const AstReader::CorruptData &) {
+    return std::nullopt;
+  }
+}
+} // namespace
+
+std::string serialize_ast(const std::vector<stmt> &statements) {
+  return write_ast(statements, nullptr);
+}
+
+std::string serialize_ast(const std::vector<stmt> &statements,
+                          FunctionDeclarations &functions) {
+  return write_ast(statements, &functions);
+}
+
+std::optional<std::vector<stmt>> deserialize_ast(std::string_view data,
+                                                 Arena &arena) {
+  return read_ast(data, arena, nullptr);
+}
+
+std::optional<std::vector<stmt>>
+deserialize_ast(std::string_view data, Arena &arena,
+                FunctionDeclarations &functions) {
+  return read_ast(data, arena, &functions);
+}
+
+uint64_t ast_schema_fingerprint() {
+  auto hash = fnv1a(std::string_view{
+      reinterpret_cast<const char *>(&FORMAT_VERSION), sizeof(FORMAT_VERSION)});
+  hash = hash_type_names<EXPR_TYPES>(hash);
+  hash = hash_type_names<STMT_TYPES>(hash);
+
+  // Adding a token type renumbers the ones after it
+  const auto token_types = static_cast<uint32_t>(Token::TokenType::EOF_);
+  return fnv1a(std::string_view{reinterpret_cast<const char *>(&token_types),
+                                sizeof(token_types)},
+               hash);
+}
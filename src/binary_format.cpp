@@ -0,0 +1,40 @@
+#include "binary_format.hpp"
+
+#include <cstring>
+
+#include "ast_serializer.hpp"
+#include "build_id.hpp"
+#include "hash.hpp"
+
+namespace {
+// Reads back differently on a machine with another byte order
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+} // namespace
+
+namespace BinaryFormat {
+FileHeader file_header(const char (&magic)[4], std::string_view payload) {
+  FileHeader header{};
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.byte_order = BYTE_ORDER_MARK;
+  header.version = build_id();
+  header.schema = ast_schema_fingerprint();
+  header.payload_size = payload.size();
+  header.payload_checksum = fnv1a(payload);
+  return header;
+}
+
+bool is_valid(const FileHeader &header, const char (&magic)[4],
+              std::string_view payload) {
+  return std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 &&
+         header.byte_order == BYTE_ORDER_MARK &&
+         header.version == build_id() &&
+         header.schema == ast_schema_fingerprint() &&
+         header.payload_size == payload.size() &&
+         header.payload_checksum == fnv1a(payload);
+}
+
+void put_string(std::string &out, std::string_view string) {
+  put(out, static_cast<uint32_t>(string.size()));
+  out.append(string);
+}
+} // namespace BinaryFormat
@@ -0,0 +1,31 @@
+#include "build_id.hpp"
+
+#include <string>
+
+#include "hash.hpp"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+#ifndef LOX_VERSION
+#define LOX_VERSION "unknown"
+#endif
+
+uint64_t build_id() {
+  static const uint64_t id = [] {
+    std::string identity = LOX_VERSION " " __DATE__ " " __TIME__;
+#ifdef __linux__
+    // Size and modification time of the executable change whenever it is
+    // linked again, also when build_id.cpp wasn't compiled again
+    struct stat executable {};
+    if (stat("/proc/self/exe", &executable) == 0) {
+      identity += ' ' + std::to_string(executable.st_size) + ' ' +
+                  std::to_string(executable.st_mtim.tv_sec) + '.' +
+                  std::to_string(executable.st_mtim.tv_nsec);
+    }
+#endif
+    return fnv1a(identity);
+  }();
+  return id;
+}
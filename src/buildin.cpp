@@ -1,19 +1,58 @@
 #include "buildin.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <filesystem>
-#include <sstream>
+#include <limits>
+#include <list>
+#include <new>
 #include <unordered_map>
 
+#include "array.hpp"
 #include "callable.hpp"
+#include "channel.hpp"
+#include "compilation_unit.hpp"
+#include "class.hpp"
 #include "error.hpp"
+#include "event_loop.hpp"
+#include "float64_array.hpp"
+#include "fork_map.hpp"
+#include "instance.hpp"
 #include "interpreter.hpp"
-#include "lexer.hpp"
 #include "logging.hpp"
-#include "parser.hpp"
-#include "resolver.hpp"
+#include "map.hpp"
+#include "source_file.hpp"
+#include "task.hpp"
 
 namespace {
+/// Origin of clockNs() and clockMs(). Close to startup, so nanoseconds stay
+/// exact in a double for about 100 days
+const auto clock_origin = std::chrono::steady_clock::now();
+
+/// Time since clock_origin in the unit of Duration, with fractions
+template <typename Duration> double since_clock_origin() {
+  return std::chrono::duration<double, typename Duration::period>(
+             std::chrono::steady_clock::now() - clock_origin)
+      .count();
+}
+
+/// Instance of a method-less native class, with the given fields. Used to
+/// return several values from a builtin
+InstancePtr
+make_record(const std::string &class_name,
+            const std::vector<std::pair<std::string, Token::Value>> &fields) {
+  auto klass = std::make_shared<Class>(class_name, nullptr,
+                                       Class::ClassFunctions{});
+  auto record = make_instance(std::move(klass));
+  for (const auto &[name, value] : fields) {
+    record->set_field(Token{Token::TokenType::IDENTIFIER, name, NullType{}, 0},
+                      value);
+  }
+  return record;
+}
+
 /// Built-in function with 0 parameters
 template <typename Closure> struct SimpleBuildin : public Callable {
 public:
@@ -71,6 +110,9 @@ public:
   }
 };
 
+/// Compiled units are kept in a bounded LRU cache keyed by source, so
+/// evaluating the same snippet repeatedly compiles it only once. Evicted units
+/// stay alive as long as functions declared by them do
 struct Eval : public Callable {
 public:
   Token::Value call(Interpreter &interpreter,
@@ -85,27 +127,20 @@ public:
           0);
     }
 
-    Lexer lexer{std::get<std::string>(source), interpreter.err_handler};
-    auto tokens = lexer.lex();
-    if (interpreter.err_handler->has_error()) {
-      return NullType{}; // Error already reported, but eval needs to be stopped
-    }
-
-    Parser parser{tokens, interpreter.err_handler};
-    auto statements = parser.parse();
-
-    if (interpreter.err_handler->has_error()) {
-      return NullType{};
-    }
-
-    Resolver resolver{interpreter};
-    resolver.resolve(statements);
-
-    if (interpreter.err_handler->has_error()) {
-      return NullType{};
+    const auto &code = std::get<std::string>(source);
+    auto unit = lookup(code);
+    if (unit == nullptr) {
+      ++misses;
+      unit = compile(code, interpreter.err_handler);
+      if (unit == nullptr) {
+        return NullType{}; // Error already reported, but eval needs to stop
+      }
+      insert(code, unit);
+    } else {
+      ++hits;
     }
 
-    interpreter.interpret(statements);
+    interpreter.interpret(*unit);
     return interpreter.last_value;
   }
 
@@ -114,6 +149,46 @@ public:
   [[nodiscard]] std::string to_string() const override {
     return "<Native fn 'eval'>";
   }
+
+  [[nodiscard]] InstancePtr stats() const {
+    return make_record("EvalStats",
+                       {{"hits", static_cast<double>(hits)},
+                        {"misses", static_cast<double>(misses)},
+                        {"evictions", static_cast<double>(evictions)},
+                        {"size", static_cast<double>(entries.size())},
+                        {"capacity", static_cast<double>(CAPACITY)}});
+  }
+
+  static constexpr size_t CAPACITY = 64;
+
+private:
+  CompilationUnitPtr lookup(const std::string &code) {
+    const auto found = index.find(code);
+    if (found == index.end()) {
+      return nullptr;
+    }
+    // Move to the front, as most recently used
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+  }
+
+  void insert(const std::string &code, CompilationUnitPtr unit) {
+    if (entries.size() == CAPACITY) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+      ++evictions;
+    }
+    entries.emplace_front(code, std::move(unit));
+    index.emplace(entries.front().first, entries.begin());
+  }
+
+  // Most recently used first. The index keys view the strings in here
+  std::list<std::pair<std::string, CompilationUnitPtr>> entries;
+  std::unordered_map<std::string_view, decltype(entries)::iterator> index;
+
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
 };
 
 struct IncludeStr : public Callable {
@@ -136,17 +211,15 @@ public:
 
     LOG_DEBUG("Requested file for includeStr(): ", file);
 
-    std::ifstream ifs{file};
-
-    std::stringstream buffer;
-    buffer << ifs.rdbuf();
+    const SourceFile source{file};
 
-    if (!ifs) {
+    if (!source) {
       throw RuntimeError(
           filename, "There was an error reading the file for includeStr()", 0);
     }
 
-    return buffer.str();
+    // The only copy: from the mapped file into the resulting Lox string
+    return std::string{source.contents()};
   }
 
   [[nodiscard]] size_t arity() const override { return 1; }
@@ -187,6 +260,513 @@ public:
     return "<Native fn 'assert'>";
   }
 };
+
+/// spawn(fn): run fn, which takes no arguments, on the thread pool
+struct Spawn : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *callable = std::get_if<CallablePtr>(&arguments[0]);
+    if (callable == nullptr || (*callable)->arity() != 0) {
+      throw RuntimeError(arguments[0],
+                         "must be a function without parameters to spawn", 0);
+    }
+    return ObjectPtr{Future::spawn(interpreter, *callable)};
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'spawn'>";
+  }
+};
+
+/// await(future): the result of a spawned function, once it finished
+struct Await : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *object = std::get_if<ObjectPtr>(&arguments[0]);
+    auto future =
+        object != nullptr ? std::dynamic_pointer_cast<Future>(*object) : nullptr;
+    if (future == nullptr) {
+      throw RuntimeError(arguments[0], "must be a future returned by spawn()",
+                         0);
+    }
+    return future->await(interpreter);
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'await'>";
+  }
+};
+
+/// Channel(capacity): a channel holding up to capacity messages
+struct MakeChannel : public Callable {
+public:
+  Token::Value call(Interpreter &,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *capacity = std::get_if<double>(&arguments[0]);
+    // Also false for NaN
+    if (capacity == nullptr ||
+        !(*capacity >= 1 && *capacity <= MAX_CAPACITY) ||
+        std::floor(*capacity) != *capacity) {
+      throw RuntimeError(arguments[0],
+                         "must be an integer channel capacity in 1 to " +
+                             std::to_string(MAX_CAPACITY),
+                         0);
+    }
+    try {
+      return ObjectPtr{
+          std::make_shared<Channel>(static_cast<size_t>(*capacity))};
+    } catch (const std::bad_alloc &) {
+      throw RuntimeError(arguments[0],
+                         "is too large a capacity, out of memory", 0);
+    }
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'Channel'>";
+  }
+
+private:
+  /// The cells of a channel are allocated up front
+  static constexpr size_t MAX_CAPACITY = 1 << 24;
+};
+
+/// Location of the calls of callbacks by the event loop, which have no call
+/// expression
+constexpr Operator EVENT_LOOP_CALL{Token::TokenType::LEFT_PAREN, 0};
+
+/// Throws unless the event loop of interpreter runs once its script is done
+void require_event_loop(const Interpreter &interpreter,
+                        const std::string &builtin) {
+  if (!interpreter.runs_event_loop) {
+    throw RuntimeError(
+        Token{Token::TokenType::FUN, builtin, NullType{}, 0},
+        "can't be used in spawned tasks and forkMap workers, as they have no "
+        "event loop");
+  }
+}
+
+/// The function argument of an event loop builtin, which must take arity
+/// arguments
+CallablePtr callback_argument(const Token::Value &argument, size_t arity,
+                              const std::string &message) {
+  const auto *callable = std::get_if<CallablePtr>(&argument);
+  if (callable == nullptr || (*callable)->arity() != arity) {
+    throw RuntimeError(argument, message, 0);
+  }
+  return *callable;
+}
+
+/// The id of a timer or watch returned by an event loop builtin
+EventLoop::Id id_argument(const Token::Value &argument) {
+  const auto *id = std::get_if<double>(&argument);
+  // Ids are counted up from 1, and are exact as doubles up to 2^53. Also
+  // false for NaN
+  if (id == nullptr || !(*id >= 0 && *id <= 0x1p53) ||
+      std::floor(*id) != *id) {
+    throw RuntimeError(argument, "must be an id returned by the event loop", 0);
+  }
+  return static_cast<EventLoop::Id>(*id);
+}
+
+/// setTimeout(fn, ms) and setInterval(fn, ms): call fn, which takes no
+/// arguments, from the event loop after ms milliseconds, and then every ms
+/// milliseconds for intervals
+struct SetTimer : public Callable {
+public:
+  SetTimer(std::string _name, bool _repeat)
+      : name(std::move(_name)), repeat(_repeat) {}
+
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    require_event_loop(interpreter, name);
+    auto callback = callback_argument(
+        arguments[0], 0, "must be a function without parameters to schedule");
+    const auto *milliseconds = std::get_if<double>(&arguments[1]);
+    // Also false for NaN
+    if (milliseconds == nullptr ||
+        !(*milliseconds >= 0 && *milliseconds <= MAX_DELAY_MS)) {
+      throw RuntimeError(arguments[1],
+                         "must be a delay in milliseconds in 0 to " +
+                             std::to_string(MAX_DELAY_MS),
+                         0);
+    }
+
+    const auto delay =
+        std::chrono::duration_cast<EventLoop::Clock::duration>(
+            std::chrono::duration<double, std::milli>{*milliseconds});
+    auto interval = repeat ? std::optional{delay} : std::nullopt;
+    return static_cast<double>(interpreter.event_loop.set_timer(
+        delay, interval,
+        [&interpreter, callback = std::move(callback)] {
+          interpreter.call(*callback, {}, EVENT_LOOP_CALL);
+        }));
+  }
+
+  [[nodiscard]] size_t arity() const override { return 2; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn '" + name + "'>";
+  }
+
+private:
+  /// About 31700 years, which the clock's nanoseconds still hold when added
+  /// to the current time
+  static constexpr uint64_t MAX_DELAY_MS = 1000000000000000;
+
+  const std::string name;
+  const bool repeat;
+};
+
+/// clearTimeout(id) and clearInterval(id): cancel a timer. False if it
+/// already ran or was cancelled
+struct ClearTimer : public Callable {
+public:
+  explicit ClearTimer(std::string _name) : name(std::move(_name)) {}
+
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    return interpreter.event_loop.cancel_timer(id_argument(arguments[0]));
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn '" + name + "'>";
+  }
+
+private:
+  const std::string name;
+};
+
+/// readFileAsync(path, fn): read a file without blocking the script, then
+/// call fn with its contents, or nil if it can't be read
+struct ReadFileAsync : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    require_event_loop(interpreter, "readFileAsync");
+    const auto *filename = std::get_if<std::string>(&arguments[0]);
+    if (filename == nullptr) {
+      throw RuntimeError(arguments[0], "must be the name of the file to read",
+                         0);
+    }
+    auto callback = callback_argument(
+        arguments[1], 1, "must be a function taking the file contents");
+
+    // Relative to the script, like includeStr()
+    interpreter.event_loop.read_file(
+        std::filesystem::path(interpreter.interpreter_path).append(*filename),
+        [&interpreter,
+         callback = std::move(callback)](std::optional<std::string> contents) {
+          interpreter.call(*callback,
+                           {contents.has_value()
+                                ? Token::Value{std::move(*contents)}
+                                : Token::Value{NullType{}}},
+                           EVENT_LOOP_CALL);
+        });
+    return NullType{};
+  }
+
+  [[nodiscard]] size_t arity() const override { return 2; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'readFileAsync'>";
+  }
+};
+
+/// watchFile(path, fn): call fn with the path whenever the file changes,
+/// until it is deleted or unwatched. Returns the id for unwatchFile()
+struct WatchFile : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    require_event_loop(interpreter, "watchFile");
+    const auto *filename = std::get_if<std::string>(&arguments[0]);
+    if (filename == nullptr) {
+      throw RuntimeError(arguments[0], "must be the name of the file to watch",
+                         0);
+    }
+    auto callback = callback_argument(
+        arguments[1], 1, "must be a function taking the changed path");
+
+    auto id = interpreter.event_loop.watch_file(
+        std::filesystem::path(interpreter.interpreter_path).append(*filename),
+        [&interpreter, callback = std::move(callback), path = *filename] {
+          interpreter.call(*callback, {path}, EVENT_LOOP_CALL);
+        });
+    if (!id.has_value()) {
+      throw RuntimeError(arguments[0], "There was an error watching the file",
+                         0);
+    }
+    return static_cast<double>(*id);
+  }
+
+  [[nodiscard]] size_t arity() const override { return 2; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'watchFile'>";
+  }
+};
+
+/// unwatchFile(id): stop watching a file. False if it isn't watched anymore
+struct UnwatchFile : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    return interpreter.event_loop.unwatch_file(id_argument(arguments[0]));
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'unwatchFile'>";
+  }
+};
+
+/// forkMap(iterable, fn, workers): array of fn applied to every value of
+/// iterable, computed by up to workers forked processes
+struct ForkMap : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *object = std::get_if<ObjectPtr>(&arguments[0]);
+    auto iterator = object != nullptr ? (*object)->iterate() : nullptr;
+    if (iterator == nullptr) {
+      throw RuntimeError(arguments[0], "must be an iterable to map", 0);
+    }
+    auto function = callback_argument(
+        arguments[1], 1, "must be a function taking one value to map");
+    const auto *workers = std::get_if<double>(&arguments[2]);
+    // Also false for NaN
+    if (workers == nullptr || !(*workers >= 1 && *workers <= MAX_WORKERS) ||
+        std::floor(*workers) != *workers) {
+      throw RuntimeError(arguments[2],
+                         "must be an integer number of workers in 1 to " +
+                             std::to_string(MAX_WORKERS),
+                         0);
+    }
+
+    std::vector<Token::Value> inputs;
+    while (auto value = iterator->next(interpreter)) {
+      inputs.push_back(std::move(*value));
+    }
+    return ObjectPtr{std::make_shared<Array>(fork_map(
+        interpreter, inputs, function, static_cast<size_t>(*workers)))};
+  }
+
+  [[nodiscard]] size_t arity() const override { return 3; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'forkMap'>";
+  }
+
+private:
+  /// Each worker is a process, with a pipe open in this one
+  static constexpr size_t MAX_WORKERS = 1024;
+};
+
+/// len(value): number of elements of an array or Float64Array, entries of a
+/// map, or characters of a string
+struct Len : public Callable {
+public:
+  Token::Value call(Interpreter &,
+                    const std::vector<Token::Value> &arguments) override {
+    if (const auto *array = get_object_as<Array>(arguments[0])) {
+      return static_cast<double>(array->elements.size());
+    }
+    if (const auto *map = get_object_as<Map>(arguments[0])) {
+      return static_cast<double>(map->size());
+    }
+    if (const auto *floats = get_object_as<Float64Array>(arguments[0])) {
+      return static_cast<double>(floats->elements.size());
+    }
+    if (const auto *string = std::get_if<std::string>(&arguments[0])) {
+      return static_cast<double>(string->size());
+    }
+    throw RuntimeError(arguments[0], "must be an array, a map or a string",
+                       0);
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'len'>";
+  }
+};
+
+/// fromCharCode(code): the string of the byte code, from 0 to 255
+struct FromCharCode : public Callable {
+public:
+  Token::Value call(Interpreter &,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *code = std::get_if<double>(&arguments[0]);
+    if (code == nullptr || *code < 0 || *code > 255 ||
+        *code != static_cast<double>(static_cast<unsigned char>(*code))) {
+      throw RuntimeError(arguments[0], "must be a character code from 0 to 255",
+                         0);
+    }
+    return std::string(1, static_cast<char>(static_cast<unsigned char>(*code)));
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'fromCharCode'>";
+  }
+};
+
+/// Map(): an empty map
+struct MakeMap : public Callable {
+public:
+  Token::Value call(Interpreter &, const std::vector<Token::Value> &) override {
+    return ObjectPtr{std::make_shared<Map>()};
+  }
+
+  [[nodiscard]] size_t arity() const override { return 0; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'Map'>";
+  }
+};
+
+/// Float64Array(size) with zeros, or Float64Array(array) with the numbers of
+/// array
+struct MakeFloat64Array : public Callable {
+public:
+  Token::Value call(Interpreter &,
+                    const std::vector<Token::Value> &arguments) override {
+    if (const auto *size = std::get_if<double>(&arguments[0])) {
+      // Also false for NaN
+      if (!(*size >= 0 && *size <= MAX_SIZE) || std::floor(*size) != *size) {
+        throw RuntimeError(arguments[0],
+                           "must be an integer size in 0 to " +
+                               std::to_string(MAX_SIZE),
+                           0);
+      }
+      try {
+        return ObjectPtr{std::make_shared<Float64Array>(
+            std::vector<double>(static_cast<size_t>(*size)))};
+      } catch (const std::bad_alloc &) {
+        throw RuntimeError(arguments[0], "is too large a size, out of memory",
+                           0);
+      }
+    }
+    const auto *array = get_object_as<Array>(arguments[0]);
+    if (array == nullptr) {
+      throw RuntimeError(arguments[0], "must be a size or an array of numbers",
+                         0);
+    }
+    std::vector<double> elements;
+    elements.reserve(array->elements.size());
+    for (const auto &element : array->elements) {
+      const auto *number = std::get_if<double>(&element);
+      if (number == nullptr) {
+        throw RuntimeError(element, "is not a number, Float64Arrays only hold "
+                                    "numbers",
+                           0);
+      }
+      elements.push_back(*number);
+    }
+    return ObjectPtr{std::make_shared<Float64Array>(std::move(elements))};
+  }
+
+  [[nodiscard]] size_t arity() const override { return 1; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'Float64Array'>";
+  }
+
+private:
+  /// 32 GiB of elements
+  static constexpr size_t MAX_SIZE = std::numeric_limits<uint32_t>::max();
+};
+
+/// benchmark(fn, iterations): times iterations calls of fn, after a tenth as
+/// many untimed warmup calls. Returns the min, median, mean and stddev of a
+/// call in milliseconds, and calls per second
+struct Benchmark : public Callable {
+public:
+  Token::Value call(Interpreter &interpreter,
+                    const std::vector<Token::Value> &arguments) override {
+    const auto *callable = std::get_if<CallablePtr>(&arguments[0]);
+    if (callable == nullptr || (*callable)->arity() != 0) {
+      throw RuntimeError(arguments[0],
+                         "must be a function without parameters to benchmark",
+                         0);
+    }
+    const auto *count = std::get_if<double>(&arguments[1]);
+    // Also false for NaN
+    if (count == nullptr || !(*count >= 1 && *count <= MAX_ITERATIONS) ||
+        std::floor(*count) != *count) {
+      throw RuntimeError(arguments[1],
+                         "must be an integer number of iterations in 1 to " +
+                             std::to_string(MAX_ITERATIONS),
+                         0);
+    }
+    const auto iterations = static_cast<size_t>(*count);
+    const auto &function = *callable;
+
+    for (size_t i = 0; i < (iterations + 9) / 10; ++i) {
+      interpreter.call(*function, {}, BENCHMARK_CALL);
+    }
+
+    std::vector<double> milliseconds(iterations);
+    for (auto &elapsed : milliseconds) {
+      const auto start = std::chrono::steady_clock::now();
+      interpreter.call(*function, {}, BENCHMARK_CALL);
+      elapsed = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    }
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+    const auto middle = iterations / 2;
+    const double median =
+        iterations % 2 == 1
+            ? milliseconds[middle]
+            : (milliseconds[middle - 1] + milliseconds[middle]) / 2;
+    double total = 0;
+    for (const double elapsed : milliseconds) {
+      total += elapsed;
+    }
+    const double mean = total / static_cast<double>(iterations);
+    double squares = 0;
+    for (const double elapsed : milliseconds) {
+      squares += (elapsed - mean) * (elapsed - mean);
+    }
+
+    return make_record(
+        "BenchmarkStats",
+        {{"iterations", static_cast<double>(iterations)},
+         {"min", milliseconds.front()},
+         {"median", median},
+         {"mean", mean},
+         {"stddev", std::sqrt(squares / static_cast<double>(iterations))},
+         {"opsPerSec", mean > 0 ? 1000 / mean : 0.0}});
+  }
+
+  [[nodiscard]] size_t arity() const override { return 2; }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Native fn 'benchmark'>";
+  }
+
+private:
+  /// Location of the calls of the benchmarked function, which have no call
+  /// expression
+  static constexpr Operator BENCHMARK_CALL{Token::TokenType::LEFT_PAREN, 0};
+
+  /// Bounds the memory of the timings, 8 bytes per iteration
+  static constexpr size_t MAX_ITERATIONS = 10000000;
+};
 } // namespace
 
 namespace Buildin {
@@ -203,6 +783,20 @@ std::vector<Token> get_buildins() {
   auto clock_buildin = std::make_shared<SimpleBuildin<decltype(clock_closure)>>(
       "clock", std::move(clock_closure));
 
+  auto clock_ns_closure = [](Interpreter &) {
+    return since_clock_origin<std::chrono::nanoseconds>();
+  };
+  auto clock_ns_buildin =
+      std::make_shared<SimpleBuildin<decltype(clock_ns_closure)>>(
+          "clockNs", std::move(clock_ns_closure));
+
+  auto clock_ms_closure = [](Interpreter &) {
+    return since_clock_origin<std::chrono::milliseconds>();
+  };
+  auto clock_ms_buildin =
+      std::make_shared<SimpleBuildin<decltype(clock_ms_closure)>>(
+          "clockMs", std::move(clock_ms_closure));
+
   auto print_env_closure = [](Interpreter &interpreter) {
     interpreter.out_stream << "Globals: \n"
                            << *interpreter.globals << std::endl;
@@ -220,14 +814,45 @@ std::vector<Token> get_buildins() {
   auto exit_buildin = std::make_shared<SimpleBuildin<decltype(exit_closure)>>(
       "exit", std::move(exit_closure));
 
+  auto eval_buildin = std::make_shared<Eval>();
+  auto eval_stats_closure = [eval = eval_buildin](Interpreter &) {
+    return eval->stats();
+  };
+  auto eval_stats_buildin =
+      std::make_shared<SimpleBuildin<decltype(eval_stats_closure)>>(
+          "evalStats", std::move(eval_stats_closure));
+
   return {
       {Type::FUN, "clock", std::move(clock_buildin), 0},
+      {Type::FUN, "clockNs", std::move(clock_ns_buildin), 0},
+      {Type::FUN, "clockMs", std::move(clock_ms_buildin), 0},
       {Type::FUN, "printEnv", std::move(print_env_buildin), 0},
       {Type::FUN, "exit", std::move(exit_buildin), 0},
       {Type::FUN, "includeStr", std::make_shared<IncludeStr>(), 0},
       {Type::FUN, "setLogLevel", std::make_shared<SetLogLevel>(), 0},
       {Type::FUN, "assert", std::make_shared<Assert>(), 0},
-      {Type::FUN, "eval", std::make_shared<Eval>(), 0},
+      {Type::FUN, "eval", std::move(eval_buildin), 0},
+      {Type::FUN, "evalStats", std::move(eval_stats_buildin), 0},
+      {Type::FUN, "spawn", std::make_shared<Spawn>(), 0},
+      {Type::FUN, "await", std::make_shared<Await>(), 0},
+      {Type::FUN, "Channel", std::make_shared<MakeChannel>(), 0},
+      {Type::FUN, "setTimeout", std::make_shared<SetTimer>("setTimeout", false),
+       0},
+      {Type::FUN, "setInterval",
+       std::make_shared<SetTimer>("setInterval", true), 0},
+      {Type::FUN, "clearTimeout", std::make_shared<ClearTimer>("clearTimeout"),
+       0},
+      {Type::FUN, "clearInterval",
+       std::make_shared<ClearTimer>("clearInterval"), 0},
+      {Type::FUN, "readFileAsync", std::make_shared<ReadFileAsync>(), 0},
+      {Type::FUN, "watchFile", std::make_shared<WatchFile>(), 0},
+      {Type::FUN, "unwatchFile", std::make_shared<UnwatchFile>(), 0},
+      {Type::FUN, "forkMap", std::make_shared<ForkMap>(), 0},
+      {Type::FUN, "len", std::make_shared<Len>(), 0},
+      {Type::FUN, "fromCharCode", std::make_shared<FromCharCode>(), 0},
+      {Type::FUN, "Map", std::make_shared<MakeMap>(), 0},
+      {Type::FUN, "Float64Array", std::make_shared<MakeFloat64Array>(), 0},
+      {Type::FUN, "benchmark", std::make_shared<Benchmark>(), 0},
   };
 }
 } // namespace Buildin
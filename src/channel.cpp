@@ -0,0 +1,446 @@
+#include "channel.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+
+#include "array.hpp"
+#include "binary_format.hpp"
+#include "class.hpp"
+#include "error.hpp"
+#include "float64_array.hpp"
+#include "instance.hpp"
+#include "interpreter.hpp"
+#include "map.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+using BinaryFormat::put;
+using BinaryFormat::put_string;
+
+/// The class a record named name is rebuilt as by interpreter
+ClassPtr record_class(Interpreter &interpreter, const std::string &name) {
+  const auto &variables = interpreter.current_globals->variables;
+  if (const auto found = variables.find(name); found != variables.end()) {
+    if (const auto *callable = std::get_if<CallablePtr>(&found->second)) {
+      if (auto klass = std::dynamic_pointer_cast<Class>(*callable)) {
+        return klass;
+      }
+    }
+  }
+  return std::make_shared<Class>(name, nullptr, Class::ClassFunctions{});
+}
+
+/// Tags of serialized messages
+enum class Tag : uint8_t {
+  NIL,
+  NUMBER,
+  FALSE,
+  TRUE,
+  STRING,
+  RECORD,
+  LIST,
+  DICT,
+  FLOATS
+};
+
+template <typename T> T take(std::string_view &in) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if (in.size() < sizeof(T)) {
+    throw RuntimeError("Truncated serialized message");
+  }
+  T value;
+  std::memcpy(&value, in.data(), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return value;
+}
+
+std::string take_string(std::string_view &in) {
+  const auto size = take<uint32_t>(in);
+  if (in.size() < size) {
+    throw RuntimeError("Truncated serialized message");
+  }
+  std::string string{in.substr(0, size)};
+  in.remove_prefix(size);
+  return string;
+}
+} // namespace
+
+Message Message::encode(const Token::Value &value) {
+  std::unordered_set<const void *> enclosing;
+  return encode(value, enclosing);
+}
+
+Message Message::encode(const Token::Value &value,
+                        std::unordered_set<const void *> &enclosing) {
+  Message message;
+  if (const auto *number = std::get_if<double>(&value)) {
+    message.value = *number;
+  } else if (const auto *string = std::get_if<std::string>(&value)) {
+    message.value = *string;
+  } else if (const auto *boolean = std::get_if<bool>(&value)) {
+    message.value = *boolean;
+  } else if (const auto *array = get_object_as<Array>(value)) {
+    if (!enclosing.insert(array).second) {
+      throw RuntimeError("Can't send " + array->to_string() +
+                         " over a channel, it contains itself");
+    }
+    auto list = std::make_unique<Message::List>();
+    list->elements.reserve(array->elements.size());
+    for (const auto &element : array->elements) {
+      list->elements.push_back(encode(element, enclosing));
+    }
+    enclosing.erase(array);
+    message.value = std::move(list);
+  } else if (const auto *floats = get_object_as<Float64Array>(value)) {
+    message.value = floats->elements;
+  } else if (const auto *map = get_object_as<Map>(value)) {
+    if (!enclosing.insert(map).second) {
+      throw RuntimeError("Can't send " + map->to_string() +
+                         " over a channel, it contains itself");
+    }
+    auto dict = std::make_unique<Message::Dict>();
+    dict->entries.reserve(map->size());
+    map->for_each([&dict, &enclosing](const Token::Value &key,
+                                      const Token::Value &field) {
+      dict->entries.emplace_back(encode(key, enclosing),
+                                 encode(field, enclosing));
+    });
+    enclosing.erase(map);
+    message.value = std::move(dict);
+  } else if (const auto *object = std::get_if<ObjectPtr>(&value)) {
+    if (!(*object)->is_shareable()) {
+      throw RuntimeError("Can't send " + (*object)->to_string() +
+                         " over a channel");
+    }
+    message.value = *object;
+  } else if (const auto *instance = std::get_if<InstancePtr>(&value)) {
+    if (!enclosing.insert(instance->get()).second) {
+      throw RuntimeError("Can't send " + (*instance)->to_string() +
+                         " over a channel, it references itself");
+    }
+    auto record = std::make_unique<Message::Record>();
+    record->class_name = (*instance)->klass->name();
+    (*instance)->for_each_field(
+        [&record, &enclosing](const std::string &name,
+                              const Token::Value &field) {
+          record->fields.emplace_back(name, encode(field, enclosing));
+        });
+    enclosing.erase(instance->get());
+    message.value = std::move(record);
+  } else if (const auto *callable = std::get_if<CallablePtr>(&value)) {
+    throw RuntimeError("Can't send " + (*callable)->to_string() +
+                       " over a channel");
+  }
+  return message;
+}
+
+Token::Value Message::decode(Interpreter &interpreter) && {
+  return std::visit(
+      [&interpreter](auto &&content) -> Token::Value {
+        using T = std::decay_t<decltype(content)>;
+        if constexpr (std::is_same_v<T, std::unique_ptr<Record>>) {
+          auto instance =
+              make_instance(record_class(interpreter, content->class_name));
+          for (auto &[name, field] : content->fields) {
+            instance->restore_field(name, std::move(field).decode(interpreter));
+          }
+          return instance;
+        } else if constexpr (std::is_same_v<T, std::unique_ptr<List>>) {
+          std::vector<Token::Value> elements;
+          elements.reserve(content->elements.size());
+          for (auto &element : content->elements) {
+            elements.push_back(std::move(element).decode(interpreter));
+          }
+          return ObjectPtr{std::make_shared<Array>(std::move(elements))};
+        } else if constexpr (std::is_same_v<T, std::unique_ptr<Dict>>) {
+          auto map = std::make_shared<Map>();
+          for (auto &[key, field] : content->entries) {
+            map->insert(std::move(key).decode(interpreter), 0) =
+                std::move(field).decode(interpreter);
+          }
+          return ObjectPtr{std::move(map)};
+        } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+          return ObjectPtr{std::make_shared<Float64Array>(std::move(content))};
+        } else {
+          return std::move(content);
+        }
+      },
+      std::move(value));
+}
+
+void Message::serialize(std::string &out) const {
+  std::visit(
+      [&out](const auto &content) {
+        using T = std::decay_t<decltype(content)>;
+        if constexpr (std::is_same_v<T, NullType>) {
+          put(out, Tag::NIL);
+        } else if constexpr (std::is_same_v<T, double>) {
+          put(out, Tag::NUMBER);
+          put(out, content);
+        } else if constexpr (std::is_same_v<T, bool>) {
+          put(out, content ? Tag::TRUE : Tag::FALSE);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+          put(out, Tag::STRING);
+          put_string(out, content);
+        } else if constexpr (std::is_same_v<T, ObjectPtr>) {
+          throw RuntimeError("Can't send " + content->to_string() +
+                             " to another process");
+        } else if constexpr (std::is_same_v<T, std::unique_ptr<List>>) {
+          put(out, Tag::LIST);
+          put(out, static_cast<uint32_t>(content->elements.size()));
+          for (const auto &element : content->elements) {
+            element.serialize(out);
+          }
+        } else if constexpr (std::is_same_v<T, std::unique_ptr<Dict>>) {
+          put(out, Tag::DICT);
+          put(out, static_cast<uint32_t>(content->entries.size()));
+          for (const auto &[key, field] : content->entries) {
+            key.serialize(out);
+            field.serialize(out);
+          }
+        } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+          put(out, Tag::FLOATS);
+          put(out, static_cast<uint32_t>(content.size()));
+          out.append(reinterpret_cast<const char *>(content.data()),
+                     content.size() * sizeof(double));
+        } else {
+          put(out, Tag::RECORD);
+          put_string(out, content->class_name);
+          put(out, static_cast<uint32_t>(content->fields.size()));
+          for (const auto &[name, field] : content->fields) {
+            put_string(out, name);
+            field.serialize(out);
+          }
+        }
+      },
+      value);
+}
+
+Message Message::deserialize(std::string_view &in) {
+  Message message;
+  switch (take<Tag>(in)) {
+  case Tag::NIL:
+    break;
+  case Tag::NUMBER:
+    message.value = take<double>(in);
+    break;
+  case Tag::FALSE:
+    message.value = false;
+    break;
+  case Tag::TRUE:
+    message.value = true;
+    break;
+  case Tag::STRING:
+    message.value = take_string(in);
+    break;
+  case Tag::RECORD: {
+    auto record = std::make_unique<Record>();
+    record->class_name = take_string(in);
+    const auto field_count = take<uint32_t>(in);
+    for (uint32_t i = 0; i < field_count; ++i) {
+      auto name = take_string(in);
+      record->fields.emplace_back(std::move(name), deserialize(in));
+    }
+    message.value = std::move(record);
+    break;
+  }
+  case Tag::LIST: {
+    auto list = std::make_unique<List>();
+    const auto size = take<uint32_t>(in);
+    for (uint32_t i = 0; i < size; ++i) {
+      list->elements.push_back(deserialize(in));
+    }
+    message.value = std::move(list);
+    break;
+  }
+  case Tag::DICT: {
+    auto dict = std::make_unique<Dict>();
+    const auto size = take<uint32_t>(in);
+    for (uint32_t i = 0; i < size; ++i) {
+      auto key = deserialize(in);
+      dict->entries.emplace_back(std::move(key), deserialize(in));
+    }
+    message.value = std::move(dict);
+    break;
+  }
+  case Tag::FLOATS: {
+    const auto size = take<uint32_t>(in);
+    if (in.size() / sizeof(double) < size) {
+      throw RuntimeError("Truncated serialized message");
+    }
+    std::vector<double> elements(size);
+    std::memcpy(elements.data(), in.data(), size * sizeof(double));
+    in.remove_prefix(size * sizeof(double));
+    message.value = std::move(elements);
+    break;
+  }
+  default:
+    throw RuntimeError("Corrupt serialized message");
+  }
+  return message;
+}
+
+Channel::Channel(size_t _capacity)
+    : capacity(_capacity), cells(std::make_unique<Cell[]>(_capacity)) {
+  for (size_t i = 0; i < capacity; ++i) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool Channel::try_push(Message &message) {
+  auto position = tail.load(std::memory_order_relaxed);
+  while (true) {
+    auto &cell = cells[position % capacity];
+    const auto sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence == position) {
+      if (tail.compare_exchange_weak(position, position + 1,
+                                     std::memory_order_relaxed)) {
+        cell.message = std::move(message);
+        cell.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (sequence < position) {
+      return false; // Full: the cell still holds the message from a lap ago
+    } else {
+      position = tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+std::optional<Message> Channel::try_pop() {
+  auto position = head.load(std::memory_order_relaxed);
+  while (true) {
+    auto &cell = cells[position % capacity];
+    const auto sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence == position + 1) {
+      if (head.compare_exchange_weak(position, position + 1,
+                                     std::memory_order_relaxed)) {
+        auto message = std::move(cell.message);
+        cell.sequence.store(position + capacity, std::memory_order_release);
+        return message;
+      }
+    } else if (sequence < position + 1) {
+      return std::nullopt; // Empty: nothing was sent to this position yet
+    } else {
+      position = head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool Channel::has_room() const {
+  const auto position = tail.load();
+  return cells[position % capacity].sequence.load() == position;
+}
+
+bool Channel::has_messages() const {
+  const auto position = head.load();
+  return cells[position % capacity].sequence.load() == position + 1;
+}
+
+void Channel::block_until(const std::function<bool()> &ready) {
+  ++waiters;
+  const bool woken = ThreadPool::instance().block_until(ready);
+  --waiters;
+  if (!woken) {
+    throw RuntimeError("Channel wait interrupted by shutdown");
+  }
+}
+
+void Channel::wake_waiters() {
+  // Orders the queue update before reading waiters, matching the increment
+  // in block_until()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters > 0) {
+    ThreadPool::instance().notify();
+  }
+}
+
+void Channel::send(Message message) {
+  while (true) {
+    if (closed) {
+      throw RuntimeError("Can't send on a closed channel");
+    }
+    if (try_push(message)) {
+      wake_waiters();
+      return;
+    }
+    block_until([this] { return closed || has_room(); });
+  }
+}
+
+std::optional<Message> Channel::recv() {
+  while (true) {
+    if (auto message = try_pop()) {
+      wake_waiters();
+      return message;
+    }
+    if (closed) {
+      // Messages sent concurrently with close() are still delivered
+      return try_pop();
+    }
+    block_until([this] { return closed || has_messages(); });
+  }
+}
+
+std::optional<Message> Channel::try_recv() {
+  auto message = try_pop();
+  if (message.has_value()) {
+    wake_waiters();
+  }
+  return message;
+}
+
+void Channel::close() {
+  closed = true;
+  ThreadPool::instance().notify();
+}
+
+std::string Channel::to_string() const {
+  return "<Channel capacity " + std::to_string(capacity) +
+         (closed ? ", closed>" : ">");
+}
+
+Token::Value Channel::get(const Token &name, Interpreter &interpreter) {
+  auto self = shared_from_this();
+  const auto received = [](std::optional<Message> message,
+                           Interpreter &receiver) -> Token::Value {
+    if (!message.has_value()) {
+      return NullType{};
+    }
+    return std::move(*message).decode(receiver);
+  };
+
+  if (name.lexeme == "send") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "send", 1, [self](Interpreter &, const auto &arguments) {
+          self->send(Message::encode(arguments[0]));
+          return Token::Value{NullType{}};
+        })};
+  }
+  if (name.lexeme == "recv") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "recv", 0, [self, received](Interpreter &receiver, const auto &) {
+          return received(self->recv(), receiver);
+        })};
+  }
+  if (name.lexeme == "tryRecv") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "tryRecv", 0, [self, received](Interpreter &receiver, const auto &) {
+          return received(self->try_recv(), receiver);
+        })};
+  }
+  if (name.lexeme == "close") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "close", 0, [self](Interpreter &, const auto &) {
+          self->close();
+          return Token::Value{NullType{}};
+        })};
+  }
+  if (name.lexeme == "closed") {
+    return closed.load();
+  }
+  return Object::get(name, interpreter);
+}
+
+bool Channel::is_shareable() const { return true; }
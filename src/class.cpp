@@ -1,16 +1,39 @@
 #include "class.hpp"
 
+#include <cassert>
+
 #include "error.hpp"
 #include "instance.hpp"
 #include "logging.hpp"
 
-Class::Class(std::string _name, ClassPtr _superclass, ClassFunctions _functions)
+Class::Class(std::string _name, ClassPtr _superclass, ClassFunctions _functions,
+             std::vector<std::string> _fields)
     : superclass(std::move(_superclass)), methods(std::get<0>(_functions)),
       unbounds(std::move(std::get<1>(_functions))),
-      getters(std::move(std::get<2>(_functions))), m_name(std::move(_name)) {}
+      getters(std::move(std::get<2>(_functions))),
+      m_fields(std::move(_fields)), m_name(std::move(_name)) {
+  assert(superclass == nullptr || !superclass->is_record() || m_fields.empty());
+  if (superclass != nullptr && superclass->is_record()) {
+    m_fields = superclass->m_fields;
+  }
+}
 
 const std::string &Class::name() const { return m_name; }
 
+const std::vector<std::string> &Class::fields() const { return m_fields; }
+
+bool Class::is_record() const { return !m_fields.empty(); }
+
+std::optional<size_t> Class::field_index(const std::string &name) const {
+  // Records are small, so a scan beats hashing the name
+  for (size_t i = 0; i < m_fields.size(); ++i) {
+    if (m_fields[i] == name) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
 std::string Class::to_string() const {
   std::string representation = "class " + name() + "\nMethods:";
   for (const auto &method : methods) {
@@ -28,14 +51,15 @@ size_t Class::arity() const {
   if (const auto &constructor = get_method("init")) {
     return constructor->arity();
   }
-  return 0;
+  // Without a constructor, records take their fields in order
+  return m_fields.size();
 }
 
 Token::Value Class::call(Interpreter &interpreter,
                          const std::vector<Token::Value> &arguments) {
   LOG_DEBUG("Creating instance");
 
-  auto instance = std::make_shared<Instance>(shared_from_this());
+  auto instance = make_instance(shared_from_this());
 
   LOG_DEBUG("Created instance successfully");
 
@@ -43,6 +67,10 @@ Token::Value Class::call(Interpreter &interpreter,
   // constructor args
   if (const auto &constructor = get_method("init")) {
     constructor->bind(instance)->call(interpreter, arguments);
+  } else {
+    for (size_t i = 0; i < arguments.size(); ++i) {
+      instance->field_at(i) = arguments[i];
+    }
   }
 
   return instance;
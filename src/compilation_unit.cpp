@@ -0,0 +1,94 @@
+#include "compilation_unit.hpp"
+
+#include "error.hpp"
+#include "lexer.hpp"
+#include "logging.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+
+using Type = Token::TokenType;
+
+namespace {
+void log_tokens(const std::vector<Token> &tokens) {
+  LOG_DEBUG("\nTokens after parse:");
+
+  for (const auto &t : tokens) {
+    LOG_DEBUG("\t", t);
+  }
+
+  LOG_DEBUG("\n");
+}
+
+template <typename Node>
+void materialize_body(Node &node, DeferredBody *deferred,
+                      std::vector<stmt> &body,
+                      const std::shared_ptr<ErrorHandler> &err_handler) {
+  if (deferred == nullptr || deferred->materialized) {
+    return;
+  }
+
+  const std::scoped_lock lock{deferred->unit->materialize_mutex};
+  if (not deferred->materialized && not deferred->has_errors) {
+    const auto errors = err_handler->error_count();
+
+    Parser parser{*deferred->unit, err_handler};
+    body = parser.parse_body(*deferred);
+
+    if (err_handler->error_count() == errors) {
+      Resolver resolver{err_handler};
+      resolver.resolve_deferred(node);
+    }
+
+    deferred->has_errors = err_handler->error_count() != errors;
+    deferred->materialized = not deferred->has_errors;
+  }
+
+  if (deferred->has_errors) {
+    throw RuntimeError(Operator{Type::LEFT_BRACE, deferred->line},
+                       "Function body contains syntax errors");
+  }
+}
+} // namespace
+
+CompilationUnitPtr compile(std::string_view source,
+                           const std::shared_ptr<ErrorHandler> &err_handler,
+                           ParseMode mode) {
+  auto unit = std::make_shared<CompilationUnit>();
+  unit->mode = mode;
+
+  Lexer lexer{source, err_handler};
+  unit->tokens = lexer.lex();
+
+  if (err_handler->has_error()) {
+    return nullptr;
+  }
+
+  Parser parser{*unit, err_handler};
+  unit->statements = parser.parse();
+
+  log_tokens(unit->tokens);
+
+  if (err_handler->has_error()) {
+    return nullptr;
+  }
+
+  Resolver resolver{err_handler};
+  resolver.resolve(unit->statements);
+
+  if (err_handler->has_error()) {
+    return nullptr;
+  }
+
+  return unit;
+}
+
+void materialize(FunctionStmt &function,
+                 const std::shared_ptr<ErrorHandler> &err_handler) {
+  materialize_body(function, function.child<4>(), function.child<2>(),
+                   err_handler);
+}
+
+void materialize(Lambda &lambda,
+                 const std::shared_ptr<ErrorHandler> &err_handler) {
+  materialize_body(lambda, lambda.child<2>(), lambda.child<1>(), err_handler);
+}
@@ -13,6 +13,11 @@ RuntimeError::RuntimeError(Token::Value value, const std::string &msg,
       token(Token{Token::TokenType::NIL, "RUNTIME_ERROR", std::move(value),
                   line}) {}
 
+RuntimeError::RuntimeError(const Operator &op, const std::string &msg)
+    : RuntimeError(Token{op.type, std::string{lexeme(op.type)}, NullType{},
+                         op.line},
+                   msg) {}
+
 RuntimeError::RuntimeError(const std::string &msg)
     : std::runtime_error("Runtime error: " + msg),
       token(Token{Token::TokenType::NIL, "RUNTIME_ERROR", NullType{}, 0}) {}
@@ -34,18 +39,21 @@ ErrorHandler::~ErrorHandler() = default;
 
 void ErrorHandler::reset_error() { had_error = false; }
 bool ErrorHandler::has_error() const { return had_error; }
+size_t ErrorHandler::error_count() const { return errors; }
 
 bool ErrorHandler::has_runtime_error() const { return had_runtime_error; }
 
 void ErrorHandler::error(unsigned int line, std::string_view message) {
   report(line, "", message, true);
   had_error = true;
+  ++errors;
 }
 
 void ErrorHandler::error(const Token &token, std::string_view message) {
   report(token.line, "", message, true);
 
   had_error = true;
+  ++errors;
 }
 
 void ErrorHandler::warn(const Token &token, std::string_view message) {
@@ -70,12 +78,46 @@ void ErrorHandler::runtime_error(unsigned int line, std::string_view message) {
 
 CerrHandler::CerrHandler() = default;
 
+std::string format_report(unsigned int line, std::string_view where,
+                          std::string_view message, bool is_error) {
+  std::string report = "[line " + std::to_string(line);
+  report +=
+      is_error ? "] \033[1;31mError\033[0m" : "] \033[1;33mWarning\033[0m";
+  report += ": ";
+  report += where;
+  report += ": ";
+  report += message;
+  report += '\n';
+  return report;
+}
+
 void CerrHandler::report(unsigned int line, std::string_view where,
                          std::string_view message, bool is_error) {
-  std::cerr << "[line " << std::to_string(line);
-  std::cerr << (is_error ? "] \033[1;31mError\033[0m"
-                         : "] \033[1;33mWarning\033[0m");
-  std::cerr << ": " << where << ": " << message << '\n';
+  // Written in one go, so reports from isolates on other threads don't
+  // interleave
+  std::cerr << format_report(line, where, message, is_error);
+}
+
+void BufferedErrorHandler::report(unsigned int line, std::string_view where,
+                                  std::string_view message, bool is_error) {
+  std::string text{where};
+  if (!text.empty()) {
+    text += ": ";
+  }
+  text += message;
+  reports.push_back({line, std::move(text), is_error});
+}
+
+void BufferedErrorHandler::replay(ErrorHandler &target,
+                                  std::string_view context) const {
+  for (const auto &report : reports) {
+    auto message = std::string{context} + report.message;
+    if (report.is_error) {
+      target.error(report.line, message);
+    } else {
+      target.warn(report.line, message);
+    }
+  }
 }
 
 FileErrorHandler::FileErrorHandler(std::string_view filename)
@@ -0,0 +1,341 @@
+#include "event_loop.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+
+#include "source_file.hpp"
+#include "thread_pool.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using namespace std::chrono_literals;
+
+[[noreturn]] void throw_errno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+#ifndef __linux__
+// Without epoll, finished reads are noticed by polling this often
+constexpr auto READ_POLL_INTERVAL = 10ms;
+#endif
+} // namespace
+
+EventLoop::Completions::Completions()
+#ifdef __linux__
+    : event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  if (event_fd < 0) {
+    throw_errno("eventfd");
+  }
+}
+#else
+    : event_fd(-1) {
+}
+#endif
+
+EventLoop::Completions::~Completions() {
+#ifdef __linux__
+  ::close(event_fd);
+#endif
+}
+
+EventLoop::~EventLoop() {
+#ifdef __linux__
+  if (inotify_fd >= 0) {
+    ::close(inotify_fd);
+  }
+  if (epoll_fd >= 0) {
+    ::close(epoll_fd);
+  }
+#endif
+}
+
+EventLoop::Id EventLoop::set_timer(Clock::duration delay,
+                                   std::optional<Clock::duration> interval,
+                                   Callback callback) {
+  if (interval.has_value()) {
+    interval = std::max<Clock::duration>(*interval, 1ms);
+  }
+  const auto id = next_id++;
+  const auto due = Clock::now() + std::max<Clock::duration>(delay, 0ms);
+  timers.emplace(id, Timer{due, interval, std::move(callback)});
+  schedule.emplace(due, id);
+  return id;
+}
+
+bool EventLoop::cancel_timer(Id id) {
+  const auto timer = timers.find(id);
+  if (timer == timers.end()) {
+    return false;
+  }
+  schedule.erase({timer->second.due, id});
+  timers.erase(timer);
+  return true;
+}
+
+void EventLoop::read_file(std::filesystem::path path, ReadCallback done) {
+  ensure_epoll();
+  const auto id = next_id++;
+  reads.emplace(id, std::move(done));
+
+  ThreadPool::instance().submit(
+      [id, path = std::move(path), completions = completions] {
+        std::optional<std::string> contents;
+        try {
+          if (const SourceFile file{path}) {
+            contents.emplace(file.contents());
+          }
+        } catch (const std::exception &) {
+          contents.reset();
+        }
+
+        {
+          const std::scoped_lock lock{completions->mutex};
+          completions->results.emplace_back(id, std::move(contents));
+        }
+#ifdef __linux__
+        const uint64_t signal = 1;
+        [[maybe_unused]] const auto written =
+            ::write(completions->event_fd, &signal, sizeof(signal));
+#endif
+      });
+}
+
+std::optional<EventLoop::Id>
+EventLoop::watch_file(const std::filesystem::path &path, Callback changed) {
+#ifdef __linux__
+  ensure_epoll();
+  if (inotify_fd < 0) {
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+      throw_errno("inotify_init1");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = inotify_fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event) != 0) {
+      throw_errno("epoll_ctl");
+    }
+  }
+
+  const int descriptor = ::inotify_add_watch(
+      inotify_fd, path.c_str(),
+      IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+  if (descriptor < 0) {
+    return std::nullopt;
+  }
+
+  const auto id = next_id++;
+  watches.emplace(id, Watch{descriptor, std::move(changed)});
+  return id;
+#else
+  static_cast<void>(path);
+  static_cast<void>(changed);
+  return std::nullopt;
+#endif
+}
+
+bool EventLoop::unwatch_file(Id id) {
+  const auto watch = watches.find(id);
+  if (watch == watches.end()) {
+    return false;
+  }
+  const int descriptor = watch->second.descriptor;
+  watches.erase(watch);
+
+#ifdef __linux__
+  // Watches of the same file share the descriptor
+  if (std::none_of(watches.begin(), watches.end(), [descriptor](auto &entry) {
+        return entry.second.descriptor == descriptor;
+      })) {
+    ::inotify_rm_watch(inotify_fd, descriptor);
+  }
+#endif
+  return true;
+}
+
+bool EventLoop::has_pending() const {
+  return !timers.empty() || !reads.empty() || !watches.empty();
+}
+
+void EventLoop::run() {
+  while (run_once()) {
+  }
+}
+
+bool EventLoop::run_once() {
+  if (!has_pending()) {
+    return false;
+  }
+
+  // Events left over by a callback that threw are handled without waiting
+  int timeout_ms = -1;
+  if (!finished_reads.empty() || !changed_watches.empty()) {
+    timeout_ms = 0;
+  } else if (!schedule.empty()) {
+    // Timers further out than poll() can wait for are waited for again
+    const auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+        schedule.begin()->first - Clock::now());
+    timeout_ms = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(
+        wait.count(), 0, std::numeric_limits<int>::max()));
+  }
+  poll(timeout_ms);
+
+  while (!finished_reads.empty()) {
+    auto [id, contents] = std::move(finished_reads.front());
+    finished_reads.pop_front();
+    const auto read = reads.find(id);
+    auto done = std::move(read->second);
+    reads.erase(read);
+    done(std::move(contents));
+  }
+
+  while (!changed_watches.empty()) {
+    const auto id = changed_watches.front();
+    changed_watches.pop_front();
+    // Earlier callbacks may have removed the watch
+    if (const auto watch = watches.find(id); watch != watches.end()) {
+      auto changed = watch->second.changed;
+      changed();
+    }
+  }
+
+  const auto now = Clock::now();
+  while (!schedule.empty() && schedule.begin()->first <= now) {
+    const auto id = schedule.begin()->second;
+    schedule.erase(schedule.begin());
+    auto &timer = timers.at(id);
+
+    if (timer.interval.has_value()) {
+      // Kept while its callback runs, which may cancel it
+      timer.due = std::max(timer.due + *timer.interval, now);
+      schedule.emplace(timer.due, id);
+      auto callback = timer.callback;
+      callback();
+    } else {
+      auto callback = std::move(timer.callback);
+      timers.erase(id);
+      callback();
+    }
+  }
+  return true;
+}
+
+void EventLoop::ensure_epoll() {
+  if (completions == nullptr) {
+    completions = std::make_shared<Completions>();
+  }
+#ifdef __linux__
+  if (epoll_fd >= 0) {
+    return;
+  }
+  epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    throw_errno("epoll_create1");
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = completions->event_fd;
+  if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, completions->event_fd, &event) !=
+      0) {
+    throw_errno("epoll_ctl");
+  }
+#endif
+}
+
+void EventLoop::poll(int timeout_ms) {
+#ifdef __linux__
+  if (epoll_fd < 0) { // Only timers so far
+    if (timeout_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{timeout_ms});
+    }
+    return;
+  }
+
+  std::array<epoll_event, 4> events{};
+  const int count = ::epoll_wait(epoll_fd, events.data(),
+                                 static_cast<int>(events.size()), timeout_ms);
+  if (count < 0 && errno != EINTR) {
+    throw_errno("epoll_wait");
+  }
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == completions->event_fd) {
+      collect_completions();
+    } else if (events[i].data.fd == inotify_fd) {
+      collect_changes();
+    }
+  }
+#else
+  auto wait = std::chrono::milliseconds{timeout_ms};
+  if (!reads.empty() && (timeout_ms < 0 || wait > READ_POLL_INTERVAL)) {
+    wait = READ_POLL_INTERVAL;
+  }
+  if (wait > 0ms) {
+    std::this_thread::sleep_for(wait);
+  }
+  if (completions != nullptr) {
+    collect_completions();
+  }
+#endif
+}
+
+void EventLoop::collect_completions() {
+#ifdef __linux__
+  uint64_t signals = 0;
+  [[maybe_unused]] const auto read =
+      ::read(completions->event_fd, &signals, sizeof(signals));
+#endif
+  const std::scoped_lock lock{completions->mutex};
+  for (auto &result : completions->results) {
+    finished_reads.push_back(std::move(result));
+  }
+  completions->results.clear();
+}
+
+void EventLoop::collect_changes() {
+#ifdef __linux__
+  alignas(inotify_event) std::array<char, 4096> buffer{};
+  std::unordered_set<int> changed;
+  std::unordered_set<int> removed;
+
+  while (true) {
+    const auto size = ::read(inotify_fd, buffer.data(), buffer.size());
+    if (size <= 0) {
+      break; // EAGAIN once drained
+    }
+    for (ssize_t offset = 0; offset < size;) {
+      const auto *event =
+          reinterpret_cast<const inotify_event *>(buffer.data() + offset);
+      if ((event->mask & IN_IGNORED) != 0) {
+        removed.insert(event->wd); // Deleted, or unwatched
+      } else {
+        changed.insert(event->wd);
+      }
+      offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+    }
+  }
+
+  // One callback per watch for all changes read at once
+  for (auto watch = watches.begin(); watch != watches.end();) {
+    const auto descriptor = watch->second.descriptor;
+    if (changed.contains(descriptor)) {
+      changed_watches.push_back(watch->first);
+    }
+    if (removed.contains(descriptor)) {
+      watch = watches.erase(watch);
+    } else {
+      ++watch;
+    }
+  }
+#endif
+}
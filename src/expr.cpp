@@ -10,7 +10,10 @@ std::ostream &operator<<(std::ostream &os, const std::vector<expr> &rhs) {
   return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const expr &rhs) {
+std::ostream &operator<<(std::ostream &os, const Expr *rhs) {
+  if (rhs == nullptr) {
+    return os << "nullptr";
+  }
   rhs->print(os);
   return os;
 }
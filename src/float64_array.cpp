@@ -0,0 +1,190 @@
+#include "float64_array.hpp"
+
+#include "array.hpp"
+#include "error.hpp"
+#include "numeric_kernels.hpp"
+
+namespace {
+/// Iterates the array live, so assignments meanwhile are seen
+struct Float64ArrayIterator : public Iterator {
+  explicit Float64ArrayIterator(Float64ArrayPtr _array)
+      : array(std::move(_array)) {}
+
+  std::optional<Token::Value> next(Interpreter &) override {
+    if (position >= array->elements.size()) {
+      return std::nullopt;
+    }
+    return array->elements[position++];
+  }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Float64Array iterator>";
+  }
+
+private:
+  Float64ArrayPtr array;
+  size_t position = 0;
+};
+
+using Arguments = std::vector<Token::Value>;
+
+double number_argument(const Token::Value &argument, const Token &name) {
+  const auto *number = std::get_if<double>(&argument);
+  if (number == nullptr) {
+    throw RuntimeError(name, "Expected a number, got " + stringify(argument));
+  }
+  return *number;
+}
+
+/// The Float64Array argument of the method name of self, which must have the
+/// length of self
+const Float64Array &operand_argument(const Token::Value &argument,
+                                     const Float64Array &self,
+                                     const Token &name) {
+  const auto *other = get_object_as<Float64Array>(argument);
+  if (other == nullptr) {
+    throw RuntimeError(name,
+                       "Expected a Float64Array, got " + stringify(argument));
+  }
+  if (other->elements.size() != self.elements.size()) {
+    throw RuntimeError(name, "Float64Array lengths differ: " +
+                                 std::to_string(self.elements.size()) +
+                                 " and " +
+                                 std::to_string(other->elements.size()));
+  }
+  return *other;
+}
+
+const std::vector<double> &nonempty(const Float64Array &self,
+                                    const Token &name) {
+  if (self.elements.empty()) {
+    throw RuntimeError(name, "Can't take the " + name.lexeme +
+                                 " of an empty Float64Array");
+  }
+  return self.elements;
+}
+
+/// A new array of the size of self, filled in by fill(output)
+template <typename Fill>
+Token::Value new_array(const Float64Array &self, Fill &&fill) {
+  auto result = std::make_shared<Float64Array>(
+      std::vector<double>(self.elements.size()));
+  fill(result->elements.data());
+  return ObjectPtr{std::move(result)};
+}
+} // namespace
+
+Float64Array::Float64Array(std::vector<double> _elements)
+    : elements(std::move(_elements)) {}
+
+double &Float64Array::at(const Token::Value &index, const Operator &bracket) {
+  return elements[checked_index(index, elements.size(), bracket)];
+}
+
+Float64ArrayPtr Float64Array::slice(const Token::Value &start,
+                                    const Token::Value &end,
+                                    const Operator &bracket) const {
+  const auto [first, last] =
+      checked_range(start, end, elements.size(), bracket);
+  return std::make_shared<Float64Array>(std::vector<double>(
+      elements.begin() + static_cast<std::ptrdiff_t>(first),
+      elements.begin() + static_cast<std::ptrdiff_t>(last)));
+}
+
+std::string Float64Array::to_string() const {
+  std::string string = "Float64Array[";
+  for (size_t i = 0; i < elements.size(); ++i) {
+    if (i > 0) {
+      string += ", ";
+    }
+    string += stringify(elements[i]);
+  }
+  return string + "]";
+}
+
+Token::Value Float64Array::get(const Token &name, Interpreter &interpreter) {
+  // Methods get the array, their name for errors and their arguments
+  const auto method = [this, &name](size_t arity, auto body) {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        name.lexeme, arity,
+        [self = shared_from_this(), name,
+         body](Interpreter &, const Arguments &arguments) -> Token::Value {
+          return body(*self, name, arguments);
+        })};
+  };
+  const auto &lexeme = name.lexeme;
+
+  if (lexeme == "sum") {
+    return method(0, [](Float64Array &self, const Token &, const Arguments &) {
+      return NumericKernels::sum(self.elements.data(), self.elements.size());
+    });
+  }
+  if (lexeme == "min" || lexeme == "max") {
+    auto *const kernel = lexeme == "min" ? NumericKernels::min
+                                         : NumericKernels::max;
+    return method(0, [kernel](Float64Array &self, const Token &name,
+                              const Arguments &) {
+      const auto &elements = nonempty(self, name);
+      return kernel(elements.data(), elements.size());
+    });
+  }
+  if (lexeme == "dot") {
+    return method(1, [](Float64Array &self, const Token &name,
+                        const Arguments &arguments) {
+      const auto &other = operand_argument(arguments[0], self, name);
+      return NumericKernels::dot(self.elements.data(), other.elements.data(),
+                                 self.elements.size());
+    });
+  }
+  if (lexeme == "add" || lexeme == "mul") {
+    auto *const kernel = lexeme == "add" ? NumericKernels::add
+                                         : NumericKernels::mul;
+    return method(1, [kernel](Float64Array &self, const Token &name,
+                              const Arguments &arguments) {
+      const auto &other = operand_argument(arguments[0], self, name);
+      return new_array(self, [&](double *out) {
+        kernel(self.elements.data(), other.elements.data(), out,
+               self.elements.size());
+      });
+    });
+  }
+  if (lexeme == "scale") {
+    return method(1, [](Float64Array &self, const Token &name,
+                        const Arguments &arguments) {
+      const auto k = number_argument(arguments[0], name);
+      return new_array(self, [&](double *out) {
+        NumericKernels::scale(self.elements.data(), k, out,
+                              self.elements.size());
+      });
+    });
+  }
+  if (lexeme == "prefixSum") {
+    return method(0, [](Float64Array &self, const Token &, const Arguments &) {
+      return new_array(self, [&](double *out) {
+        NumericKernels::prefix_sum(self.elements.data(), out,
+                                   self.elements.size());
+      });
+    });
+  }
+  if (lexeme == "axpy") {
+    return method(2, [](Float64Array &self, const Token &name,
+                        const Arguments &arguments) {
+      const auto alpha = number_argument(arguments[0], name);
+      const auto &x = operand_argument(arguments[1], self, name);
+      NumericKernels::axpy(alpha, x.elements.data(), self.elements.data(),
+                           self.elements.size());
+      return Token::Value{NullType{}};
+    });
+  }
+  if (lexeme == "sort") {
+    return method(0, [](Float64Array &self, const Token &, const Arguments &) {
+      NumericKernels::sort(self.elements.data(), self.elements.size());
+      return Token::Value{NullType{}};
+    });
+  }
+  return Object::get(name, interpreter);
+}
+
+std::shared_ptr<Iterator> Float64Array::iterate() {
+  return std::make_shared<Float64ArrayIterator>(shared_from_this());
+}
@@ -0,0 +1,293 @@
+#include "fork_map.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "channel.hpp"
+#include "error.hpp"
+#include "interpreter.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define LOX_HAS_FORK
+#endif
+
+#ifdef LOX_HAS_FORK
+namespace {
+/// Frames a worker writes: kind, payload size, then a serialized result or the
+/// line of an error followed by its message
+enum class FrameKind : uint8_t { RESULT, ERROR };
+
+constexpr size_t FRAME_HEADER_SIZE = sizeof(FrameKind) + sizeof(uint32_t);
+
+/// Location of the calls of the mapped function, which have no call
+/// expression in the worker
+constexpr Operator WORKER_CALL{Token::TokenType::LEFT_PAREN, 0};
+
+/// Write a frame to the pipe. Workers can't do anything about a broken pipe,
+/// so they just stop
+void write_frame(int fd, FrameKind kind, std::string_view payload) {
+  std::string frame;
+  frame.reserve(FRAME_HEADER_SIZE + payload.size());
+  frame.push_back(static_cast<char>(kind));
+  const auto size = static_cast<uint32_t>(payload.size());
+  frame.append(reinterpret_cast<const char *>(&size), sizeof(size));
+  frame.append(payload);
+
+  for (std::string_view rest{frame}; !rest.empty();) {
+    const auto written = ::write(fd, rest.data(), rest.size());
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      ::_exit(1);
+    }
+    rest.remove_prefix(static_cast<size_t>(written));
+  }
+}
+
+/// Error frame payload for an error at line
+std::string error_payload(uint32_t line, std::string_view message) {
+  std::string payload(reinterpret_cast<const char *>(&line), sizeof(line));
+  payload.append(message);
+  return payload;
+}
+
+/// Body of a forked worker. Never returns: exit handlers and destructors of
+/// the parent's state, like the thread pool, must not run in the worker
+[[noreturn]] void run_worker(Interpreter &interpreter,
+                             const std::vector<Token::Value> &inputs,
+                             const CallablePtr &function, size_t first,
+                             size_t step, int fd) {
+  int status = 0;
+  interpreter.runs_event_loop = false;
+  try {
+    std::string payload;
+    for (size_t i = first; i < inputs.size(); i += step) {
+      const auto result = interpreter.call(*function, {inputs[i]}, WORKER_CALL);
+      payload.clear();
+      Message::encode(result).serialize(payload);
+      write_frame(fd, FrameKind::RESULT, payload);
+    }
+  } catch (const Exit &) {
+    write_frame(fd, FrameKind::ERROR,
+                error_payload(0, "exit() called in a forkMap worker"));
+    status = 1;
+  } catch (const RuntimeError &e) {
+    write_frame(fd, FrameKind::ERROR, error_payload(e.token.line, e.what()));
+    status = 1;
+  } catch (const std::exception &e) {
+    write_frame(fd, FrameKind::ERROR, error_payload(0, e.what()));
+    status = 1;
+  }
+
+  interpreter.out_stream.flush();
+  std::cout.flush();
+  ::_exit(status);
+}
+
+/// A forked worker, as seen by the parent
+struct Worker {
+  pid_t pid = -1;
+  /// Read end of the pipe, -1 once the worker closed it
+  int fd = -1;
+  /// Bytes of frames not complete yet
+  std::string buffer;
+  size_t received = 0;
+};
+
+/// Threads of this process, or 0 if they can't be counted
+size_t thread_count() {
+#ifdef __linux__
+  size_t count = 0;
+  std::error_code error;
+  for (std::filesystem::directory_iterator task{"/proc/self/task", error}, end;
+       !error && task != end; task.increment(error)) {
+    ++count;
+  }
+  return error ? 0 : count;
+#else
+  return 0;
+#endif
+}
+
+/// Workers still running are killed when forkMap fails
+struct Workers {
+  explicit Workers(size_t count) : list(count) {}
+  ~Workers() {
+    for (auto &worker : list) {
+      if (worker.fd >= 0) {
+        ::close(worker.fd);
+      }
+      if (worker.pid > 0) {
+        ::kill(worker.pid, SIGKILL);
+        ::waitpid(worker.pid, nullptr, 0);
+      }
+    }
+  }
+
+  Workers(const Workers &) = delete;
+  Workers(Workers &&) = delete;
+  Workers &operator=(const Workers &) = delete;
+  Workers &operator=(Workers &&) = delete;
+
+  std::vector<Worker> list;
+};
+
+/// Decode the complete frames at the front of the buffer of worker, which
+/// computed every step-th result starting at first
+void receive_frames(Interpreter &interpreter, Worker &worker, size_t first,
+                    size_t step, std::vector<Token::Value> &results) {
+  std::string_view rest{worker.buffer};
+  while (rest.size() >= FRAME_HEADER_SIZE) {
+    uint32_t size = 0;
+    std::memcpy(&size, rest.data() + sizeof(FrameKind), sizeof(size));
+    if (rest.size() < FRAME_HEADER_SIZE + size) {
+      break;
+    }
+    const auto kind = static_cast<FrameKind>(rest.front());
+    auto payload = rest.substr(FRAME_HEADER_SIZE, size);
+    rest.remove_prefix(FRAME_HEADER_SIZE + size);
+
+    if (kind == FrameKind::ERROR) {
+      // Reported at the line the worker failed at
+      uint32_t line = 0;
+      if (payload.size() >= sizeof(line)) {
+        std::memcpy(&line, payload.data(), sizeof(line));
+        payload.remove_prefix(sizeof(line));
+      }
+      throw RuntimeError(Token{Token::TokenType::FUN, "forkMap", NullType{},
+                               line},
+                         "worker failed: " + std::string{payload});
+    }
+    const auto index = first + worker.received * step;
+    if (index >= results.size()) {
+      throw RuntimeError("forkMap worker sent more results than inputs");
+    }
+    results[index] = Message::deserialize(payload).decode(interpreter);
+    ++worker.received;
+  }
+  worker.buffer.erase(0, worker.buffer.size() - rest.size());
+}
+} // namespace
+
+std::vector<Token::Value> fork_map(Interpreter &interpreter,
+                                   const std::vector<Token::Value> &inputs,
+                                   const CallablePtr &function,
+                                   size_t workers) {
+  std::vector<Token::Value> results(inputs.size(), NullType{});
+  workers = std::min(workers, inputs.size());
+  if (workers == 0) {
+    return results;
+  }
+  // A forked worker only has the thread that forked it. Any other thread may
+  // have held a lock at the fork, like one of the thread pool or the
+  // ModuleCache, which then stays locked forever in the worker
+  if (thread_count() > 1) {
+    throw RuntimeError("forkMap can't fork a process that runs other threads, "
+                       "like those of spawn(), readFileAsync() or --serve");
+  }
+
+  // Buffered output would be written again by every worker
+  interpreter.out_stream.flush();
+  std::cout.flush();
+
+  Workers forked{workers};
+  for (size_t i = 0; i < workers; ++i) {
+    std::array<int, 2> pipe_fds{};
+    if (::pipe(pipe_fds.data()) != 0) {
+      throw RuntimeError(std::string{"Can't create forkMap pipe: "} +
+                         std::strerror(errno));
+    }
+    ::fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+
+    const auto pid = ::fork();
+    if (pid == 0) {
+      ::close(pipe_fds[0]);
+      run_worker(interpreter, inputs, function, i, workers, pipe_fds[1]);
+    }
+    ::close(pipe_fds[1]);
+    if (pid < 0) {
+      ::close(pipe_fds[0]);
+      throw RuntimeError(std::string{"Can't fork forkMap worker: "} +
+                         std::strerror(errno));
+    }
+    forked.list[i].pid = pid;
+    forked.list[i].fd = pipe_fds[0];
+  }
+
+  // Results are decoded as they arrive, while the workers compute more
+  std::array<char, 64 * 1024> chunk{};
+  std::vector<pollfd> ready;
+  std::vector<size_t> ready_workers;
+  for (size_t open = workers; open > 0;) {
+    ready.clear();
+    ready_workers.clear();
+    for (size_t i = 0; i < workers; ++i) {
+      if (forked.list[i].fd >= 0) {
+        ready.push_back(pollfd{forked.list[i].fd, POLLIN, 0});
+        ready_workers.push_back(i);
+      }
+    }
+    if (::poll(ready.data(), ready.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw RuntimeError(std::string{"Can't wait for forkMap workers: "} +
+                         std::strerror(errno));
+    }
+
+    for (size_t r = 0; r < ready.size(); ++r) {
+      if (ready[r].revents == 0) {
+        continue;
+      }
+      const auto i = ready_workers[r];
+      auto &worker = forked.list[i];
+
+      const auto size = ::read(worker.fd, chunk.data(), chunk.size());
+      if (size < 0 && errno == EINTR) {
+        continue;
+      }
+      if (size > 0) {
+        worker.buffer.append(chunk.data(), static_cast<size_t>(size));
+        receive_frames(interpreter, worker, i, workers, results);
+        continue;
+      }
+
+      ::close(worker.fd);
+      worker.fd = -1;
+      --open;
+      const auto expected = (inputs.size() - i + workers - 1) / workers;
+      if (worker.received != expected || !worker.buffer.empty()) {
+        throw RuntimeError("forkMap worker " + std::to_string(i) +
+                           " exited before returning all results");
+      }
+    }
+  }
+
+  for (auto &worker : forked.list) {
+    ::waitpid(worker.pid, nullptr, 0);
+    worker.pid = -1;
+  }
+  return results;
+}
+#else
+std::vector<Token::Value> fork_map(Interpreter &,
+                                   const std::vector<Token::Value> &,
+                                   const CallablePtr &, size_t) {
+  throw RuntimeError("forkMap needs fork(), which this platform lacks");
+}
+#endif
@@ -1,15 +1,27 @@
 #include "function.hpp"
+#include "generator.hpp"
 #include "interpreter.hpp"
 #include "logging.hpp"
+#include <algorithm>
 #include <cassert>
 
-using FuncPtr = const FunctionStmt *;
-using LambdaPtr = const Lambda *;
+using FuncPtr = FunctionStmt *;
+using LambdaPtr = Lambda *;
 
 Function::Function(
-    const std::variant<const FunctionStmt *, const Lambda *> &_declaration,
-    std::shared_ptr<Environment> _closure, FunctionKind _kind)
-    : declaration(_declaration), closure(std::move(_closure)), kind(_kind) {}
+    const std::variant<FunctionStmt *, Lambda *> &_declaration,
+    std::shared_ptr<Environment> _closure, FunctionKind _kind,
+    std::shared_ptr<CompilationUnit> _unit, Environment *_globals)
+    : declaration(_declaration), closure(std::move(_closure)), kind(_kind),
+      unit(std::move(_unit)), globals(_globals) {}
+
+const std::string &Function::name() const {
+  static const std::string lambda = "lambda";
+  if (const auto *decl = std::get_if<FuncPtr>(&declaration)) {
+    return (*decl)->child<0>().lexeme;
+  }
+  return lambda;
+}
 
 const std::vector<Token> &Function::parameters() const {
   if (const auto *decl = std::get_if<FuncPtr>(&declaration)) {
@@ -37,6 +49,15 @@ const std::vector<stmt> &Function::body() const {
 
 Token::Value Function::call(Interpreter &interpreter,
                             const std::vector<Token::Value> &arguments) {
+  // Bodies skipped by a lazy parse are parsed on first call
+  std::visit(
+      [&interpreter](auto *decl) {
+        materialize(*decl, interpreter.err_handler);
+      },
+      declaration);
+
+  // The body runs in the unit and module the function was declared in
+  const Interpreter::CurrentUnit current{interpreter, unit.get(), globals};
   auto environment = std::make_shared<Environment>(closure);
 
   LOG_DEBUG("Calling func with closure: ", *environment, " enclosed by ",
@@ -50,8 +71,16 @@ Token::Value Function::call(Interpreter &interpreter,
     environment->define(parameter);
   }
 
+  // A 'yield' anywhere in the body makes its top-level statement suspend
+  const auto &statements = body();
+  if (std::any_of(statements.begin(), statements.end(),
+                  [](const auto *statement) { return statement->suspends; })) {
+    return ObjectPtr{std::make_shared<Generator>(std::move(environment),
+                                                 statements, unit, globals)};
+  }
+
   try {
-    interpreter.execute_block(body(), std::move(environment));
+    interpreter.execute_block(statements, std::move(environment));
   } catch (const Interpreter::Return &returned) // Early return
   {
     if (kind ==
@@ -94,5 +123,6 @@ std::string Function::to_string() const {
 FunctionPtr Function::bind(InstancePtr instance) {
   auto env = std::make_shared<Environment>(closure);
   env->define("this", std::move(instance));
-  return std::make_shared<Function>(declaration, std::move(env), kind);
+  return std::make_shared<Function>(declaration, std::move(env), kind, unit,
+                                    globals);
 }
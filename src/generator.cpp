@@ -0,0 +1,135 @@
+#include "generator.hpp"
+
+#include "error.hpp"
+#include "interpreter.hpp"
+
+Generator::Generator(std::shared_ptr<Environment> parameters,
+                     const std::vector<stmt> &body,
+                     std::shared_ptr<CompilationUnit> _unit,
+                     Environment *_globals)
+    : unit(std::move(_unit)), globals(_globals) {
+  // Like a called function, the body block gets its own environment
+  frames.push_back(Frame{&body, 0, nullptr, nullptr,
+                         std::make_shared<Environment>(std::move(parameters))});
+}
+
+std::optional<Token::Value> Generator::next(Interpreter &interpreter) {
+  if (running) {
+    throw RuntimeError("Generator is already running");
+  }
+  if (frames.empty()) {
+    return std::nullopt;
+  }
+
+  // The body runs in the unit and module the function was declared in
+  const Interpreter::CurrentUnit current{interpreter, unit.get(), globals};
+  auto original_env = interpreter.environment;
+  running = true;
+
+  std::optional<Token::Value> value;
+  try {
+    value = resume(interpreter);
+  } catch (const Interpreter::Return &) {
+    frames.clear(); // Returned values end the generator, but aren't yielded
+  } catch (...) {
+    frames.clear();
+    running = false;
+    interpreter.environment = std::move(original_env);
+    throw;
+  }
+
+  running = false;
+  interpreter.environment = std::move(original_env);
+  return value;
+}
+
+std::optional<Token::Value> Generator::resume(Interpreter &interpreter) {
+  while (not frames.empty()) {
+    // Entering a statement may push a frame, invalidating the reference
+    auto &frame = frames.back();
+    auto environment = frame.environment;
+    std::optional<Token::Value> value;
+
+    if (frame.block != nullptr) {
+      if (frame.next == frame.block->size()) {
+        frames.pop_back();
+        continue;
+      }
+      auto *statement = (*frame.block)[frame.next++];
+      value = enter(interpreter, statement, std::move(environment));
+    } else if (auto *loop = dynamic_cast<WhileStmt *>(frame.loop)) {
+      interpreter.environment = environment;
+      if (not is_truthy(interpreter.get_evaluated(loop->child<0>()))) {
+        frames.pop_back();
+        continue;
+      }
+      value = enter(interpreter, loop->child<1>(), std::move(environment));
+    } else {
+      auto &for_in = static_cast<ForInStmt &>(*frame.loop);
+      auto element = frame.iterator->next(interpreter);
+      if (not element.has_value()) {
+        frames.pop_back();
+        continue;
+      }
+      auto iteration = std::make_shared<Environment>(std::move(environment));
+      iteration->define(for_in.child<1>().lexeme, std::move(*element));
+      value = enter(interpreter, for_in.child<3>(), std::move(iteration));
+    }
+
+    if (value.has_value()) {
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Token::Value>
+Generator::enter(Interpreter &interpreter, Statement *statement,
+                 std::shared_ptr<Environment> environment) {
+  interpreter.environment = environment;
+
+  if (not statement->suspends) {
+    interpreter.execute(statement);
+    return std::nullopt;
+  }
+  if (auto *yield = dynamic_cast<YieldStmt *>(statement)) {
+    return interpreter.get_evaluated(yield->child<1>());
+  }
+  if (auto *block = dynamic_cast<BlockStmt *>(statement)) {
+    frames.push_back(
+        Frame{&block->child<0>(), 0, nullptr, nullptr,
+              std::make_shared<Environment>(std::move(environment))});
+  } else if (auto *branch = dynamic_cast<IfStmt *>(statement)) {
+    auto *taken = is_truthy(interpreter.get_evaluated(branch->child<0>()))
+                      ? branch->child<1>()
+                      : branch->child<2>();
+    return enter(interpreter, taken, std::move(environment));
+  } else if (auto *loop = dynamic_cast<WhileStmt *>(statement)) {
+    frames.push_back(Frame{nullptr, 0, loop, nullptr, std::move(environment)});
+  } else if (auto *for_in = dynamic_cast<ForInStmt *>(statement)) {
+    auto iterator = interpreter.iterate(
+        for_in->child<0>(), interpreter.get_evaluated(for_in->child<2>()));
+    frames.push_back(Frame{nullptr, 0, for_in, std::move(iterator),
+                           std::move(environment)});
+  }
+  return std::nullopt;
+}
+
+std::string Generator::to_string() const {
+  return frames.empty() ? "<Generator done>" : "<Generator>";
+}
+
+Token::Value Generator::get(const Token &name, Interpreter &interpreter) {
+  if (name.lexeme == "next") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "next", 0,
+        [generator = std::static_pointer_cast<Generator>(shared_from_this())](
+            Interpreter &caller, const auto &) {
+          return generator->next(caller).value_or(NullType{});
+        })};
+  }
+  if (name.lexeme == "done") {
+    return frames.empty();
+  }
+  return Object::get(name, interpreter);
+}
@@ -1,10 +1,74 @@
 #include "instance.hpp"
 
+#include <memory>
+#include <new>
+
 #include "error.hpp"
 #include "interpreter.hpp"
 #include "logging.hpp"
 
-Instance::Instance(ClassPtr _klass) : klass(std::move(_klass)) {}
+namespace {
+/// Allocates the block of std::allocate_shared() with room for the field
+/// values of a record after it, and points the RecordStorage at that room
+/// before the instance is constructed
+template <typename T> struct RecordAllocator {
+  using value_type = T;
+
+  RecordAllocator(size_t _field_count, Instance::RecordStorage *_storage)
+      : field_count(_field_count), storage(_storage) {}
+
+  template <typename U>
+  RecordAllocator(const RecordAllocator<U> &other) // NOLINT: rebinding
+      : field_count(other.field_count), storage(other.storage) {}
+
+  T *allocate(size_t n) {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    auto *block = static_cast<char *>(::operator new(size(n)));
+    storage->values = reinterpret_cast<Token::Value *>(block + offset(n));
+    return reinterpret_cast<T *>(block);
+  }
+
+  void deallocate(T *block, size_t n) { ::operator delete(block, size(n)); }
+
+  template <typename U> bool operator==(const RecordAllocator<U> &other) const {
+    return field_count == other.field_count;
+  }
+
+  size_t field_count;
+  Instance::RecordStorage *storage;
+
+private:
+  static size_t offset(size_t n) {
+    constexpr auto alignment = alignof(Token::Value);
+    return (n * sizeof(T) + alignment - 1) / alignment * alignment;
+  }
+
+  size_t size(size_t n) const {
+    return offset(n) + field_count * sizeof(Token::Value);
+  }
+};
+} // namespace
+
+InstancePtr make_instance(ClassPtr klass) {
+  const auto field_count = klass->fields().size();
+  if (field_count == 0) {
+    return std::make_shared<Instance>(std::move(klass),
+                                      Instance::RecordStorage{});
+  }
+  // The allocator fills in storage before the instance is constructed from it
+  Instance::RecordStorage storage;
+  return std::allocate_shared<Instance>(
+      RecordAllocator<Instance>{field_count, &storage}, std::move(klass),
+      storage);
+}
+
+Instance::Instance(ClassPtr _klass, const RecordStorage &storage)
+    : klass(std::move(_klass)), values(storage.values) {
+  std::uninitialized_fill_n(values, klass->fields().size(),
+                            Token::Value{NullType{}});
+}
+
+Instance::~Instance() { std::destroy_n(values, klass->fields().size()); }
 
 std::string Instance::to_string() const { return klass->name() + " instance"; }
 
@@ -14,13 +78,18 @@ Token::Value Instance::get_field(const Token &name, Interpreter &interpreter) {
     return getter->bind(shared_from_this())->call(interpreter, {});
   }
 
-  if (fields.contains(name.lexeme)) {
-    return fields.at(name.lexeme);
+  if (const auto index = klass->field_index(name.lexeme)) {
+    return values[*index];
   }
+  if (fields != nullptr) {
+    if (const auto found = fields->find(name.lexeme); found != fields->end()) {
+      return found->second;
+    }
 
-  LOG_WARNING("Undefined property on object with fields: ");
-  for (const auto &field : fields) {
-    LOG_WARNING(field.first, ": ", field.second);
+    LOG_WARNING("Undefined property on object with fields: ");
+    for (const auto &field : *fields) {
+      LOG_WARNING(field.first, ": ", field.second);
+    }
   }
 
   if (const auto &method = klass->get_method(name.lexeme)) {
@@ -39,5 +108,27 @@ void Instance::set_field(const Token &name, Token::Value value) {
     throw RuntimeError(name, "A getter by this name exists. A property of the "
                              "same name would be inaccessible");
 
-  fields[name.lexeme] = std::move(value);
-}
\ No newline at end of file
+  if (const auto index = klass->field_index(name.lexeme)) {
+    values[*index] = std::move(value);
+  } else if (klass->is_record()) {
+    throw RuntimeError(name, "Record class " + klass->name() +
+                                 " has no field " + name.lexeme);
+  } else {
+    restore_field(name.lexeme, std::move(value));
+  }
+}
+
+void Instance::restore_field(const std::string &name, Token::Value value) {
+  if (const auto index = klass->field_index(name)) {
+    values[*index] = std::move(value);
+    return;
+  }
+  if (klass->is_record()) {
+    throw RuntimeError("Record class " + klass->name() + " has no field " +
+                       name);
+  }
+  if (fields == nullptr) {
+    fields = std::make_unique<std::unordered_map<std::string, Token::Value>>();
+  }
+  fields->insert_or_assign(name, std::move(value));
+}
@@ -0,0 +1,289 @@
+#include "instrumentation.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compilation_unit.hpp"
+
+namespace Instrumentation::detail {
+/// Counters of a node
+struct Counters {
+  std::string file;
+  unsigned line = 0;
+  uint64_t statements = 0;
+  uint64_t calls = 0;
+  uint64_t iterations = 0;
+  uint64_t self_ns = 0;
+};
+} // namespace Instrumentation::detail
+
+namespace {
+using Instrumentation::detail::Counters;
+
+constexpr size_t TEXT_REPORT_LINES = 30;
+
+/// Line of the first token of a node, or 0 if it has none, like a literal
+struct LineFinder : public ExprVisitor, public StmtVisitor {
+  unsigned line = 0;
+
+  template <typename Child> void find(Child &child) {
+    using T = std::remove_cv_t<Child>;
+    if (line != 0) {
+      return;
+    }
+    if constexpr (std::is_same_v<T, Token>) {
+      line = child.line;
+    } else if constexpr (std::is_same_v<T, Operator>) {
+      line = child.line;
+    } else if constexpr (std::is_pointer_v<T>) {
+      using Node = std::remove_pointer_t<T>;
+      if (child == nullptr) {
+        return;
+      }
+      if constexpr (std::is_base_of_v<Expr, Node>) {
+        dynamic_cast<ExprVisitableBase &>(*child).accept(*this);
+      } else if constexpr (std::is_base_of_v<Statement, Node>) {
+        dynamic_cast<StmtVisitableBase &>(*child).accept(*this);
+      }
+    } else if constexpr (requires { child.begin(); } &&
+                         !std::is_same_v<T, std::string>) {
+      for (auto &element : child) {
+        find(element);
+      }
+    }
+  }
+
+  template <typename Node> void find_in(Node &node) {
+    std::apply([this](auto &...children) { (find(children), ...); },
+               node.derivatives);
+  }
+
+  DECLARE_EXPR_VISIT_METHODS
+
+  DECLARE_STMT_VISIT_METHODS
+};
+
+void LineFinder::visit(Assign &node) { find_in(node); }
+void LineFinder::visit(Logical &node) { find_in(node); }
+void LineFinder::visit(Variable &node) { find_in(node); }
+void LineFinder::visit(Empty &node) { find_in(node); }
+void LineFinder::visit(Literal &node) { find_in(node); }
+void LineFinder::visit(Unary &node) { find_in(node); }
+void LineFinder::visit(Binary &node) { find_in(node); }
+void LineFinder::visit(Ternary &node) { find_in(node); }
+void LineFinder::visit(Malformed &node) { find_in(node); }
+void LineFinder::visit(Call &node) { find_in(node); }
+void LineFinder::visit(Grouping &node) { find_in(node); }
+void LineFinder::visit(Lambda &node) { find_in(node); }
+void LineFinder::visit(Get &node) { find_in(node); }
+void LineFinder::visit(Set &node) { find_in(node); }
+void LineFinder::visit(This &node) { find_in(node); }
+void LineFinder::visit(Super &node) { find_in(node); }
+void LineFinder::visit(ArrayLiteral &node) { find_in(node); }
+void LineFinder::visit(Index &node) { find_in(node); }
+void LineFinder::visit(IndexSet &node) { find_in(node); }
+void LineFinder::visit(Slice &node) { find_in(node); }
+void LineFinder::visit(VarStmt &node) { find_in(node); }
+void LineFinder::visit(MalformedStmt &node) { find_in(node); }
+void LineFinder::visit(BlockStmt &node) { find_in(node); }
+void LineFinder::visit(PrintStmt &node) { find_in(node); }
+void LineFinder::visit(ExprStmt &node) { find_in(node); }
+void LineFinder::visit(IfStmt &node) { find_in(node); }
+void LineFinder::visit(WhileStmt &node) { find_in(node); }
+void LineFinder::visit(EmptyStmt &node) { find_in(node); }
+void LineFinder::visit(FunctionStmt &node) { find_in(node); }
+void LineFinder::visit(ReturnStmt &node) { find_in(node); }
+void LineFinder::visit(ClassStmt &node) { find_in(node); }
+void LineFinder::visit(ImportStmt &node) { find_in(node); }
+void LineFinder::visit(YieldStmt &node) { find_in(node); }
+void LineFinder::visit(ForInStmt &node) { find_in(node); }
+
+/// Counters of the lines run by a thread, by file. Kept after the thread
+/// exits, for the report. Keyed by location rather than by node, as the
+/// arenas of eval() and of lazily parsed bodies are freed while the program
+/// runs, and their addresses reused
+struct Table {
+  std::map<std::filesystem::path::string_type,
+           std::unordered_map<unsigned, Counters>, std::less<>>
+      files;
+};
+
+std::mutex tables_mutex;
+std::vector<std::shared_ptr<Table>> tables;
+
+Table &thread_table() {
+  thread_local const std::shared_ptr<Table> table = [] {
+    auto created = std::make_shared<Table>();
+    const std::scoped_lock lock{tables_mutex};
+    tables.push_back(created);
+    return created;
+  }();
+  return *table;
+}
+
+/// Self time of the innermost timer is the part not in nested timers
+thread_local uint64_t *innermost_nested = nullptr;
+
+unsigned line_of(Statement &statement) {
+  LineFinder finder;
+  dynamic_cast<StmtVisitableBase &>(statement).accept(finder);
+  return finder.line;
+}
+
+Counters &counters(const CompilationUnit *unit, unsigned line) {
+  static const std::filesystem::path::string_type no_file;
+  const auto &file = unit != nullptr ? unit->path.native() : no_file;
+  auto &files = thread_table().files;
+  auto found = files.find(file);
+  if (found == files.end()) {
+    found = files.try_emplace(file).first;
+  }
+  return found->second[line];
+}
+
+std::string json_string(std::string_view string) {
+  std::ostringstream out;
+  out << '"';
+  for (const char c : string) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << static_cast<int>(c) << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+} // namespace
+
+namespace Instrumentation::detail {
+Timer::Timer(Statement &statement, const CompilationUnit *unit)
+    : counters(&::counters(unit, line_of(statement))) {
+  ++counters->statements;
+  start();
+}
+
+Timer::Timer(unsigned line, const CompilationUnit *unit)
+    : counters(&::counters(unit, line)) {
+  ++counters->calls;
+  start();
+}
+
+void Timer::start() {
+  enclosing_nested = std::exchange(innermost_nested, &nested);
+  started = std::chrono::steady_clock::now();
+}
+
+Timer::~Timer() {
+  const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - started)
+                               .count();
+  counters->self_ns += elapsed - std::min(nested, elapsed);
+  innermost_nested = enclosing_nested;
+  if (enclosing_nested != nullptr) {
+    *enclosing_nested += elapsed;
+  }
+}
+
+void count_iteration(Statement &loop, const CompilationUnit *unit) {
+  ++::counters(unit, line_of(loop)).iterations;
+}
+} // namespace Instrumentation::detail
+
+void Instrumentation::report() {
+  // Lines add up over threads. Nodes without a line, like the empty
+  // statement of an omitted else, are left out
+  std::map<std::pair<std::string, unsigned>, Counters> lines;
+  {
+    const std::scoped_lock lock{tables_mutex};
+    for (const auto &table : tables) {
+      for (const auto &[file, file_lines] : table->files) {
+        for (const auto &[number, counters] : file_lines) {
+          if (number == 0) {
+            continue;
+          }
+          const auto name = std::filesystem::path{file}.string();
+          auto &line = lines[{name, number}];
+          line.file = name;
+          line.line = number;
+          line.statements += counters.statements;
+          line.calls += counters.calls;
+          line.iterations += counters.iterations;
+          line.self_ns += counters.self_ns;
+        }
+      }
+    }
+  }
+
+  std::vector<Counters> sorted;
+  sorted.reserve(lines.size());
+  for (auto &[location, counters] : lines) {
+    sorted.push_back(std::move(counters));
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Counters &left, const Counters &right) {
+              const auto left_count = left.statements + left.calls;
+              const auto right_count = right.statements + right.calls;
+              return left.self_ns != right.self_ns
+                         ? left.self_ns > right.self_ns
+                         : left_count > right_count;
+            });
+
+  const char *path = std::getenv("LOX_INSTRUMENT_REPORT");
+  std::ofstream file;
+  if (path != nullptr && *path != '\0') {
+    file.open(path);
+    if (!file) {
+      std::cerr << "Instrumentation report " << path
+                << " could not be written\n";
+      return;
+    }
+  }
+  std::ostream &out = file.is_open() ? file : std::cerr;
+
+  if (path != nullptr && std::string_view{path}.ends_with(".json")) {
+    out << "[\n";
+    for (size_t i = 0; i < sorted.size(); ++i) {
+      const auto &line = sorted[i];
+      out << "  {\"file\": " << json_string(line.file)
+          << ", \"line\": " << line.line << ", \"self_ns\": " << line.self_ns
+          << ", \"statements\": " << line.statements
+          << ", \"calls\": " << line.calls
+          << ", \"iterations\": " << line.iterations << '}'
+          << (i + 1 < sorted.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return;
+  }
+
+  out << "Lines by self time\n"
+      << std::setw(12) << "self ms" << std::setw(14) << "statements"
+      << std::setw(12) << "calls" << std::setw(12) << "iterations"
+      << "  line\n";
+  for (size_t i = 0; i < std::min(sorted.size(), TEXT_REPORT_LINES); ++i) {
+    const auto &line = sorted[i];
+    out << std::fixed << std::setprecision(3) << std::setw(12)
+        << static_cast<double>(line.self_ns) / 1e6 << std::setw(14)
+        << line.statements << std::setw(12) << line.calls << std::setw(12)
+        << line.iterations << "  "
+        << (line.file.empty() ? "<input>" : line.file) << ':' << line.line
+        << '\n';
+  }
+}
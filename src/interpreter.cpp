@@ -1,36 +1,69 @@
 #include "interpreter.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
+#include <utility>
 
+#include "array.hpp"
 #include "buildin.hpp"
 #include "callable.hpp"
 #include "class.hpp"
+#include "float64_array.hpp"
 #include "function.hpp"
 #include "instance.hpp"
+#include "instrumentation.hpp"
 #include "logging.hpp"
+#include "map.hpp"
+#include "module.hpp"
+#include "object.hpp"
+#include "profiler.hpp"
+#include "string_methods.hpp"
 
 using Type = Token::TokenType;
 
 Interpreter::Interpreter(std::ostream &_os,
                          std::shared_ptr<ErrorHandler> _err_handler)
-    : out_stream(_os), globals(std::make_shared<Environment>()),
-      environment(globals), err_handler(std::move(_err_handler)),
+    : out_stream(_os), builtins(std::make_shared<Environment>()),
+      globals(std::make_shared<Environment>(builtins)), environment(globals),
+      current_globals(globals.get()), err_handler(std::move(_err_handler)),
       interpreter_path{std::filesystem::current_path().string()} {
   for (const auto &buildin : Buildin::get_buildins()) {
-    globals->define(buildin);
+    builtins->define(buildin);
   }
 }
 
+namespace {
+constexpr const char *MAX_RECURSION_MESSAGE =
+    "Maximum recursion depth reached. Are you recursing without basecase?";
+
+/// True if evaluating expression can't assign variables or call anything, so
+/// a variable may be read in place while it is evaluated
+bool has_no_side_effects(const Expr *expression) {
+  return dynamic_cast<const Literal *>(expression) != nullptr ||
+         dynamic_cast<const Variable *>(expression) != nullptr ||
+         dynamic_cast<const This *>(expression) != nullptr ||
+         dynamic_cast<const Empty *>(expression) != nullptr;
+}
+} // namespace
+
 Interpreter::CheckedRecursiveDepth::CheckedRecursiveDepth(
     Interpreter &_interpreter, const Token &location)
     : interpreter(_interpreter) {
   interpreter.recursion_depth += 1;
   if (interpreter.recursion_depth > MAX_RECURSION_DEPTH) {
     interpreter.recursion_depth -= 1;
-    throw RuntimeError(
-        location,
-        "Maximum recursion depth reached. Are you recursing without basecase?");
+    throw RuntimeError(location, MAX_RECURSION_MESSAGE);
+  }
+}
+
+Interpreter::CheckedRecursiveDepth::CheckedRecursiveDepth(
+    Interpreter &_interpreter, const Operator &location)
+    : interpreter(_interpreter) {
+  interpreter.recursion_depth += 1;
+  if (interpreter.recursion_depth > MAX_RECURSION_DEPTH) {
+    interpreter.recursion_depth -= 1;
+    throw RuntimeError(location, MAX_RECURSION_MESSAGE);
   }
 }
 
@@ -38,6 +71,27 @@ Interpreter::CheckedRecursiveDepth::~CheckedRecursiveDepth() {
   interpreter.recursion_depth -= 1;
 }
 
+Interpreter::CurrentUnit::CurrentUnit(Interpreter &_interpreter,
+                                      CompilationUnit *unit,
+                                      Environment *globals)
+    : interpreter(_interpreter),
+      previous_unit(std::exchange(interpreter.current_unit, unit)),
+      previous_globals(std::exchange(interpreter.current_globals, globals)) {}
+
+Interpreter::CurrentUnit::~CurrentUnit() {
+  interpreter.current_unit = previous_unit;
+  interpreter.current_globals = previous_globals;
+}
+
+FunctionPtr Interpreter::make_function(
+    const std::variant<FunctionStmt *, Lambda *> &declaration,
+    FunctionKind kind) const {
+  auto unit =
+      current_unit != nullptr ? current_unit->shared_from_this() : nullptr;
+  return std::make_shared<Function>(declaration, environment, kind,
+                                    std::move(unit), current_globals);
+}
+
 //----------Top-level interpretation, evaluation and execution methods----------
 
 void Interpreter::interpret(std::vector<stmt> &statements) {
@@ -52,6 +106,21 @@ void Interpreter::interpret(std::vector<stmt> &statements) {
   }
 }
 
+void Interpreter::interpret(CompilationUnit &unit) {
+  ModuleCache::instance().prefetch(unit);
+
+  const CurrentUnit current{*this, &unit, current_globals};
+  interpret(unit.statements);
+}
+
+void Interpreter::run_event_loop() {
+  try {
+    event_loop.run();
+  } catch (const RuntimeError &err) {
+    err_handler->runtime_error(err.token, err.what());
+  }
+}
+
 void Interpreter::execute_block(const std::vector<stmt> &body,
                                 std::shared_ptr<Environment> enclosing_env) {
   auto original_env = environment;
@@ -73,13 +142,15 @@ void Interpreter::execute_block(const std::vector<stmt> &body,
   LOG_DEBUG("Env at and of block execution: ", *environment);
 }
 
-void Interpreter::execute(const stmt &statement) {
+void Interpreter::execute(Statement *statement) {
+  const Instrumentation::Scope counted{*statement, current_unit};
   dynamic_cast<StmtVisitableBase &>(*statement).accept(*this);
 }
 
 /// For a node, get the value of its visit. This is required because we only
-/// have visit functions returning void
-Token::Value Interpreter::get_evaluated(const expr &expression) {
+/// have visit functions returning void. The value is copied, as last_value
+/// must stay valid: eval() returns it, even after a statement or an error
+Token::Value Interpreter::get_evaluated(Expr *expression) {
   dynamic_cast<ExprVisitableBase &>(*expression).accept(*this);
   return last_value;
 }
@@ -99,18 +170,6 @@ template <class... Ts> struct overloaded : Ts... {
 // without
 template <class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
-/* All values except NullType and the bool false are truthy, including "", 0,
- * functions, callables*/
-bool is_truthy(const Token::Value &value) {
-  // clang-format off
-    return std::visit(
-        overloaded{[](bool condition) { return condition; },
-                   [](NullType) { return false; },
-                   [](auto &&) { return true; }
-        }, value);
-  // clang-format on
-}
-
 /// Operands are variants. Returns true only of all variants hold value_type
 /// No operands returns true
 template <typename value_type, typename... Types>
@@ -120,7 +179,7 @@ bool check_operand_types(const Types &...operands) {
 
 /// Throw a RuntimeError if any operand is not of value_type.
 template <typename value_type, typename... Operands>
-void assert_operand_types(const Token &op, const Operands &...operands) {
+void assert_operand_types(const Operator &op, const Operands &...operands) {
   if (not check_operand_types<value_type>(operands...)) {
     if constexpr (std::is_same_v<value_type, double>) {
       throw RuntimeError(op, "Operands must be numbers");
@@ -133,7 +192,8 @@ void assert_operand_types(const Token &op, const Operands &...operands) {
 }
 
 /// Throw a runtime error if the condition is false
-void assert_true(bool condition, const Token &op, const std::string &message) {
+void assert_true(bool condition, const Operator &op,
+                 const std::string &message) {
   if (!condition) {
     throw RuntimeError(op, message);
   }
@@ -141,6 +201,16 @@ void assert_true(bool condition, const Token &op, const std::string &message) {
 
 } // namespace
 
+bool is_truthy(const Token::Value &value) {
+  // clang-format off
+    return std::visit(
+        overloaded{[](bool condition) { return condition; },
+                   [](NullType) { return false; },
+                   [](auto &&) { return true; }
+        }, value);
+  // clang-format on
+}
+
 //-------------Statement Visitor Methods------------------------------------
 
 void Interpreter::visit(ReturnStmt &node) {
@@ -151,8 +221,7 @@ void Interpreter::visit(ReturnStmt &node) {
 void Interpreter::visit(FunctionStmt &node) {
   auto function = node.child<0>();
   LOG_DEBUG("Declaring func ", function.lexeme, " with env: ", *environment);
-  function.value =
-      std::make_shared<Function>(&node, environment, node.child<3>());
+  function.value = make_function(&node, node.child<3>());
   environment->define(std::move(function));
 }
 
@@ -169,21 +238,18 @@ Class::ClassFunctions Interpreter::split_class_functions(
       // Every AST node method becomes a runtime function that captures the
       // environment This allows methods to keep being associated with their
       // original objects
-      methods.emplace(
-          function->child<0>().lexeme,
-          std::make_shared<Function>(function.get(), environment, kind));
+      methods.emplace(function->child<0>().lexeme,
+                      make_function(function, kind));
       break;
     }
     case FunctionKind::UNBOUND: {
-      unbounds.emplace(
-          function->child<0>().lexeme,
-          std::make_shared<Function>(function.get(), environment, kind));
+      unbounds.emplace(function->child<0>().lexeme,
+                       make_function(function, kind));
       break;
     }
     case FunctionKind::GETTER: {
-      getters.emplace(
-          function->child<0>().lexeme,
-          std::make_shared<Function>(function.get(), environment, kind));
+      getters.emplace(function->child<0>().lexeme,
+                      make_function(function, kind));
       break;
     }
     default: {
@@ -211,9 +277,26 @@ void Interpreter::visit(ClassStmt &node) {
         "super", superclass); // Unlike 'this', super is defined once per class
   }
 
+  std::vector<std::string> fields;
+  fields.reserve(node.child<3>().size());
+  for (const auto &field : node.child<3>()) {
+    fields.push_back(field.lexeme);
+  }
+  auto functions = split_class_functions(node.child<1>());
+  if (superclass != nullptr) {
+    // Methods of a record read its fields by index, past getters
+    for (const auto &[name, getter] : std::get<2>(functions)) {
+      if (superclass->field_index(name)) {
+        throw RuntimeError(node.child<0>(),
+                           "Getter " + name + " would hide a field of " +
+                               superclass->name());
+      }
+    }
+  }
+
   klass.value =
       std::make_shared<Class>(node.child<0>().lexeme, std::move(superclass),
-                              split_class_functions(node.child<1>()));
+                              std::move(functions), std::move(fields));
 
   if (superclass_expr != nullptr)
     environment = environment->enclosing; // Pop the 'super' environment
@@ -273,10 +356,48 @@ void Interpreter::visit(IfStmt &node) {
 
 void Interpreter::visit(WhileStmt &node) {
   while (is_truthy(get_evaluated(node.child<0>()))) {
+    Instrumentation::count_iteration(node, current_unit);
     execute(node.child<1>());
   }
 }
 
+void Interpreter::visit(ForInStmt &node) {
+  const auto iterator =
+      iterate(node.child<0>(), get_evaluated(node.child<2>()));
+
+  while (auto value = iterator->next(*this)) {
+    Instrumentation::count_iteration(node, current_unit);
+    // A new binding per iteration, so closures capture the current value
+    auto iteration = std::make_shared<Environment>(environment);
+    iteration->define(node.child<1>().lexeme, std::move(*value));
+
+    auto original_env = std::exchange(environment, std::move(iteration));
+    try {
+      execute(node.child<3>());
+    } catch (...) {
+      environment = std::move(original_env);
+      throw;
+    }
+    environment = std::move(original_env);
+  }
+}
+
+std::shared_ptr<Iterator> Interpreter::iterate(const Token &keyword,
+                                               const Token::Value &iterable) {
+  if (const auto *object = std::get_if<ObjectPtr>(&iterable)) {
+    if (auto iterator = (*object)->iterate()) {
+      return iterator;
+    }
+  }
+  throw RuntimeError(keyword, "Can only iterate over generators and native "
+                              "collections.");
+}
+
+void Interpreter::visit(YieldStmt &node) {
+  // Functions with a 'yield' run as generators, which don't visit it
+  throw RuntimeError(node.child<0>(), "Can't yield outside of a generator.");
+}
+
 void Interpreter::visit(EmptyStmt &) { last_value = NullType(); }
 
 void Interpreter::visit(BlockStmt &node) {
@@ -291,6 +412,59 @@ void Interpreter::visit(VarStmt &node) {
   environment->define(std::move(variable));
 }
 
+void Interpreter::visit(ImportStmt &node) {
+  auto name = node.child<2>();
+  name.value = ObjectPtr{import_module(node.child<0>(), node.child<1>())};
+  environment->define(std::move(name));
+}
+
+ModulePtr Interpreter::import_module(const Token &keyword,
+                                     const std::string &path) {
+  const auto resolved = resolve_import(current_unit, path, interpreter_path);
+  const auto key = resolved.string();
+
+  if (const auto found = modules.find(key); found != modules.end()) {
+    if (found->second == nullptr) {
+      throw RuntimeError(keyword, "Circular import of '" + path + "'.");
+    }
+    return found->second;
+  }
+
+  const auto entry = ModuleCache::instance().load(resolved);
+  if (entry == nullptr) {
+    throw RuntimeError(keyword, "Cannot read module '" + key + "'.");
+  }
+  entry->diagnostics->replay(*err_handler, "In module '" + key + "': ");
+  if (entry->unit == nullptr) {
+    throw RuntimeError(keyword, "Module '" + key + "' has errors.");
+  }
+  auto &unit = *entry->unit;
+  ModuleCache::instance().prefetch(unit);
+
+  // Run the module's top-level code in its own global scope
+  modules.emplace(key, nullptr);
+  auto module_globals = std::make_shared<Environment>(builtins);
+  {
+    const CurrentUnit current{*this, &unit, module_globals.get()};
+    auto original_env = std::exchange(environment, module_globals);
+    try {
+      for (const auto &statement : unit.statements) {
+        execute(statement);
+      }
+    } catch (...) {
+      environment = std::move(original_env);
+      modules.erase(key);
+      throw;
+    }
+    environment = std::move(original_env);
+  }
+
+  auto module = std::make_shared<Module>(resolved.stem().string(), entry->unit,
+                                         std::move(module_globals));
+  modules.insert_or_assign(key, module);
+  return module;
+}
+
 void Interpreter::visit(ExprStmt &node) { get_evaluated(node.child<0>()); }
 
 void Interpreter::visit(PrintStmt &node) {
@@ -316,70 +490,233 @@ void Interpreter::visit(MalformedStmt &node) {
 void Interpreter::visit(Lambda &node) {
   LOG_DEBUG("Declaring lambda");
 
-  last_value =
-      std::make_shared<Function>(&node, environment, FunctionKind::LAMDBDA);
+  last_value = make_function(&node, FunctionKind::LAMDBDA);
 }
 
-void Interpreter::visit(Call &node) {
-  auto callee = get_evaluated(node.child<0>());
-
-  if (!std::holds_alternative<CallablePtr>(callee))
-    throw RuntimeError(node.child<1>(), "Can only call functions and classes.");
+Token::Value Interpreter::call(Callable &callee,
+                               const std::vector<Token::Value> &arguments,
+                               const Operator &location) {
+  const Instrumentation::Scope counted{location.line, current_unit};
+  const CheckedRecursiveDepth recursion_check{*this, location};
+  const Profiler::Scope profiled{callee, location.line};
 
-  const auto &callable = std::get<CallablePtr>(callee);
+  LOG_DEBUG("Calling callable: ", callee.to_string());
+  return callee.call(*this, arguments);
+}
 
-  // Check arity (number of arguments)
-  if (node.child<2>().size() != callable->arity()) {
+std::vector<Token::Value> Interpreter::arguments_of(Call &node,
+                                                    size_t arity) {
+  if (node.child<2>().size() != arity) {
     throw RuntimeError(node.child<1>(),
-                       "Expected " + std::to_string(callable->arity()) +
+                       "Expected " + std::to_string(arity) +
                            " arguments but got " +
                            std::to_string(node.child<2>().size()) + ".");
   }
 
-  // Evaluate arguments
   std::vector<Token::Value> arguments;
   for (const auto &argument : node.child<2>()) {
     arguments.push_back(get_evaluated(argument));
   }
+  return arguments;
+}
 
-  Interpreter::CheckedRecursiveDepth recursionCheck{*this, node.child<1>()};
+void Interpreter::visit(Call &node) {
+  Token::Value callee;
+  auto *method = dynamic_cast<Get *>(node.child<0>());
+  if (method != nullptr && !method->field_index.has_value()) {
+    // Methods of strings are called on the string itself instead of on a
+    // bound copy. A variable is read in place if the arguments can't assign
+    // it
+    auto *variable = dynamic_cast<Variable *>(method->child<0>());
+    const bool in_place = variable != nullptr &&
+                          std::ranges::all_of(node.child<2>(),
+                                              has_no_side_effects);
+    Token::Value evaluated;
+    if (!in_place) {
+      evaluated = get_evaluated(method->child<0>());
+    }
+    const auto &object = in_place
+                             ? lookup_variable(variable->child<0>(), *variable)
+                             : evaluated;
+    if (const auto *string = std::get_if<std::string>(&object)) {
+      const auto &name = method->child<1>();
+      const auto arguments = arguments_of(node, string_method_arity(name));
+      const Instrumentation::Scope counted{node.child<1>().line, current_unit};
+      last_value = call_string_method(*string, name, arguments);
+      return;
+    }
+    callee = get_property(object, method->child<1>());
+  } else {
+    callee = get_evaluated(node.child<0>());
+  }
 
-  LOG_DEBUG("Calling callable in visit(Call): ", callable->to_string());
-  last_value = callable->call(*this, arguments);
-}
+  if (!std::holds_alternative<CallablePtr>(callee))
+    throw RuntimeError(node.child<1>(), "Can only call functions and classes.");
 
-void Interpreter::visit(Get &node) {
-  auto object = get_evaluated(node.child<0>());
+  const auto &callable = std::get<CallablePtr>(callee);
+  const auto arguments = arguments_of(node, callable->arity());
+  last_value = call(*callable, arguments, node.child<1>());
+}
 
+Token::Value Interpreter::get_property(Token::Value object,
+                                       const Token &name) {
   if (const auto *obj = std::get_if<InstancePtr>(&object)) {
-    last_value = (*obj)->get_field(node.child<1>(), *this);
-  } else if (const auto klass = get_callable_as<Class>(object)) {
-    last_value = klass->get_unbound(node.child<1>().lexeme);
-    if (get_callable_as<Function>(last_value) == nullptr) {
-      throw RuntimeError(node.child<1>(), "Undefined unbound function.");
+    return (*obj)->get_field(name, *this);
+  }
+  if (const auto *native = std::get_if<ObjectPtr>(&object)) {
+    return (*native)->get(name, *this);
+  }
+  if (auto *string = std::get_if<std::string>(&object)) {
+    return string_method(std::move(*string), name);
+  }
+  if (const auto klass = get_callable_as<Class>(object)) {
+    auto unbound = klass->get_unbound(name.lexeme);
+    if (get_callable_as<Function>(unbound) == nullptr) {
+      throw RuntimeError(name, "Undefined unbound function.");
     }
-  } else {
-    throw RuntimeError(
-        node.child<1>(),
-        "Can only access fields of objects or classes. Called with: " +
-            stringify(object));
+    return unbound;
   }
+  throw RuntimeError(
+      name, "Can only access fields of objects or classes. Called with: " +
+                stringify(object));
+}
+
+void Interpreter::visit(Get &node) {
+  if (node.field_index.has_value()) { // Field of a record, read in place
+    auto *self = dynamic_cast<This *>(node.child<0>());
+    const auto &object = lookup_variable(self->child<0>(), *self);
+    last_value = std::get<InstancePtr>(object)->field_at(*node.field_index);
+    return;
+  }
+
+  last_value = get_property(get_evaluated(node.child<0>()), node.child<1>());
 }
 
 void Interpreter::visit(Set &node) {
+  if (node.field_index.has_value()) { // Field of a record
+    auto value = get_evaluated(node.child<2>());
+    auto *self = dynamic_cast<This *>(node.child<0>());
+    const auto &object = lookup_variable(self->child<0>(), *self);
+    last_value = value;
+    std::get<InstancePtr>(object)->field_at(*node.field_index) =
+        std::move(value);
+    return;
+  }
+
   auto object = get_evaluated(node.child<0>());
 
-  if (!std::holds_alternative<InstancePtr>(object)) {
+  const auto *native = std::get_if<ObjectPtr>(&object);
+  if (!std::holds_alternative<InstancePtr>(object) && native == nullptr) {
     throw RuntimeError(node.child<1>(), "Can only set properties on objects");
   }
 
   auto value = get_evaluated(node.child<2>());
 
-  std::get<InstancePtr>(object)->set_field(node.child<1>(), value);
+  if (native != nullptr) {
+    (*native)->set(node.child<1>(), value);
+  } else {
+    std::get<InstancePtr>(object)->set_field(node.child<1>(), value);
+  }
 
   last_value = std::move(value);
 }
 
+void Interpreter::visit(ArrayLiteral &node) {
+  std::vector<Token::Value> elements;
+  elements.reserve(node.child<1>().size());
+  for (auto *element : node.child<1>()) {
+    elements.push_back(get_evaluated(element));
+  }
+  last_value = ObjectPtr{std::make_shared<Array>(std::move(elements))};
+}
+
+void Interpreter::visit(Index &node) {
+  // A variable is read in place if the index can't assign it, so indexing a
+  // string doesn't copy it
+  auto *variable = dynamic_cast<Variable *>(node.child<0>());
+  const bool in_place =
+      variable != nullptr && has_no_side_effects(node.child<2>());
+  Token::Value evaluated;
+  if (!in_place) {
+    evaluated = get_evaluated(node.child<0>());
+  }
+  const auto &object = in_place
+                           ? lookup_variable(variable->child<0>(), *variable)
+                           : evaluated;
+  auto index = get_evaluated(node.child<2>());
+  const auto &bracket = node.child<1>();
+
+  if (auto *array = get_object_as<Array>(object)) {
+    last_value = array->at(index, bracket);
+  } else if (auto *map = get_object_as<Map>(object)) {
+    const auto *value = map->find(index);
+    last_value = value != nullptr ? *value : NullType{};
+  } else if (auto *floats = get_object_as<Float64Array>(object)) {
+    last_value = floats->at(index, bracket);
+  } else if (const auto *string = std::get_if<std::string>(&object)) {
+    last_value = index_string(*string, index, bracket);
+  } else {
+    throw RuntimeError(bracket, "Can only index arrays, maps and strings. "
+                                "Called with: " +
+                                    stringify(object));
+  }
+}
+
+void Interpreter::visit(IndexSet &node) {
+  auto object = get_evaluated(node.child<0>());
+  const auto &bracket = node.child<1>();
+  auto index = get_evaluated(node.child<2>());
+  auto value = get_evaluated(node.child<3>());
+
+  if (auto *array = get_object_as<Array>(object)) {
+    array->at(index, bracket) = value;
+  } else if (auto *map = get_object_as<Map>(object)) {
+    map->insert(index, bracket.line) = value;
+  } else if (auto *floats = get_object_as<Float64Array>(object)) {
+    const auto *number = std::get_if<double>(&value);
+    if (number == nullptr) {
+      throw RuntimeError(bracket, "Float64Array elements must be numbers, "
+                                  "got " +
+                                      stringify(value));
+    }
+    floats->at(index, bracket) = *number;
+  } else {
+    throw RuntimeError(bracket, "Can only assign to elements of arrays, maps "
+                                "and Float64Arrays");
+  }
+  last_value = std::move(value);
+}
+
+void Interpreter::visit(Slice &node) {
+  // Variables are read in place like for Index
+  auto *variable = dynamic_cast<Variable *>(node.child<0>());
+  const bool in_place = variable != nullptr &&
+                        has_no_side_effects(node.child<2>()) &&
+                        has_no_side_effects(node.child<3>());
+  Token::Value evaluated;
+  if (!in_place) {
+    evaluated = get_evaluated(node.child<0>());
+  }
+  const auto &object = in_place
+                           ? lookup_variable(variable->child<0>(), *variable)
+                           : evaluated;
+  auto start = get_evaluated(node.child<2>());
+  auto end = get_evaluated(node.child<3>());
+  const auto &bracket = node.child<1>();
+
+  if (auto *array = get_object_as<Array>(object)) {
+    last_value = ObjectPtr{array->slice(start, end, bracket)};
+  } else if (auto *floats = get_object_as<Float64Array>(object)) {
+    last_value = ObjectPtr{floats->slice(start, end, bracket)};
+  } else if (const auto *string = std::get_if<std::string>(&object)) {
+    last_value = slice_string(*string, start, end, bracket);
+  } else {
+    throw RuntimeError(bracket, "Can only slice arrays and strings. Called "
+                                "with: " +
+                                    stringify(object));
+  }
+}
+
 void Interpreter::visit(This &node) {
   last_value = lookup_variable(node.child<0>(), node);
 }
@@ -391,7 +728,7 @@ void Interpreter::visit(Assign &node) {
   if (node.depth.has_value()) {
     environment->assign_at(*node.depth, identifier.lexeme, value);
   } else {
-    globals->assign(identifier, value);
+    current_globals->assign(identifier, value);
   }
 
   last_value = std::move(value);
@@ -399,7 +736,7 @@ void Interpreter::visit(Assign &node) {
 
 void Interpreter::visit(Logical &node) {
   Token::Value lhs = get_evaluated(node.child<0>());
-  const Token &op = node.child<1>();
+  const Operator &op = node.child<1>();
   if (op.type == Type::OR) {
     if (is_truthy(lhs))
       last_value = lhs;
@@ -425,7 +762,7 @@ const Token::Value &Interpreter::lookup_variable(const Token &name,
     return environment->get_at(*node.depth, name.lexeme);
   }
 
-  return globals->get(name);
+  return current_globals->get(name);
 }
 
 void Interpreter::visit(Empty &) {
@@ -442,7 +779,7 @@ void Interpreter::visit(Grouping &node) {
 void Interpreter::visit(Unary &node) {
   Token::Value value = get_evaluated(node.child<1>());
 
-  const Token &op = node.child<0>();
+  const Operator &op = node.child<0>();
 
   switch (op.type) {
   case Type::MINUS:
@@ -461,7 +798,7 @@ void Interpreter::visit(Binary &node) {
   // This implementation defines left-to-right evaluation of binary
   // expressions
   Token::Value left = get_evaluated(node.child<0>());
-  const Token &op = node.child<1>();
+  const Operator &op = node.child<1>();
   Token::Value right = get_evaluated(node.child<2>());
 
   switch (op.type) {
@@ -554,7 +891,7 @@ void Interpreter::visit(Malformed &node) {
 
 void Interpreter::visit(Ternary &node) {
   Token::Value condition = get_evaluated(node.child<0>());
-  const Token &first_op = node.child<1>();
+  const Operator &first_op = node.child<1>();
   const expr &first = node.child<2>();
   const expr &second = node.child<4>();
 
@@ -0,0 +1,89 @@
+#include "isolate.hpp"
+
+#include "module.hpp"
+#include "snapshot.hpp"
+#include "source_file.hpp"
+
+Isolate::Isolate(Options _options)
+    : options(std::move(_options)),
+      m_interpreter(*options.out, options.err_handler) {}
+
+bool Isolate::run(std::string_view source, const std::filesystem::path &path) {
+  if (m_exited) {
+    return false;
+  }
+  // Logs of this isolate follow its own configuration on whatever thread runs
+  // it
+  const Logging::ScopedConfig logging{options.logging};
+  options.err_handler->reset_error();
+
+  auto unit = compile(source, options.err_handler, options.mode);
+  if (unit == nullptr) {
+    return false;
+  }
+  if (!path.empty()) {
+    unit->path = path;
+    m_interpreter.interpreter_path =
+        std::filesystem::path(path).remove_filename().string();
+  }
+  return run_unit(*unit);
+}
+
+bool Isolate::run_cached(const std::filesystem::path &path) {
+  if (m_exited) {
+    return false;
+  }
+  const Logging::ScopedConfig logging{options.logging};
+  options.err_handler->reset_error();
+
+  std::error_code error;
+  const auto canonical = std::filesystem::canonical(path, error);
+  const auto entry =
+      error ? nullptr : ModuleCache::instance().load(canonical);
+  if (entry == nullptr) {
+    LOG_ERROR("File ", path, " could not be opened");
+    return false;
+  }
+  entry->diagnostics->replay(*options.err_handler, "");
+  if (entry->unit == nullptr) {
+    return false;
+  }
+  m_interpreter.interpreter_path =
+      std::filesystem::path(canonical).remove_filename().string();
+  return run_unit(*entry->unit);
+}
+
+bool Isolate::run_unit(CompilationUnit &unit) {
+  try {
+    m_interpreter.interpret(unit);
+    if (!options.err_handler->has_runtime_error()) {
+      m_interpreter.run_event_loop();
+    }
+  } catch (const Exit &e) {
+    LOG_INFO("Interpretation terminated: ", e.what());
+    m_exited = true;
+  }
+  return !options.err_handler->has_error() &&
+         !options.err_handler->has_runtime_error();
+}
+
+bool Isolate::run_file(const std::filesystem::path &path) {
+  const SourceFile source{path};
+  if (!source) {
+    const Logging::ScopedConfig logging{options.logging};
+    LOG_ERROR("File ", path, " could not be opened");
+    return false;
+  }
+  return run(source.contents(), path);
+}
+
+bool Isolate::load_prelude(const std::filesystem::path &image) {
+  const Logging::ScopedConfig logging{options.logging};
+  return load_snapshot(m_interpreter, image);
+}
+
+bool Isolate::exited() const { return m_exited; }
+
+Interpreter &Isolate::interpreter() { return m_interpreter; }
+
+ErrorHandler &Isolate::errors() { return *options.err_handler; }
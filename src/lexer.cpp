@@ -1,18 +1,106 @@
 #include "lexer.hpp"
 
+#include <array>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+#include "scan.hpp"
+
+namespace {
+using Type = Lexer::Type;
+
+struct Keyword {
+  std::string_view text;
+  Type type;
+};
+
 // clang-format off
-const std::unordered_map<std::string, Lexer::Type> Lexer::keywords{
-    {"and", Type::AND}, {"class", Type::CLASS}, {"else", Type::ELSE}, 
-    {"false", Type::FALSE}, {"for", Type::FOR}, {"fun", Type::FUN}, 
-    {"fn", Type::FUN}, {"if", Type::IF}, {"nil", Type::NIL}, 
-    {"or", Type::OR}, {"print", Type::PRINT}, {"return", Type::RETURN}, 
-    {"super", Type::SUPER}, {"this", Type::THIS}, {"true", Type::TRUE}, 
-    {"var", Type::VAR}, {"while", Type::WHILE}, {"let", Type::VAR},
-    {"return", Type::RETURN}, {"unbound", Type::UNBOUND}};
+constexpr std::array keywords{
+    Keyword{"and", Type::AND}, Keyword{"class", Type::CLASS}, Keyword{"else", Type::ELSE},
+    Keyword{"false", Type::FALSE}, Keyword{"for", Type::FOR}, Keyword{"fun", Type::FUN},
+    Keyword{"fn", Type::FUN}, Keyword{"if", Type::IF}, Keyword{"nil", Type::NIL},
+    Keyword{"or", Type::OR}, Keyword{"print", Type::PRINT}, Keyword{"return", Type::RETURN},
+    Keyword{"super", Type::SUPER}, Keyword{"this", Type::THIS}, Keyword{"true", Type::TRUE},
+    Keyword{"var", Type::VAR}, Keyword{"while", Type::WHILE}, Keyword{"let", Type::VAR},
+    Keyword{"unbound", Type::UNBOUND}, Keyword{"import", Type::IMPORT},
+    Keyword{"yield", Type::YIELD}};
 // clang-format on
 
-Lexer::Lexer(std::string _source, std::shared_ptr<ErrorHandler> _err_handler)
-    : source(std::move(_source)), err_handler(std::move(_err_handler)) {
+/// Perfect hash over the keywords: the first and last character and the
+/// length, mixed with a seed that is searched for at compile time
+constexpr size_t KEYWORD_SLOTS = 128;
+
+constexpr size_t keyword_hash(std::string_view text, size_t seed) {
+  const auto first = static_cast<unsigned char>(text.front());
+  const auto last = static_cast<unsigned char>(text.back());
+  return (first * seed + last * 3 + text.size()) % KEYWORD_SLOTS;
+}
+
+constexpr bool is_perfect(size_t seed) {
+  std::array<bool, KEYWORD_SLOTS> used{};
+  for (const auto &keyword : keywords) {
+    const auto slot = keyword_hash(keyword.text, seed);
+    if (used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr size_t find_seed() {
+  for (size_t seed = 1; seed < 1000; ++seed) {
+    if (is_perfect(seed)) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+constexpr size_t KEYWORD_SEED = find_seed();
+static_assert(KEYWORD_SEED != 0, "No perfect hash seed for the keyword set");
+
+/// Slot index -> index into keywords, or keywords.size() for an empty slot
+constexpr auto keyword_slots = [] {
+  std::array<size_t, KEYWORD_SLOTS> slots{};
+  slots.fill(keywords.size());
+  for (size_t i = 0; i < keywords.size(); ++i) {
+    slots[keyword_hash(keywords[i].text, KEYWORD_SEED)] = i;
+  }
+  return slots;
+}();
+
+constexpr std::optional<Type> keyword_type(std::string_view identifier) {
+  if (identifier.empty()) {
+    return std::nullopt;
+  }
+  const auto index = keyword_slots[keyword_hash(identifier, KEYWORD_SEED)];
+  if (index < keywords.size() && keywords[index].text == identifier) {
+    return keywords[index].type;
+  }
+  return std::nullopt;
+}
+
+constexpr bool all_keywords_found() {
+  for (const auto &keyword : keywords) {
+    if (keyword_type(keyword.text) != keyword.type) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(all_keywords_found(), "Keyword table is inconsistent");
+static_assert(!keyword_type("classy").has_value() &&
+                  !keyword_type("f").has_value() &&
+                  !keyword_type("lets").has_value(),
+              "Non-keywords must not be classified as keywords");
+} // namespace
+
+Lexer::Lexer(std::string_view _source,
+             std::shared_ptr<ErrorHandler> _err_handler)
+    : source(_source), err_handler(std::move(_err_handler)) {
   tokens.reserve(source.size() / 3);
 }
 
@@ -36,6 +124,12 @@ void Lexer::scan_token() {
   case '}':
     add_token(Type::RIGHT_BRACE);
     break;
+  case '[':
+    add_token(Type::LEFT_BRACKET);
+    break;
+  case ']':
+    add_token(Type::RIGHT_BRACKET);
+    break;
   case '|':
     add_token(Type::PIPE);
     break;
@@ -81,9 +175,9 @@ void Lexer::scan_token() {
   case '\t':
   case ' ':
   case '\r':
-    break;
   case '\n':
-    ++line;
+    // Re-scan the whole whitespace run including c, counting its newlines
+    current = position(Scan::skip_whitespace(source.data() + start, end(), line));
     break;
   case '"':
     string();
@@ -105,19 +199,12 @@ void Lexer::scan_token() {
 void Lexer::slash_or_comment() {
   if (expect('/')) {
     // Comment till end of line
-    while (peek() != '\n' && !is_at_end()) {
-      advance();
-    }
+    current = position(Scan::find_newline(source.data() + current, end()));
   } else if (expect('*')) {
     unsigned int start_line = line;
     // Comment till matching */
     while (!is_at_end()) {
-      while (peek() != '*' && !is_at_end()) {
-        if (peek() == '\n') {
-          ++line;
-        }
-        advance();
-      }
+      current = position(Scan::find(source.data() + current, end(), '*', line));
       if (is_at_end()) {
         err_handler->error(line, "Unterminated comment starting at line " +
                                      std::to_string(start_line));
@@ -136,18 +223,17 @@ void Lexer::slash_or_comment() {
 }
 
 void Lexer::number() {
-  while (isdigit(peek()) != 0) {
-    advance();
-  }
+  current = position(Scan::skip_digits(source.data() + current, end()));
 
   if (peek() == '.' && isdigit(peek_next()) != 0) {
     advance(); // Consume the .
 
-    while (isdigit(peek()) != 0) {
-      advance();
-    }
+    current = position(Scan::skip_digits(source.data() + current, end()));
   }
-  add_token(Type::NUMBER, std::stod(source.substr(start, current - start)));
+
+  double value = 0;
+  std::from_chars(source.data() + start, source.data() + current, value);
+  add_token(Type::NUMBER, value);
 }
 
 char Lexer::peek_next() const {
@@ -159,12 +245,7 @@ char Lexer::peek_next() const {
 
 void Lexer::string() {
   unsigned int start_line = line;
-  while (peek() != '"' && !is_at_end()) {
-    if (peek() == '\n') {
-      ++line;
-    }
-    advance();
-  }
+  current = position(Scan::find(source.data() + current, end(), '"', line));
 
   if (is_at_end()) {
     err_handler->error(line, "Unterminated string starting at line " +
@@ -174,8 +255,14 @@ void Lexer::string() {
 
   advance(); // Consume the closing "
 
-  std::string str = source.substr(start + 1, current - start - 2);
-  add_token(Type::STRING, str);
+  std::string str{source.substr(start + 1, current - start - 2)};
+  add_token(Type::STRING, std::move(str));
+}
+
+const char *Lexer::end() const { return source.data() + source.size(); }
+
+unsigned int Lexer::position(const char *scanned) const {
+  return static_cast<unsigned int>(scanned - source.data());
 }
 
 char Lexer::peek() {
@@ -190,7 +277,7 @@ void Lexer::add_token(Type type, Token::Value value) {
     last_character_expected = true;
     report_last_syntax_error();
   }
-  std::string text = source.substr(start, current - start);
+  std::string text{source.substr(start, current - start)};
   tokens.emplace_back(type, std::move(text), std::move(value), line);
 }
 
@@ -213,21 +300,14 @@ std::vector<Token> Lexer::lex() {
   }
 
   tokens.emplace_back(Type::EOF_, "", NullType(), line);
-  return tokens;
+  return std::move(tokens);
 }
 
 void Lexer::identifier() {
-  while (isalnum(peek()) != 0) {
-    advance();
-  }
+  current = position(Scan::skip_identifier(source.data() + current, end()));
 
-  std::string str = source.substr(start, current - start);
-  const auto keyword_it = keywords.find(str);
-  if (keyword_it != keywords.cend()) {
-    add_token(keyword_it->second);
-  } else {
-    add_token(Type::IDENTIFIER);
-  }
+  const std::string_view text{source.data() + start, current - start};
+  add_token(keyword_type(text).value_or(Type::IDENTIFIER));
 }
 
 // Syntax Error Handling:
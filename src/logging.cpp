@@ -20,13 +20,26 @@ std::ostream &operator<<(std::ostream &os, LogLevel level) {
 
 void newline(LogLevel level) {
   if (static_cast<int>(level) >= static_cast<int>(get_log_level()))
-    std::cout << std::endl;
+    *config().stream << std::endl;
 }
 
-static LogLevel log_level = LogLevel::WARNING;
+Config &config() {
+  thread_local Config thread_config;
+  return thread_config;
+}
+
+ScopedConfig::ScopedConfig(Config &_config)
+    : config(_config), previous(Logging::config()) {
+  Logging::config() = config;
+}
+
+ScopedConfig::~ScopedConfig() {
+  config = Logging::config();
+  Logging::config() = previous;
+}
 
-void set_log_level(LogLevel level) { log_level = level; }
+void set_log_level(LogLevel level) { config().level = level; }
 
-LogLevel get_log_level() { return log_level; }
+LogLevel get_log_level() { return config().level; }
 
 } // namespace Logging
@@ -0,0 +1,318 @@
+#include "map.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+#include "array.hpp"
+#include "error.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOX_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr size_t GROUP_SIZE = 16;
+constexpr int8_t EMPTY = -128;
+constexpr int8_t DELETED = -2;
+
+/// Slots that may be full before the table grows, leaving every probe
+/// sequence an empty slot to stop at
+constexpr size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+/// Final mix of MurmurHash3, so keys differing in few bits, like pointers and
+/// small integers, spread over all groups and control bytes
+uint64_t mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+uint64_t hash_key(const Token::Value &key) {
+  const uint64_t hash = std::visit(
+      [](const auto &content) -> uint64_t {
+        using T = std::decay_t<decltype(content)>;
+        if constexpr (std::is_same_v<T, double>) {
+          // -0 and 0 are equal keys
+          return std::bit_cast<uint64_t>(content == 0 ? 0.0 : content);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+          return std::hash<std::string>{}(content);
+        } else if constexpr (std::is_same_v<T, bool>) {
+          return content ? 1 : 0;
+        } else if constexpr (std::is_same_v<T, NullType>) {
+          return 0;
+        } else {
+          return reinterpret_cast<uintptr_t>(content.get());
+        }
+      },
+      key);
+  return mix(hash ^ (key.index() * 0x9e3779b97f4a7c15ULL));
+}
+
+int8_t control_byte(uint64_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+/// Group of control bytes, matched all at once. Matches are bitmasks with bit
+/// i set if the control byte i matched
+struct Group {
+#ifdef LOX_MAP_SSE2
+  explicit Group(const int8_t *controls)
+      : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(controls))) {}
+
+  [[nodiscard]] uint32_t match(int8_t control) const {
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(control), bytes)));
+  }
+
+  /// Empty and deleted control bytes have their sign bit set
+  [[nodiscard]] uint32_t match_free() const {
+    return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+  }
+
+private:
+  __m128i bytes;
+#else
+  explicit Group(const int8_t *_controls) : controls(_controls) {}
+
+  [[nodiscard]] uint32_t match(int8_t control) const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      mask |= static_cast<uint32_t>(controls[i] == control) << i;
+    }
+    return mask;
+  }
+
+  [[nodiscard]] uint32_t match_free() const {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+      mask |= static_cast<uint32_t>(controls[i] < 0) << i;
+    }
+    return mask;
+  }
+
+private:
+  const int8_t *controls;
+#endif
+
+public:
+  [[nodiscard]] uint32_t match_empty() const { return match(EMPTY); }
+};
+
+/// Visits the groups of a table with group_count groups, a power of two.
+/// Triangular steps visit every group once
+struct ProbeSequence {
+  ProbeSequence(uint64_t hash, size_t group_count)
+      : mask(group_count - 1), group((hash >> 7) & mask) {}
+
+  [[nodiscard]] size_t offset() const { return group * GROUP_SIZE; }
+
+  void next() {
+    ++step;
+    group = (group + step) & mask;
+  }
+
+private:
+  size_t mask;
+  size_t group;
+  size_t step = 0;
+};
+
+/// Iterates the keys of a map live, as long as no keys are added
+struct MapIterator : public Iterator {
+  explicit MapIterator(MapPtr _map)
+      : map(std::move(_map)), additions(map->additions()) {}
+
+  std::optional<Token::Value> next(Interpreter &) override {
+    if (map->additions() != additions) {
+      throw RuntimeError("Map keys were added while iterating over it");
+    }
+    for (; slot < map->capacity(); ++slot) {
+      if (const auto *key = map->key_at(slot)) {
+        ++slot;
+        return *key;
+      }
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] std::string to_string() const override {
+    return "<Map iterator>";
+  }
+
+private:
+  MapPtr map;
+  size_t additions;
+  size_t slot = 0;
+};
+
+/// Maps being converted to strings by this thread, to print cycles as '{...}'
+thread_local std::vector<const Map *> printing;
+} // namespace
+
+Token::Value *Map::find(const Token::Value &key) {
+  const auto slot = find_slot(key, hash_key(key));
+  return slot >= 0 ? &slots[static_cast<size_t>(slot)].value : nullptr;
+}
+
+Token::Value &Map::insert(const Token::Value &key, unsigned int line) {
+  if (const auto *number = std::get_if<double>(&key);
+      number != nullptr && std::isnan(*number)) {
+    throw RuntimeError(key, "can't be a map key", line);
+  }
+  const auto hash = hash_key(key);
+  if (const auto found = find_slot(key, hash); found >= 0) {
+    return slots[static_cast<size_t>(found)].value;
+  }
+
+  if (controls.empty()) {
+    rehash(GROUP_SIZE);
+  }
+  auto slot = find_free(hash);
+  if (growth_left == 0 && controls[slot] == EMPTY) {
+    // Rehashing in place suffices if deleted slots took up most of the room
+    rehash(count + 1 > max_load(capacity()) / 2 ? capacity() * 2 : capacity());
+    slot = find_free(hash);
+  }
+
+  if (controls[slot] == EMPTY) {
+    --growth_left;
+  }
+  controls[slot] = control_byte(hash);
+  slots[slot] = Slot{key, NullType{}, hash};
+  ++count;
+  ++added;
+  return slots[slot].value;
+}
+
+bool Map::remove(const Token::Value &key) {
+  const auto found = find_slot(key, hash_key(key));
+  if (found < 0) {
+    return false;
+  }
+  const auto slot = static_cast<size_t>(found);
+  // A group with an empty slot never had probes pass it, so its slots can be
+  // emptied. Otherwise lookups must continue past the deleted slot
+  const Group group{controls.data() + slot / GROUP_SIZE * GROUP_SIZE};
+  if (group.match_empty() != 0) {
+    controls[slot] = EMPTY;
+    ++growth_left;
+  } else {
+    controls[slot] = DELETED;
+  }
+  slots[slot] = Slot{};
+  --count;
+  return true;
+}
+
+const Token::Value *Map::key_at(size_t slot) const {
+  return controls[slot] >= 0 ? &slots[slot].key : nullptr;
+}
+
+std::ptrdiff_t Map::find_slot(const Token::Value &key, uint64_t hash) const {
+  if (controls.empty()) {
+    return -1;
+  }
+  const auto control = control_byte(hash);
+  for (ProbeSequence probe{hash, controls.size() / GROUP_SIZE};; probe.next()) {
+    const Group group{controls.data() + probe.offset()};
+    for (auto matches = group.match(control); matches != 0;
+         matches &= matches - 1) {
+      const auto slot = probe.offset() + std::countr_zero(matches);
+      if (slots[slot].hash == hash && slots[slot].key == key) {
+        return static_cast<std::ptrdiff_t>(slot);
+      }
+    }
+    if (group.match_empty() != 0) {
+      return -1;
+    }
+  }
+}
+
+size_t Map::find_free(uint64_t hash) const {
+  for (ProbeSequence probe{hash, controls.size() / GROUP_SIZE};; probe.next()) {
+    if (const auto free = Group{controls.data() + probe.offset()}.match_free();
+        free != 0) {
+      return probe.offset() + std::countr_zero(free);
+    }
+  }
+}
+
+void Map::rehash(size_t new_capacity) {
+  auto old_controls =
+      std::exchange(controls, std::vector<int8_t>(new_capacity, EMPTY));
+  auto old_slots = std::exchange(slots, std::vector<Slot>(new_capacity));
+  growth_left = max_load(new_capacity) - count;
+
+  for (size_t i = 0; i < old_controls.size(); ++i) {
+    if (old_controls[i] >= 0) {
+      const auto slot = find_free(old_slots[i].hash);
+      controls[slot] = old_controls[i];
+      slots[slot] = std::move(old_slots[i]);
+    }
+  }
+}
+
+std::string Map::to_string() const {
+  if (std::find(printing.begin(), printing.end(), this) != printing.end()) {
+    return "{...}";
+  }
+  printing.push_back(this);
+
+  std::string string = "{";
+  for_each([&string](const Token::Value &key, const Token::Value &value) {
+    if (string.size() > 1) {
+      string += ", ";
+    }
+    string += stringify(key) + ": " + stringify(value);
+  });
+  printing.pop_back();
+  return string + "}";
+}
+
+Token::Value Map::get(const Token &name, Interpreter &interpreter) {
+  auto self = shared_from_this();
+  if (name.lexeme == "has") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "has", 1, [self](Interpreter &, const auto &arguments) {
+          return Token::Value{self->find(arguments[0]) != nullptr};
+        })};
+  }
+  if (name.lexeme == "get") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "get", 2, [self](Interpreter &, const auto &arguments) {
+          const auto *value = self->find(arguments[0]);
+          return value != nullptr ? *value : arguments[1];
+        })};
+  }
+  if (name.lexeme == "remove") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "remove", 1, [self](Interpreter &, const auto &arguments) {
+          return Token::Value{self->remove(arguments[0])};
+        })};
+  }
+  if (name.lexeme == "keys" || name.lexeme == "values") {
+    const bool keys = name.lexeme == "keys";
+    return CallablePtr{std::make_shared<NativeMethod>(
+        name.lexeme, 0, [self, keys](Interpreter &, const auto &) {
+          std::vector<Token::Value> elements;
+          elements.reserve(self->size());
+          self->for_each([&elements, keys](const Token::Value &key,
+                                           const Token::Value &value) {
+            elements.push_back(keys ? key : value);
+          });
+          return Token::Value{
+              ObjectPtr{std::make_shared<Array>(std::move(elements))}};
+        })};
+  }
+  return Object::get(name, interpreter);
+}
+
+std::shared_ptr<Iterator> Map::iterate() {
+  return std::make_shared<MapIterator>(shared_from_this());
+}
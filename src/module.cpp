@@ -0,0 +1,184 @@
+#include "module.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "logging.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+Module::Module(std::string _name, CompilationUnitPtr _unit,
+               std::shared_ptr<Environment> _globals)
+    : name(std::move(_name)), unit(std::move(_unit)),
+      globals(std::move(_globals)) {}
+
+std::string Module::to_string() const { return "<Module '" + name + "'>"; }
+
+Token::Value Module::get(const Token &identifier, Interpreter &) {
+  // Looked up on every access, so globals the module defines after its
+  // top-level code ran are exported too
+  const auto &variables = globals->variables;
+  const auto found = variables.find(identifier.lexeme);
+  if (found == variables.end()) {
+    throw RuntimeError(identifier, "Module '" + name + "' has no export '" +
+                                       identifier.lexeme + "'.");
+  }
+  return found->second;
+}
+
+namespace {
+/// Run function(i) for i in [0, count) on up to one thread per core
+template <typename Function>
+void parallel_for(size_t count, const Function &function) {
+  const size_t workers = std::min<size_t>(
+      count, std::max(1U, std::thread::hardware_concurrency()));
+
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i = next++; i < count; i = next++) {
+      function(i);
+    }
+  };
+
+  // The threads log like this one
+  std::vector<std::jthread> threads;
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back([&work, logging = Logging::config()]() mutable {
+      const Logging::ScopedConfig scoped_logging{logging};
+      work();
+    });
+  }
+  work(); // This thread helps, and does all the work for a single item
+}
+
+std::vector<fs::path> top_level_imports(const CompilationUnit &unit) {
+  std::vector<fs::path> imports;
+  if (unit.path.empty()) {
+    return imports; // Resolved against interpreter state at runtime
+  }
+  for (const auto &statement : unit.statements) {
+    if (const auto *import = dynamic_cast<const ImportStmt *>(statement)) {
+      imports.push_back(resolve_import(&unit, import->child<1>(), {}));
+    }
+  }
+  return imports;
+}
+} // namespace
+
+ModuleCache &ModuleCache::instance() {
+  static ModuleCache cache;
+  return cache;
+}
+
+void ModuleCache::set_script_cache(std::optional<ScriptCache> cache) {
+  const std::scoped_lock lock{mutex};
+  script_cache = std::move(cache);
+}
+
+ModuleCache::EntryPtr
+ModuleCache::cached(const fs::path &path, fs::file_time_type modified,
+                    std::optional<ScriptCache> &disk_cache) {
+  const std::scoped_lock lock{mutex};
+  const auto found = entries.find(path.string());
+  if (found != entries.end() && found->second->modified == modified) {
+    return found->second;
+  }
+  disk_cache = script_cache;
+  return nullptr;
+}
+
+ModuleCache::EntryPtr ModuleCache::load(const fs::path &path) {
+  std::error_code error;
+  const auto modified = fs::last_write_time(path, error);
+  if (error) {
+    return nullptr;
+  }
+
+  std::optional<ScriptCache> disk_cache;
+  if (auto entry = cached(path, modified, disk_cache)) {
+    return entry;
+  }
+
+  auto entry = compile_module(path, modified, disk_cache);
+  if (entry != nullptr) {
+    const std::scoped_lock lock{mutex};
+    entries.insert_or_assign(path.string(), entry);
+  }
+  return entry;
+}
+
+ModuleCache::EntryPtr
+ModuleCache::compile_module(const fs::path &path, fs::file_time_type modified,
+                            const std::optional<ScriptCache> &disk_cache) {
+  const SourceFile source{path};
+  if (!source) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  entry->diagnostics = std::make_shared<BufferedErrorHandler>();
+  entry->modified = modified;
+
+  entry->unit = disk_cache ? disk_cache->load(source.contents()) : nullptr;
+  if (entry->unit == nullptr) {
+    entry->unit = compile(source.contents(), entry->diagnostics);
+    if (entry->unit != nullptr && disk_cache) {
+      disk_cache->store(source.contents(), *entry->unit);
+    }
+  }
+  if (entry->unit != nullptr) {
+    entry->unit->path = path;
+  }
+
+  LOG_DEBUG("Compiled module ", path);
+  return entry;
+}
+
+void ModuleCache::prefetch(const CompilationUnit &unit) {
+  std::unordered_set<std::string> seen;
+  auto level = top_level_imports(unit);
+
+  while (!level.empty()) {
+    std::vector<fs::path> paths;
+    for (auto &path : level) {
+      if (seen.insert(path.string()).second) {
+        paths.push_back(std::move(path));
+      }
+    }
+
+    std::vector<EntryPtr> loaded(paths.size());
+    parallel_for(paths.size(), [&](size_t i) { loaded[i] = load(paths[i]); });
+
+    level.clear();
+    for (const auto &entry : loaded) {
+      if (entry != nullptr && entry->unit != nullptr) {
+        auto imports = top_level_imports(*entry->unit);
+        level.insert(level.end(), std::make_move_iterator(imports.begin()),
+                     std::make_move_iterator(imports.end()));
+      }
+    }
+  }
+}
+
+fs::path resolve_import(const CompilationUnit *importer, std::string_view path,
+                        const fs::path &fallback_directory) {
+  fs::path resolved{path};
+  if (resolved.is_relative()) {
+    const auto directory = importer != nullptr && !importer->path.empty()
+                               ? importer->path.parent_path()
+                               : fallback_directory;
+    resolved = directory / resolved;
+  }
+  if (!resolved.has_extension()) {
+    resolved += ".lox";
+  }
+
+  std::error_code error;
+  auto canonical = fs::weakly_canonical(resolved, error);
+  return error ? resolved.lexically_normal() : canonical;
+}
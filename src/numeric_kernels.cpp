@@ -0,0 +1,396 @@
+#include "numeric_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define LOX_NUMERIC_AVX2
+#include <immintrin.h>
+#define LOX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+/// Partial sums of reductions: four AVX2 vectors of four doubles
+constexpr size_t LANES = 16;
+
+//------------------------------Scalar reference-------------------------------
+
+/// Add up partial sums in the order of avx2_combine(): lanes j, 4 + j, 8 + j
+/// and 12 + j first, then the resulting four lanes pairwise
+double combine(const std::array<double, LANES> &partial) {
+  std::array<double, 4> lanes{};
+  for (size_t j = 0; j < 4; ++j) {
+    lanes[j] =
+        (partial[j] + partial[4 + j]) + (partial[8 + j] + partial[12 + j]);
+  }
+  return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+double scalar_sum(const double *a, size_t n) {
+  std::array<double, LANES> partial{};
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    for (size_t l = 0; l < LANES; ++l) {
+      partial[l] += a[i + l];
+    }
+  }
+  double total = combine(partial);
+  for (; i < n; ++i) {
+    total += a[i];
+  }
+  return total;
+}
+
+double scalar_dot(const double *a, const double *b, size_t n) {
+  std::array<double, LANES> partial{};
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    for (size_t l = 0; l < LANES; ++l) {
+      partial[l] += a[i + l] * b[i + l];
+    }
+  }
+  double total = combine(partial);
+  for (; i < n; ++i) {
+    total += a[i] * b[i];
+  }
+  return total;
+}
+
+/// Minimum, or maximum if Max, of a[first, n) and extreme
+template <bool Max>
+double scalar_extreme(const double *a, size_t first, size_t n, double extreme) {
+  bool nan = false;
+  for (size_t i = first; i < n; ++i) {
+    nan |= a[i] != a[i];
+    extreme = (Max ? a[i] > extreme : a[i] < extreme) ? a[i] : extreme;
+  }
+  return nan ? std::numeric_limits<double>::quiet_NaN() : extreme;
+}
+
+double scalar_min(const double *a, size_t n) {
+  return scalar_extreme<false>(a, 0, n, a[0]);
+}
+
+double scalar_max(const double *a, size_t n) {
+  return scalar_extreme<true>(a, 0, n, a[0]);
+}
+
+void scalar_axpy(double alpha, const double *x, double *y, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    y[i] = alpha * x[i] + y[i];
+  }
+}
+
+void scalar_add(const double *a, const double *b, double *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = a[i] + b[i];
+  }
+}
+
+void scalar_mul(const double *a, const double *b, double *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = a[i] * b[i];
+  }
+}
+
+void scalar_scale(const double *a, double k, double *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = a[i] * k;
+  }
+}
+
+//------------------------------AVX2 (4 doubles)-------------------------------
+#ifdef LOX_NUMERIC_AVX2
+
+LOX_TARGET_AVX2 double avx2_combine(__m256d p0, __m256d p1, __m256d p2,
+                                    __m256d p3) {
+  const auto lanes =
+      _mm256_add_pd(_mm256_add_pd(p0, p1), _mm256_add_pd(p2, p3));
+  const auto pair = _mm_add_pd(_mm256_castpd256_pd128(lanes),
+                               _mm256_extractf128_pd(lanes, 1));
+  return _mm_cvtsd_f64(pair) + _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair));
+}
+
+LOX_TARGET_AVX2 double avx2_sum(const double *a, size_t n) {
+  auto p0 = _mm256_setzero_pd();
+  auto p1 = p0;
+  auto p2 = p0;
+  auto p3 = p0;
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    p0 = _mm256_add_pd(p0, _mm256_loadu_pd(a + i));
+    p1 = _mm256_add_pd(p1, _mm256_loadu_pd(a + i + 4));
+    p2 = _mm256_add_pd(p2, _mm256_loadu_pd(a + i + 8));
+    p3 = _mm256_add_pd(p3, _mm256_loadu_pd(a + i + 12));
+  }
+  double total = avx2_combine(p0, p1, p2, p3);
+  for (; i < n; ++i) {
+    total += a[i];
+  }
+  return total;
+}
+
+LOX_TARGET_AVX2 __m256d avx2_product(const double *a, const double *b,
+                                     size_t i) {
+  return _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+}
+
+LOX_TARGET_AVX2 double avx2_dot(const double *a, const double *b, size_t n) {
+  auto p0 = _mm256_setzero_pd();
+  auto p1 = p0;
+  auto p2 = p0;
+  auto p3 = p0;
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    p0 = _mm256_add_pd(p0, avx2_product(a, b, i));
+    p1 = _mm256_add_pd(p1, avx2_product(a, b, i + 4));
+    p2 = _mm256_add_pd(p2, avx2_product(a, b, i + 8));
+    p3 = _mm256_add_pd(p3, avx2_product(a, b, i + 12));
+  }
+  double total = avx2_combine(p0, p1, p2, p3);
+  for (; i < n; ++i) {
+    total += a[i] * b[i];
+  }
+  return total;
+}
+
+template <bool Max>
+LOX_TARGET_AVX2 double avx2_extreme(const double *a, size_t n) {
+  if (n < 4) {
+    return scalar_extreme<Max>(a, 0, n, a[0]);
+  }
+  auto extreme = _mm256_loadu_pd(a);
+  auto nan = _mm256_cmp_pd(extreme, extreme, _CMP_UNORD_Q);
+  size_t i = 4;
+  for (; i + 4 <= n; i += 4) {
+    const auto v = _mm256_loadu_pd(a + i);
+    nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    extreme = Max ? _mm256_max_pd(v, extreme) : _mm256_min_pd(v, extreme);
+  }
+  if (_mm256_movemask_pd(nan) != 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  std::array<double, 4> lanes{};
+  _mm256_storeu_pd(lanes.data(), extreme);
+  return scalar_extreme<Max>(a, i, n,
+                             scalar_extreme<Max>(lanes.data(), 0, 4, lanes[0]));
+}
+
+LOX_TARGET_AVX2 double avx2_min(const double *a, size_t n) {
+  return avx2_extreme<false>(a, n);
+}
+
+LOX_TARGET_AVX2 double avx2_max(const double *a, size_t n) {
+  return avx2_extreme<true>(a, n);
+}
+
+LOX_TARGET_AVX2 void avx2_axpy(double alpha, const double *x, double *y,
+                               size_t n) {
+  const auto factor = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const auto product = _mm256_mul_pd(factor, _mm256_loadu_pd(x + i));
+    _mm256_storeu_pd(y + i, _mm256_add_pd(product, _mm256_loadu_pd(y + i)));
+  }
+  scalar_axpy(alpha, x + i, y + i, n - i);
+}
+
+LOX_TARGET_AVX2 void avx2_add(const double *a, const double *b, double *out,
+                              size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i),
+                                            _mm256_loadu_pd(b + i)));
+  }
+  scalar_add(a + i, b + i, out + i, n - i);
+}
+
+LOX_TARGET_AVX2 void avx2_mul(const double *a, const double *b, double *out,
+                              size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i),
+                                            _mm256_loadu_pd(b + i)));
+  }
+  scalar_mul(a + i, b + i, out + i, n - i);
+}
+
+LOX_TARGET_AVX2 void avx2_scale(const double *a, double k, double *out,
+                                size_t n) {
+  const auto factor = _mm256_set1_pd(k);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), factor));
+  }
+  scalar_scale(a + i, k, out + i, n - i);
+}
+
+#endif // LOX_NUMERIC_AVX2
+
+//------------------------------Dispatch---------------------------------------
+
+struct Kernels {
+  NumericKernels::Implementation implementation;
+  double (*sum)(const double *, size_t);
+  double (*min)(const double *, size_t);
+  double (*max)(const double *, size_t);
+  double (*dot)(const double *, const double *, size_t);
+  void (*axpy)(double, const double *, double *, size_t);
+  void (*add)(const double *, const double *, double *, size_t);
+  void (*mul)(const double *, const double *, double *, size_t);
+  void (*scale)(const double *, double, double *, size_t);
+};
+
+constexpr Kernels scalar_kernels{
+    NumericKernels::Implementation::SCALAR,
+    scalar_sum,
+    scalar_min,
+    scalar_max,
+    scalar_dot,
+    scalar_axpy,
+    scalar_add,
+    scalar_mul,
+    scalar_scale};
+
+#ifdef LOX_NUMERIC_AVX2
+constexpr Kernels avx2_kernels{NumericKernels::Implementation::AVX2,
+                               avx2_sum,
+                               avx2_min,
+                               avx2_max,
+                               avx2_dot,
+                               avx2_axpy,
+                               avx2_add,
+                               avx2_mul,
+                               avx2_scale};
+#endif
+
+const Kernels *kernels_for(NumericKernels::Implementation implementation) {
+#ifdef LOX_NUMERIC_AVX2
+  if (implementation == NumericKernels::Implementation::AVX2 &&
+      __builtin_cpu_supports("avx2")) {
+    return &avx2_kernels;
+  }
+#endif
+  (void)implementation;
+  return &scalar_kernels;
+}
+
+std::atomic<const Kernels *> active{
+    kernels_for(NumericKernels::Implementation::AVX2)};
+
+const Kernels &kernels() { return *active.load(std::memory_order_relaxed); }
+
+/// Bits of value that compare as unsigned integers like the IEEE 754 total
+/// order: negative values have all bits flipped, others only the sign bit
+uint64_t sort_key(double value) {
+  const auto bits = std::bit_cast<uint64_t>(value);
+  return (bits >> 63) != 0 ? ~bits : bits | (uint64_t{1} << 63);
+}
+
+double from_sort_key(uint64_t key) {
+  return std::bit_cast<double>((key >> 63) != 0 ? key & ~(uint64_t{1} << 63)
+                                                : ~key);
+}
+} // namespace
+
+namespace NumericKernels {
+double sum(const double *a, size_t n) { return kernels().sum(a, n); }
+
+double min(const double *a, size_t n) { return kernels().min(a, n); }
+
+double max(const double *a, size_t n) { return kernels().max(a, n); }
+
+double dot(const double *a, const double *b, size_t n) {
+  return kernels().dot(a, b, n);
+}
+
+void axpy(double alpha, const double *x, double *y, size_t n) {
+  kernels().axpy(alpha, x, y, n);
+}
+
+void add(const double *a, const double *b, double *out, size_t n) {
+  kernels().add(a, b, out, n);
+}
+
+void mul(const double *a, const double *b, double *out, size_t n) {
+  kernels().mul(a, b, out, n);
+}
+
+void scale(const double *a, double k, double *out, size_t n) {
+  kernels().scale(a, k, out, n);
+}
+
+void prefix_sum(const double *a, double *out, size_t n) {
+  double total = 0;
+  for (size_t i = 0; i < n; ++i) {
+    total += a[i];
+    out[i] = total;
+  }
+}
+
+void sort(double *a, size_t n) {
+  // Sorting networks of std::sort beat counting passes over short arrays
+  if (n < 256) {
+    std::sort(a, a + n, [](double lhs, double rhs) {
+      return sort_key(lhs) < sort_key(rhs);
+    });
+    return;
+  }
+
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> buffer(n);
+  // Histograms of all 8 bytes of the keys in one pass
+  std::array<std::array<size_t, 256>, 8> offsets{};
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = sort_key(a[i]);
+    for (size_t byte = 0; byte < 8; ++byte) {
+      ++offsets[byte][(keys[i] >> (8 * byte)) & 0xff];
+    }
+  }
+
+  // Least significant byte first, skipping bytes all keys share
+  for (size_t byte = 0; byte < 8; ++byte) {
+    const auto shift = 8 * byte;
+    auto &byte_offsets = offsets[byte];
+    if (byte_offsets[(keys[0] >> shift) & 0xff] == n) {
+      continue;
+    }
+    size_t offset = 0;
+    for (auto &count : byte_offsets) {
+      offset += std::exchange(count, offset);
+    }
+    for (const auto key : keys) {
+      buffer[byte_offsets[(key >> shift) & 0xff]++] = key;
+    }
+    keys.swap(buffer);
+  }
+  std::transform(keys.begin(), keys.end(), a, from_sort_key);
+}
+
+Implementation best_implementation() {
+  return kernels_for(Implementation::AVX2)->implementation;
+}
+
+Implementation active_implementation() { return kernels().implementation; }
+
+void set_implementation(Implementation implementation) {
+  active.store(kernels_for(implementation), std::memory_order_relaxed);
+}
+
+std::string_view to_string(Implementation implementation) {
+  switch (implementation) {
+  case Implementation::SCALAR:
+    return "scalar";
+  case Implementation::AVX2:
+    return "avx2";
+  }
+  return "";
+}
+} // namespace NumericKernels
@@ -0,0 +1,32 @@
+#include "object.hpp"
+
+#include "error.hpp"
+
+Token::Value Object::get(const Token &name, Interpreter &) {
+  throw RuntimeError(name, "Undefined property '" + name.lexeme + "' on " +
+                               to_string() + ".");
+}
+
+void Object::set(const Token &name, Token::Value) {
+  throw RuntimeError(name, "Can't set properties on " + to_string() + ".");
+}
+
+bool Object::is_shareable() const { return false; }
+
+std::shared_ptr<Iterator> Object::iterate() { return nullptr; }
+
+std::shared_ptr<Iterator> Iterator::iterate() { return shared_from_this(); }
+
+NativeMethod::NativeMethod(std::string _name, size_t _arity, Body _body)
+    : name(std::move(_name)), m_arity(_arity), body(std::move(_body)) {}
+
+Token::Value NativeMethod::call(Interpreter &interpreter,
+                                const std::vector<Token::Value> &arguments) {
+  return body(interpreter, arguments);
+}
+
+size_t NativeMethod::arity() const { return m_arity; }
+
+std::string NativeMethod::to_string() const {
+  return "<Native method '" + name + "'>";
+}
@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <filesystem>
 
 #include "function.hpp"
 #include "logging.hpp"
@@ -10,32 +12,20 @@ using Type = Token::TokenType;
 
 namespace {
 constexpr size_t MAX_PARAM_COUNT = 255;
-
-// dynamic_ptr_cast for unique_ptr. Transfers ownership of param to the
-// reuturned ptr if it can be converted. Otherwise, does not transfer ownership
-// and returns nullptr
-template <typename To> std::unique_ptr<To> owned_as(expr &expression) {
-  // Needs to be done in two stages. Otherwise, memory leaks if the conversion
-  // of a unique_ptr fails
-  if (auto *cast = dynamic_cast<To *>(expression.get())) {
-    std::unique_ptr<To> result(
-        cast); // Dangerous, takes ownership of an already-owned ptr
-    static_cast<void>(expression.release()); // This makes it ok
-    return result;
-  }
-  return nullptr;
-}
 } // namespace
 
-Parser::Parser(std::vector<Token> _tokens,
+Parser::Parser(CompilationUnit &_unit,
                std::shared_ptr<ErrorHandler> _err_handler)
-    : err_handler(std::move(_err_handler)), tokens(std::move(_tokens)) {}
+    : err_handler(std::move(_err_handler)), arena(_unit.arena), unit(_unit),
+      tokens(_unit.tokens), end(_unit.tokens.size() - 1) {}
 
 const char *Parser::ParseError::what() const noexcept { return message; }
 
 //---------------Primitive parser function implementations-----------------
 
-bool Parser::is_at_end() const { return peek().type == Type::EOF_; }
+bool Parser::is_at_end() const {
+  return current >= end || peek().type == Type::EOF_;
+}
 
 const Token &Parser::peek() const { return tokens[current]; }
 
@@ -78,23 +68,57 @@ stmt Parser::declaration() {
       return var_declaration();
     if (match(Type::CLASS))
       return class_declaration();
+    if (match(Type::IMPORT))
+      return import_declaration();
 
     return statement();
   } catch (const ParseError &err) {
     synchronize();
-    return new_stmt<MalformedStmt>(true, err.what());
+    return new_stmt<MalformedStmt>(arena, true, err.what());
   }
 }
 
 stmt Parser::var_declaration() {
   Token name = consume(Type::IDENTIFIER, "Expect variable identitifier");
 
-  expr initializer = new_expr<Empty>();
+  expr initializer = new_expr<Empty>(arena);
   if (match(Type::EQUAL)) {
     initializer = expression();
   }
   consume(Type::SEMICOLON, "Expect ';' after variable declaration");
-  return new_stmt<VarStmt>(std::move(name), std::move(initializer));
+  return new_stmt<VarStmt>(arena, std::move(name), std::move(initializer));
+}
+
+stmt Parser::import_declaration() {
+  Token keyword = previous();
+  const auto &path_token =
+      consume(Type::STRING, "Expect module path string after 'import'");
+  auto path = std::get<std::string>(path_token.value);
+
+  auto name = [&]() -> Token {
+    if (check(Type::IDENTIFIER) && peek().lexeme == "as") {
+      advance();
+      return consume(Type::IDENTIFIER, "Expect module name after 'as'");
+    }
+
+    // Default to the file name without its extension
+    auto stem = std::filesystem::path{path}.stem().string();
+    const auto is_identifier_char = [](char c) {
+      return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+    if (stem.empty() || std::isdigit(static_cast<unsigned char>(stem[0])) ||
+        !std::all_of(stem.begin(), stem.end(), is_identifier_char)) {
+      throw error(path_token, "Module file name '" + stem +
+                                  "' is not an identifier, use 'as' to name "
+                                  "the module");
+    }
+    return Token{Type::IDENTIFIER, std::move(stem), NullType{},
+                 path_token.line};
+  }();
+
+  consume(Type::SEMICOLON, "Expect ';' after import");
+  return new_stmt<ImportStmt>(arena, std::move(keyword), std::move(path),
+                              std::move(name));
 }
 
 stmt Parser::statement() {
@@ -105,11 +129,13 @@ stmt Parser::statement() {
   if (match(Type::WHILE))
     return while_statement();
   if (match(Type::LEFT_BRACE))
-    return new_stmt<BlockStmt>(block());
+    return new_stmt<BlockStmt>(arena, block());
   if (match(Type::PRINT))
     return print_statement();
   if (match(Type::RETURN))
     return return_statement();
+  if (match(Type::YIELD))
+    return yield_statement();
 
   return expression_statement();
 }
@@ -117,8 +143,11 @@ stmt Parser::statement() {
 FunctionStmtPtr Parser::getter_declaration(Token name) {
   consume(Type::LEFT_BRACE, "Expect '{' after getter identifier");
 
-  return std::make_unique<FunctionStmt>(std::move(name), std::vector<Token>{},
-                                        block(), FunctionKind::GETTER);
+  auto *deferred = defer_body();
+  auto body = deferred != nullptr ? std::vector<stmt>{} : block();
+  return arena.create<FunctionStmt>(std::move(name), std::vector<Token>{},
+                                    std::move(body), FunctionKind::GETTER,
+                                    std::move(deferred));
 }
 
 FunctionStmtPtr Parser::function_declaration(FunctionKind kind) {
@@ -134,18 +163,35 @@ FunctionStmtPtr Parser::function_declaration(FunctionKind kind) {
   consume(Type::RIGHT_PAREN, "Expect ')' after parameter list.");
   consume(Type::LEFT_BRACE, "Expect '{' before " + str(kind) + " body.");
 
-  return std::make_unique<FunctionStmt>(std::move(name), std::move(params),
-                                        block(), kind);
+  auto *deferred = defer_body();
+  auto body = deferred != nullptr ? std::vector<stmt>{} : block();
+  return arena.create<FunctionStmt>(std::move(name), std::move(params),
+                                    std::move(body), kind, std::move(deferred));
 }
 
 stmt Parser::class_declaration() {
   auto name =
       consume(Type::IDENTIFIER, "Expect class name after 'class' keyword");
 
+  // Record classes list their fields: class Name(field, ...) { ... }
+  std::vector<Token> fields;
+  if (match(Type::LEFT_PAREN)) {
+    do {
+      if (fields.size() >= MAX_PARAM_COUNT) {
+        throw error(peek(), "Cannot define more than 255 fields.");
+      }
+      fields.push_back(consume(Type::IDENTIFIER, "Expect field name"));
+    } while (match(Type::COMMA));
+    consume(Type::RIGHT_PAREN, "Expect ')' after fields");
+  }
+
   VarPtr superclass = nullptr;
   if (match(Type::LESS)) {
+    if (!fields.empty()) {
+      throw error(previous(), "Record classes can't have a superclass");
+    }
     auto superclass_name = consume(Type::IDENTIFIER, "Expect superclass name");
-    superclass = std::make_unique<Variable>(std::move(superclass_name));
+    superclass = arena.create<Variable>(std::move(superclass_name));
   }
 
   consume(Type::LEFT_BRACE, "Expect '{' after class identifier");
@@ -160,8 +206,8 @@ stmt Parser::class_declaration() {
 
   consume(Type::RIGHT_BRACE, "Expect '}' after class body");
 
-  return new_stmt<ClassStmt>(std::move(name), std::move(methods),
-                             std::move(superclass));
+  return new_stmt<ClassStmt>(arena, std::move(name), std::move(methods),
+                             std::move(superclass), std::move(fields));
 }
 
 std::vector<Token> Parser::parameters() {
@@ -177,10 +223,27 @@ std::vector<Token> Parser::parameters() {
 }
 
 stmt Parser::for_statement() {
+  Token keyword = previous();
   consume(Type::LEFT_PAREN, "Expect '(' after 'for'.");
 
+  // 'for (var name in iterable)'. 'in' is only a keyword here
+  if (check(Type::VAR) && current + 2 < end &&
+      tokens[current + 1].type == Type::IDENTIFIER &&
+      tokens[current + 2].type == Type::IDENTIFIER &&
+      tokens[current + 2].lexeme == "in") {
+    advance();
+    Token name = advance();
+    advance();
+
+    expr iterable = expression();
+    consume(Type::RIGHT_PAREN, "Expect ')' after iterable of for loop.");
+    stmt body = statement();
+    return new_stmt<ForInStmt>(arena, std::move(keyword), std::move(name),
+                               std::move(iterable), std::move(body));
+  }
+
   // First clause: initializer
-  stmt initializer;
+  stmt initializer = nullptr;
   if (match(Type::SEMICOLON)) {
     ; // Do nothing
   } else if (match(Type::VAR)) {
@@ -210,21 +273,22 @@ stmt Parser::for_statement() {
   if (increment != nullptr) { // Add increment into while loop body
     std::vector<stmt> body_statements;
     body_statements.push_back(std::move(body));
-    body_statements.push_back(new_stmt<ExprStmt>(std::move(increment)));
+    body_statements.push_back(
+        new_stmt<ExprStmt>(arena, std::move(increment)));
 
-    body = new_stmt<BlockStmt>(std::move(body_statements));
+    body = new_stmt<BlockStmt>(arena, std::move(body_statements));
   }
 
   if (condition == nullptr) { // Add condition, or true if none specified
-    condition = new_expr<Literal>(true);
+    condition = new_expr<Literal>(arena, true);
   }
-  body = new_stmt<WhileStmt>(std::move(condition), std::move(body));
+  body = new_stmt<WhileStmt>(arena, std::move(condition), std::move(body));
 
   if (initializer != nullptr) { // Add outer block with init if necessary
     std::vector<stmt> full_statements;
     full_statements.push_back(std::move(initializer));
     full_statements.push_back(std::move(body));
-    body = new_stmt<BlockStmt>(std::move(full_statements));
+    body = new_stmt<BlockStmt>(arena, std::move(full_statements));
   }
 
   return body;
@@ -236,7 +300,7 @@ stmt Parser::while_statement() {
   consume(Type::RIGHT_PAREN, "Expect ')' after while condition");
   stmt body = statement();
 
-  return new_stmt<WhileStmt>(std::move(cond), std::move(body));
+  return new_stmt<WhileStmt>(arena, std::move(cond), std::move(body));
 }
 
 stmt Parser::if_statement() {
@@ -245,12 +309,12 @@ stmt Parser::if_statement() {
   consume(Type::RIGHT_PAREN, "Expect ')' after condition of if statement.");
 
   stmt then_stmt = statement();
-  stmt else_stmt = new_stmt<EmptyStmt>();
+  stmt else_stmt = new_stmt<EmptyStmt>(arena);
   if (match(Type::ELSE)) {
     else_stmt = statement();
   }
 
-  return new_stmt<IfStmt>(std::move(cond), std::move(then_stmt),
+  return new_stmt<IfStmt>(arena, std::move(cond), std::move(then_stmt),
                           std::move(else_stmt));
 }
 
@@ -265,21 +329,41 @@ std::vector<stmt> Parser::block() {
   return statements;
 }
 
+DeferredBody *Parser::defer_body() {
+  if (unit.mode == ParseMode::EAGER) {
+    return nullptr;
+  }
+
+  const size_t open = current - 1;
+  size_t depth = 1;
+  while (!is_at_end()) {
+    const auto type = advance().type;
+    if (type == Type::LEFT_BRACE) {
+      ++depth;
+    } else if (type == Type::RIGHT_BRACE && --depth == 0) {
+      return arena.create<DeferredBody>(&unit, open, current - 1,
+                                        tokens[open].line);
+    }
+  }
+
+  throw error(peek(), "Expect '}' after block.");
+}
+
 stmt Parser::print_statement() {
   expr value = expression();
   consume(Type::SEMICOLON, "Expect ';' after statement");
-  return new_stmt<PrintStmt>(std::move(value));
+  return new_stmt<PrintStmt>(arena, std::move(value));
 }
 
 stmt Parser::expression_statement() {
   expr value = expression();
   consume(Type::SEMICOLON, "Expect ';' after expression");
-  return new_stmt<ExprStmt>(std::move(value));
+  return new_stmt<ExprStmt>(arena, std::move(value));
 }
 
 stmt Parser::return_statement() {
   Token return_keyword = previous(); // Keep for error-reporting
-  expr body = new_expr<Empty>();     // Returned value is optional.
+  expr body = new_expr<Empty>(arena); // Returned value is optional.
 
   if (not check(Type::SEMICOLON)) {
     body = expression();
@@ -287,7 +371,21 @@ stmt Parser::return_statement() {
 
   consume(Type::SEMICOLON, "Expect ';' after 'return' statement's expression");
 
-  return new_stmt<ReturnStmt>(std::move(return_keyword), std::move(body));
+  return new_stmt<ReturnStmt>(arena, std::move(return_keyword),
+                              std::move(body));
+}
+
+stmt Parser::yield_statement() {
+  Token keyword = previous();
+  expr value = new_expr<Empty>(arena); // Yields nil without a value
+
+  if (not check(Type::SEMICOLON)) {
+    value = expression();
+  }
+
+  consume(Type::SEMICOLON, "Expect ';' after 'yield' statement's expression");
+
+  return new_stmt<YieldStmt>(arena, std::move(keyword), std::move(value));
 }
 
 /** Binary left-associative productions of the form
@@ -305,16 +403,17 @@ static expr left_associative_binary_production(Parser *owner) {
     (owner->*production)(); // Discard result
     owner->err_handler->error(prev,
                               "Illegal use of unary operator " + prev.lexeme);
-    return new_expr<Malformed>(true,
+    return new_expr<Malformed>(owner->arena, true,
                                "Illegal use of unary operator " + prev.lexeme);
   }
   expr result = (owner->*production)();
 
   while (owner->match(matched_types)) {
-    Token op = owner->previous();
+    const Token &op = owner->previous();
+    Operator binary_op{op.type, op.line};
     expr rhs = (owner->*production)();
-    result =
-        new_expr<expr_type>(std::move(result), std::move(op), std::move(rhs));
+    result = new_expr<expr_type>(owner->arena, std::move(result),
+                                 std::move(binary_op), std::move(rhs));
   }
   return result;
 }
@@ -335,14 +434,19 @@ expr Parser::assignment() {
     const auto &equal = previous();
     expr value = assignment();
 
-    if (auto variable = owned_as<Variable>(x_value)) {
-      return new_expr<Assign>(std::move(variable->child<0>()),
+    if (auto *variable = dynamic_cast<Variable *>(x_value)) {
+      return new_expr<Assign>(arena, std::move(variable->child<0>()),
                               std::move(value));
     }
-    if (auto get = owned_as<Get>(x_value)) {
-      return new_expr<Set>(std::move(get->child<0>()),
+    if (auto *get = dynamic_cast<Get *>(x_value)) {
+      return new_expr<Set>(arena, std::move(get->child<0>()),
                            std::move(get->child<1>()), std::move(value));
     }
+    if (auto *index = dynamic_cast<Index *>(x_value)) {
+      return new_expr<IndexSet>(arena, std::move(index->child<0>()),
+                                std::move(index->child<1>()),
+                                std::move(index->child<2>()), std::move(value));
+    }
 
     static_cast<void>(error(equal, // NOLINT: I don't throw this on purpose
                             "Invalid assignment operator"));
@@ -354,14 +458,15 @@ expr Parser::ternary_conditional() {
   expr result = or_expression();
 
   if (match(Type::QUESTION_MARK)) {
-    Token question_mark = previous();
+    Operator question_mark{previous().type, previous().line};
     expr middle = expression();
-    Token colon = consume(
+    const Token &colon_token = consume(
         Type::COLON, "Expected ':' after '?' for ternary conditional operator");
+    Operator colon{colon_token.type, colon_token.line};
     expr right = expression();
-    result = new_expr<Ternary>(std::move(result), std::move(question_mark),
-                               std::move(middle), std::move(colon),
-                               std::move(right));
+    result = new_expr<Ternary>(arena, std::move(result),
+                               std::move(question_mark), std::move(middle),
+                               std::move(colon), std::move(right));
   }
   return result;
 }
@@ -410,8 +515,8 @@ expr Parser::multiplication() {
 
 expr Parser::unary() {
   if (match({Type::BANG, Type::MINUS})) {
-    Token prev = previous();
-    return new_expr<Unary>(std::move(prev), unary());
+    Operator prev{previous().type, previous().line};
+    return new_expr<Unary>(arena, std::move(prev), unary());
   }
   return call();
 }
@@ -424,7 +529,9 @@ expr Parser::call() {
       result = finish_call(std::move(result));
     } else if (match(Type::DOT)) {
       auto name = consume(Type::IDENTIFIER, "Expect property name after '.'");
-      result = new_expr<Get>(std::move(result), std::move(name));
+      result = new_expr<Get>(arena, std::move(result), std::move(name));
+    } else if (match(Type::LEFT_BRACKET)) {
+      result = finish_index(result);
     } else {
       break;
     }
@@ -444,48 +551,82 @@ expr Parser::finish_call(expr callee) {
     } while (match(Type::COMMA));
   }
 
-  Token paren = consume(Type::RIGHT_PAREN, "Expect ')' after arguments");
+  const Token &paren_token =
+      consume(Type::RIGHT_PAREN, "Expect ')' after arguments");
+  Operator paren{paren_token.type, paren_token.line};
 
-  return new_expr<Call>(std::move(callee), std::move(paren),
+  return new_expr<Call>(arena, std::move(callee), std::move(paren),
                         std::move(arguments));
 }
 
+expr Parser::finish_index(expr object) {
+  Operator bracket{previous().type, previous().line};
+
+  // 'object[start:end]' with either bound optional, or 'object[index]'
+  auto start =
+      check(Type::COLON) ? new_expr<Empty>(arena) : comma_expression();
+  if (match(Type::COLON)) {
+    auto end = check(Type::RIGHT_BRACKET) ? new_expr<Empty>(arena)
+                                          : comma_expression();
+    consume(Type::RIGHT_BRACKET, "Expect ']' after slice");
+    return new_expr<Slice>(arena, std::move(object), std::move(bracket),
+                           std::move(start), std::move(end));
+  }
+
+  consume(Type::RIGHT_BRACKET, "Expect ']' after index");
+  return new_expr<Index>(arena, std::move(object), std::move(bracket),
+                         std::move(start));
+}
+
 expr Parser::primary() {
   if (match(Type::FALSE))
-    return new_expr<Literal>(false);
+    return new_expr<Literal>(arena, false);
   if (match(Type::TRUE))
-    return new_expr<Literal>(true);
+    return new_expr<Literal>(arena, true);
 
   if (match(Type::NIL))
-    return new_expr<Literal>(NullType());
+    return new_expr<Literal>(arena, NullType());
 
   if (match({Type::NUMBER, Type::STRING})) {
     auto previous_val = previous().value;
-    return new_expr<Literal>(std::move(previous_val));
+    return new_expr<Literal>(arena, std::move(previous_val));
   }
 
   if (match(Type::THIS)) {
     // Copy required because ExprProduction takes rvalue refs in constructor.
     auto this_token = previous();
-    return new_expr<This>(std::move(this_token));
+    return new_expr<This>(arena, std::move(this_token));
   }
 
   if (match(Type::IDENTIFIER)) {
     auto variable = previous();
-    return new_expr<Variable>(std::move(variable));
+    return new_expr<Variable>(arena, std::move(variable));
+  }
+
+  if (match(Type::LEFT_BRACKET)) {
+    Operator bracket{previous().type, previous().line};
+    std::vector<expr> elements;
+    if (!check(Type::RIGHT_BRACKET)) {
+      do {
+        elements.push_back(comma_expression());
+      } while (match(Type::COMMA));
+    }
+    consume(Type::RIGHT_BRACKET, "Expect ']' after array elements");
+    return new_expr<ArrayLiteral>(arena, std::move(bracket),
+                                  std::move(elements));
   }
 
   if (match(Type::LEFT_PAREN)) {
     expr middle = expression();
     consume(Type::RIGHT_PAREN, "Expected ')' after expression");
-    return new_expr<Grouping>(std::move(middle));
+    return new_expr<Grouping>(arena, std::move(middle));
   }
 
   if (match(Type::SUPER)) {
     auto super_keyword = previous();
     consume(Type::DOT, "Expect '.' after super");
     return new_expr<Super>(
-        std::move(super_keyword),
+        arena, std::move(super_keyword),
         cp(consume(Type::IDENTIFIER, "Expect identifier for super access")),
         false);
   }
@@ -494,17 +635,19 @@ expr Parser::primary() {
     auto params = check(Type::PIPE) ? std::vector<Token>{} : parameters();
     consume(Type::PIPE, "Expect '|' to finish lambda parameter list");
     if (match(Type::LEFT_BRACE)) {
-      return new_expr<Lambda>(std::move(params), block());
+      auto *deferred = defer_body();
+      auto body = deferred != nullptr ? std::vector<stmt>{} : block();
+      return new_expr<Lambda>(arena, std::move(params), std::move(body),
+                              std::move(deferred));
     }
 
     Token return_keyword =
         previous(); // Keep for error-reporting. Copy required here
     stmt implicit_return =
-        std::make_unique<ReturnStmt>(std::move(return_keyword), expression());
-    std::vector<stmt> block; // Initialization in constructor not possible
-                             // because of unique_ptr
-    block.emplace_back(std::move(implicit_return));
-    return new_expr<Lambda>(std::move(params), std::move(block));
+        new_stmt<ReturnStmt>(arena, std::move(return_keyword), expression());
+    return new_expr<Lambda>(arena, std::move(params),
+                            std::vector<stmt>{implicit_return},
+                            static_cast<DeferredBody *>(nullptr));
   }
 
   throw error(peek(), "Expect expression.");
@@ -531,11 +674,13 @@ void Parser::synchronize() {
     case Type::CLASS:
     case Type::FUN:
     case Type::VAR:
+    case Type::IMPORT:
     case Type::FOR:
     case Type::IF:
     case Type::WHILE:
     case Type::PRINT:
     case Type::RETURN:
+    case Type::YIELD:
       return;
     default:
       advance();
@@ -552,3 +697,16 @@ std::vector<stmt> Parser::parse() {
 
   return statements;
 }
+
+std::vector<stmt> Parser::parse_body(const DeferredBody &deferred) {
+  // Parse only up to and including the closing brace, so error recovery can't
+  // run into the code following the body
+  current = deferred.open + 1;
+  end = deferred.close + 1;
+
+  try {
+    return block();
+  } catch (const ParseError &) {
+    return {}; // Already reported
+  }
+}
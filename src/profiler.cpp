@@ -0,0 +1,198 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "class.hpp"
+#include "function.hpp"
+#include "logging.hpp"
+
+namespace {
+/// Frames deeper than this are counted, but samples only show the outer ones
+constexpr uint32_t MAX_DEPTH = 128;
+/// Frames of all samples. Zeroed lazily by calloc(), so only the part used
+/// costs memory
+constexpr size_t BUFFER_FRAMES = size_t{1} << 22;
+
+struct Frame {
+  /// Interned, so it outlives the function
+  const std::string *name;
+  uint32_t line;
+};
+
+/// Written by its thread, and read by the signal handler interrupting it
+struct ShadowStack {
+  std::array<Frame, MAX_DEPTH> frames;
+  std::atomic<uint32_t> depth;
+};
+thread_local ShadowStack stack{};
+
+/// Names of the functions seen, never freed
+std::mutex names_mutex;
+std::unordered_set<std::string> names;
+
+/// Samples follow each other in the buffer as a header, whose line is the
+/// number of frames plus one, and the frames outermost first. A zero header
+/// ends the samples
+Frame *buffer = nullptr;
+std::atomic<size_t> used = 0;
+std::atomic<size_t> dropped = 0;
+std::atomic<int> handlers_running = 0;
+
+std::string profile_path;
+pid_t profiling_process = 0;
+
+const std::string *intern(const std::string &name) {
+  // Threads remember recent names by the address of the callee's name. The
+  // contents are compared, as that address may be reused for another name
+  thread_local std::array<const std::string *, 256> recent{};
+  auto &slot =
+      recent[(reinterpret_cast<uintptr_t>(&name) >> 4) % recent.size()];
+  if (slot == nullptr || *slot != name) {
+    const std::scoped_lock lock{names_mutex};
+    slot = &*names.insert(name).first;
+  }
+  return slot;
+}
+
+void sample(int) {
+  const auto saved_errno = errno;
+  // Sequentially consistent with finish(), which waits for handlers that saw
+  // the profiler active
+  handlers_running.fetch_add(1);
+
+  if (Profiler::detail::active.load()) {
+    const auto depth =
+        std::min(stack.depth.load(std::memory_order_relaxed), MAX_DEPTH);
+    std::atomic_signal_fence(std::memory_order_acquire);
+    const auto start = used.fetch_add(depth + 1, std::memory_order_relaxed);
+    if (start + depth + 1 <= BUFFER_FRAMES) {
+      std::copy_n(stack.frames.begin(), depth, buffer + start + 1);
+      buffer[start] = Frame{nullptr, depth + 1};
+    } else {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  handlers_running.fetch_sub(1);
+  errno = saved_errno;
+}
+
+void set_timer(unsigned frequency) {
+  itimerval timer{};
+  if (frequency > 0) {
+    const auto interval = 1000000 / frequency; // In microseconds
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+  }
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+} // namespace
+
+bool Profiler::detail::push(const Callable &callee, unsigned line) {
+  const std::string *name = nullptr;
+  if (const auto *function = dynamic_cast<const Function *>(&callee)) {
+    name = &function->name();
+  } else if (const auto *klass = dynamic_cast<const Class *>(&callee)) {
+    name = &klass->name();
+  } else {
+    return false;
+  }
+
+  const auto depth = stack.depth.load(std::memory_order_relaxed);
+  if (depth < MAX_DEPTH) {
+    stack.frames[depth] = Frame{intern(*name), line};
+  }
+  // The handler must not see the new depth before the frame
+  std::atomic_signal_fence(std::memory_order_release);
+  stack.depth.store(depth + 1, std::memory_order_relaxed);
+  return true;
+}
+
+void Profiler::detail::pop() {
+  stack.depth.store(stack.depth.load(std::memory_order_relaxed) - 1,
+                    std::memory_order_relaxed);
+}
+
+bool Profiler::start(std::string path, unsigned frequency) {
+  if (frequency == 0 || frequency > 1000000) {
+    LOG_ERROR("Profiling frequency must be in 1 to 1000000 Hz");
+    return false;
+  }
+  buffer = static_cast<Frame *>(std::calloc(BUFFER_FRAMES, sizeof(Frame)));
+  if (buffer == nullptr) {
+    return false;
+  }
+
+  struct sigaction action {};
+  action.sa_handler = sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    return false;
+  }
+
+  profile_path = std::move(path);
+  profiling_process = getpid();
+  detail::active = true;
+  std::atexit(finish);
+  set_timer(frequency);
+  return true;
+}
+
+void Profiler::finish() {
+  if (profiling_process == 0 || profiling_process != getpid()) {
+    return; // Not started, already finished or a forked child
+  }
+  profiling_process = 0;
+
+  set_timer(0);
+  detail::active = false;
+  // Handlers may still run on other threads
+  while (handlers_running.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  std::map<std::string, size_t> stacks;
+  const auto end = std::min(used.load(), BUFFER_FRAMES);
+  for (size_t position = 0; position < end && buffer[position].line != 0;) {
+    const auto depth = buffer[position].line - 1;
+    std::string folded;
+    for (uint32_t i = 1; i <= depth; ++i) {
+      const auto &frame = buffer[position + i];
+      if (!folded.empty()) {
+        folded += ';';
+      }
+      folded += *frame.name + ':' + std::to_string(frame.line);
+    }
+    ++stacks[folded.empty() ? "<top level>" : folded];
+    position += depth + 1;
+  }
+  std::free(buffer);
+  buffer = nullptr;
+
+  std::ofstream out{profile_path};
+  for (const auto &[folded, count] : stacks) {
+    out << folded << ' ' << count << '\n';
+  }
+  if (!out) {
+    LOG_ERROR("Profile ", profile_path, " could not be written");
+  }
+  if (dropped > 0) {
+    LOG_ERROR("Profile buffer full, ", dropped.load(), " samples dropped");
+  }
+}
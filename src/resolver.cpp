@@ -1,12 +1,13 @@
 #include "resolver.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include "logging.hpp"
 
-Resolver::Resolver(Interpreter &_interpreter) : interpreter(_interpreter) {}
-
-void Resolver::resolve(const expr &expression) { resolve(expression.get()); }
+Resolver::Resolver(std::shared_ptr<ErrorHandler> _err_handler)
+    : err_handler(std::move(_err_handler)) {}
 
 void Resolver::resolve(Expr *expression) {
   if (expression != nullptr) {
@@ -14,14 +15,18 @@ void Resolver::resolve(Expr *expression) {
   }
 }
 
-void Resolver::resolve(const stmt &statement) {
+void Resolver::resolve(Statement *statement) {
+  if (statement == nullptr) {
+    return;
+  }
+
+  enclosing_statements.push_back(statement);
   try {
-    if (statement != nullptr) {
-      dynamic_cast<StmtVisitableBase &>(*statement).accept(*this);
-    }
+    dynamic_cast<StmtVisitableBase &>(*statement).accept(*this);
   } catch (const CompiletimeError &err) {
-    interpreter.err_handler->error(err.token, err.what());
+    err_handler->error(err.token, err.what());
   }
+  enclosing_statements.pop_back();
 }
 
 void Resolver::resolve(const std::vector<stmt> &statements) {
@@ -113,14 +118,24 @@ void Resolver::visit(FunctionStmt &node) {
   declare(name);
   define(name);
 
-  resolve_function(node.child<1>(), node.child<2>(), node.child<3>());
+  resolve_function(node.child<1>(), node.child<2>(), node.child<3>(),
+                   node.child<4>());
 }
 
 void Resolver::resolve_function(const std::vector<Token> &params,
                                 const std::vector<stmt> &body,
-                                FunctionKind kind) {
+                                FunctionKind kind, DeferredBody *deferred) {
+  if (deferred != nullptr && not deferred->materialized) {
+    deferred->scopes = scopes;
+    deferred->class_kind = class_kind;
+    deferred->record_fields = record_fields;
+    return;
+  }
+
   auto enclosing_function = function_kind;
   function_kind = kind;
+  const auto enclosing_function_statements =
+      std::exchange(function_statements, enclosing_statements.size());
 
   LOG_DEBUG("Resolving function with kind: ", kind);
 
@@ -144,10 +159,46 @@ void Resolver::resolve_function(const std::vector<Token> &params,
   scopes.pop_back();
 
   function_kind = enclosing_function;
+  function_statements = enclosing_function_statements;
 }
 
 void Resolver::visit(Lambda &node) {
-  resolve_function(node.child<0>(), node.child<1>(), FunctionKind::LAMDBDA);
+  resolve_function(node.child<0>(), node.child<1>(), FunctionKind::LAMDBDA,
+                   node.child<2>());
+}
+
+void Resolver::resolve_deferred(FunctionStmt &node) {
+  auto &deferred = *node.child<4>();
+  scopes = deferred.scopes;
+  class_kind = deferred.class_kind;
+  record_fields = deferred.record_fields;
+  function_needs_return = (node.child<3>() == FunctionKind::GETTER);
+
+  try {
+    // The body is parsed by now, so it is resolved like an eager one
+    resolve_function(node.child<1>(), node.child<2>(), node.child<3>(),
+                     nullptr);
+  } catch (const CompiletimeError &err) {
+    err_handler->error(err.token, err.what());
+  }
+
+  if (function_needs_return) {
+    err_handler->warn(node.child<0>(), "Getters must return a value");
+  }
+}
+
+void Resolver::resolve_deferred(Lambda &node) {
+  auto &deferred = *node.child<2>();
+  scopes = deferred.scopes;
+  class_kind = deferred.class_kind;
+  record_fields = deferred.record_fields;
+
+  try {
+    resolve_function(node.child<0>(), node.child<1>(), FunctionKind::LAMDBDA,
+                     nullptr);
+  } catch (const CompiletimeError &err) {
+    err_handler->error(err.token, err.what());
+  }
 }
 
 void Resolver::visit(ReturnStmt &node) {
@@ -155,7 +206,7 @@ void Resolver::visit(ReturnStmt &node) {
     throw CompiletimeError(node.child<0>(), "Can't return from top-level code");
   }
   if (*function_kind == FunctionKind::CONSTRUCTOR &&
-      dynamic_cast<Empty *>(node.child<1>().get()) == nullptr) {
+      dynamic_cast<Empty *>(node.child<1>()) == nullptr) {
     throw CompiletimeError(node.child<0>(),
                            "Can't return values from 'init' methods. "
                            "Implicitly returns a new instance of the class");
@@ -167,6 +218,25 @@ void Resolver::visit(ReturnStmt &node) {
   resolve(node.child<1>());
 }
 
+void Resolver::visit(YieldStmt &node) {
+  if (not function_kind.has_value()) {
+    throw CompiletimeError(node.child<0>(), "Can't yield from top-level code");
+  }
+  if (*function_kind == FunctionKind::CONSTRUCTOR ||
+      *function_kind == FunctionKind::GETTER) {
+    throw CompiletimeError(node.child<0>(),
+                           "Can't yield from 'init' methods or getters");
+  }
+
+  // The function becomes a generator. Statements around the yield have to be
+  // resumable, the others run as usual
+  for (auto i = function_statements; i < enclosing_statements.size(); ++i) {
+    enclosing_statements[i]->suspends = true;
+  }
+
+  resolve(node.child<1>());
+}
+
 void Resolver::visit(ClassStmt &node) {
   auto previous_type = class_kind;
   class_kind = ClassKind::CLASS;
@@ -181,12 +251,23 @@ void Resolver::visit(ClassStmt &node) {
                            "A class can't inherit from itself.");
   }
 
+  const auto &fields = node.child<3>();
+  for (auto field = fields.begin(); field != fields.end(); ++field) {
+    if (std::find_if(fields.begin(), field, [&](const Token &other) {
+          return other.lexeme == field->lexeme;
+        }) != field) {
+      throw CompiletimeError(*field, "Duplicate field " + field->lexeme);
+    }
+  }
+  const auto *previous_record_fields =
+      std::exchange(record_fields, fields.empty() ? nullptr : &fields);
+
   auto previous_class_kind = class_kind;
 
   if (superclass != nullptr) {
     class_kind = ClassKind::SUBCLASS;
 
-    resolve(superclass.get());
+    resolve(superclass);
     scopes.emplace_back();
     // Like 'this', 'super' is just a variable that lives in an outer scope.
     // 'super' is only bound once per class, rather than per instance. The
@@ -205,13 +286,24 @@ void Resolver::visit(ClassStmt &node) {
       kind = FunctionKind::CONSTRUCTOR;
     }
 
-    function_needs_return = (kind == FunctionKind::GETTER);
+    if (kind == FunctionKind::GETTER &&
+        std::any_of(fields.begin(), fields.end(), [&](const Token &field) {
+          return field.lexeme == method->child<0>().lexeme;
+        })) {
+      err_handler->error(method->child<0>(),
+                         "A field by this name exists. The getter would make "
+                         "it inaccessible");
+    }
+
+    // Getters with deferred bodies are checked when they are materialized
+    function_needs_return =
+        (kind == FunctionKind::GETTER && method->child<4>() == nullptr);
 
-    resolve_function(method->child<1>(), method->child<2>(), kind);
+    resolve_function(method->child<1>(), method->child<2>(), kind,
+                     method->child<4>());
 
     if (function_needs_return) {
-      interpreter.err_handler->warn(method->child<0>(),
-                                    "Getters must return a value");
+      err_handler->warn(method->child<0>(), "Getters must return a value");
     }
   }
 
@@ -223,6 +315,7 @@ void Resolver::visit(ClassStmt &node) {
   }
 
   class_kind = previous_type;
+  record_fields = previous_record_fields;
 }
 
 void Resolver::visit(This &node) {
@@ -261,6 +354,12 @@ void Resolver::visit(Super &node) {
 // ----------------------Remaining visit impls that do nothing
 // interesting---------------------------------
 
+void Resolver::visit(ImportStmt &node) {
+  // The module itself is resolved on its own when it is compiled
+  declare(node.child<2>());
+  define(node.child<2>());
+}
+
 void Resolver::visit(ExprStmt &node) { resolve(node.child<0>()); }
 
 void Resolver::visit(IfStmt &node) {
@@ -279,6 +378,17 @@ void Resolver::visit(WhileStmt &node) {
   resolve(node.child<1>());
 }
 
+void Resolver::visit(ForInStmt &node) {
+  resolve(node.child<2>());
+
+  // Every iteration binds the loop variable in a new scope around the body
+  scopes.emplace_back();
+  declare(node.child<1>());
+  define(node.child<1>());
+  resolve(node.child<3>());
+  scopes.pop_back();
+}
+
 void Resolver::visit(Binary &node) {
   resolve(node.child<0>());
   resolve(node.child<2>());
@@ -317,13 +427,53 @@ void Resolver::visit(MalformedStmt &) {}
 
 void Resolver::visit(EmptyStmt &) {}
 
-void Resolver::visit(Get &node) { resolve(node.child<0>()); }
+void Resolver::resolve_field(FieldAccess &node, Expr *object,
+                             const Token &name) {
+  if (record_fields == nullptr || dynamic_cast<This *>(object) == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < record_fields->size(); ++i) {
+    if ((*record_fields)[i].lexeme == name.lexeme) {
+      node.field_index = static_cast<uint32_t>(i);
+      return;
+    }
+  }
+}
+
+void Resolver::visit(Get &node) {
+  resolve(node.child<0>());
+  resolve_field(node, node.child<0>(), node.child<1>());
+}
+
+void Resolver::visit(ArrayLiteral &node) {
+  for (const auto &element : node.child<1>()) {
+    resolve(element);
+  }
+}
+
+void Resolver::visit(Index &node) {
+  resolve(node.child<0>());
+  resolve(node.child<2>());
+}
+
+void Resolver::visit(IndexSet &node) {
+  resolve(node.child<0>());
+  resolve(node.child<2>());
+  resolve(node.child<3>());
+}
+
+void Resolver::visit(Slice &node) {
+  resolve(node.child<0>());
+  resolve(node.child<2>());
+  resolve(node.child<3>());
+}
 
 void Resolver::visit(Set &node) {
   resolve(node.child<0>());
 
   // Note, the property is dynamically-evaluated, so no variable is introduced
-  // for name here
+  // for name here. Fields of records have a fixed index though
+  resolve_field(node, node.child<0>(), node.child<1>());
 
   resolve(node.child<2>());
 }
@@ -0,0 +1,353 @@
+#include "scan.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOX_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(LOX_SCAN_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define LOX_SCAN_AVX2
+#include <immintrin.h>
+#define LOX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+//------------------------------Scalar reference-------------------------------
+
+bool is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+bool is_identifier_char(char c) {
+  const char lower = static_cast<char>(c | 0x20);
+  return is_digit(c) || (lower >= 'a' && lower <= 'z');
+}
+
+const char *scalar_skip_whitespace(const char *first, const char *last,
+                                   unsigned int &newlines) {
+  for (; first != last && is_whitespace(*first); ++first) {
+    newlines += *first == '\n' ? 1 : 0;
+  }
+  return first;
+}
+
+const char *scalar_skip_identifier(const char *first, const char *last) {
+  while (first != last && is_identifier_char(*first)) {
+    ++first;
+  }
+  return first;
+}
+
+const char *scalar_skip_digits(const char *first, const char *last) {
+  while (first != last && is_digit(*first)) {
+    ++first;
+  }
+  return first;
+}
+
+const char *scalar_find(const char *first, const char *last, char c,
+                        unsigned int &newlines) {
+  for (; first != last && *first != c; ++first) {
+    newlines += *first == '\n' ? 1 : 0;
+  }
+  return first;
+}
+
+const char *scalar_find_newline(const char *first, const char *last) {
+  while (first != last && *first != '\n') {
+    ++first;
+  }
+  return first;
+}
+
+// Mask of the bits below the first set bit of stop_mask
+constexpr uint32_t bits_before(uint32_t stop_mask) {
+  return (1U << std::countr_zero(stop_mask)) - 1;
+}
+
+//------------------------------SSE2 (16 bytes)--------------------------------
+#ifdef LOX_SCAN_SSE2
+
+__m128i load16(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+uint32_t mask16(__m128i v) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+
+// Signed compares: bytes >= 0x80 are negative and never fall into [lo, hi]
+__m128i in_range16(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+constexpr uint32_t ALL16 = 0xFFFF;
+
+const char *sse2_skip_whitespace(const char *first, const char *last,
+                                 unsigned int &newlines) {
+  for (; last - first >= 16; first += 16) {
+    const auto v = load16(first);
+    const auto nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    const auto ws = _mm_or_si128(
+        _mm_or_si128(nl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    const uint32_t stop = ~mask16(ws) & ALL16;
+    if (stop != 0) {
+      newlines += std::popcount(mask16(nl) & bits_before(stop));
+      return first + std::countr_zero(stop);
+    }
+    newlines += std::popcount(mask16(nl));
+  }
+  return scalar_skip_whitespace(first, last, newlines);
+}
+
+const char *sse2_skip_identifier(const char *first, const char *last) {
+  for (; last - first >= 16; first += 16) {
+    const auto v = load16(first);
+    const auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const auto ident =
+        _mm_or_si128(in_range16(v, '0', '9'), in_range16(lower, 'a', 'z'));
+    const uint32_t stop = ~mask16(ident) & ALL16;
+    if (stop != 0) {
+      return first + std::countr_zero(stop);
+    }
+  }
+  return scalar_skip_identifier(first, last);
+}
+
+const char *sse2_skip_digits(const char *first, const char *last) {
+  for (; last - first >= 16; first += 16) {
+    const uint32_t stop = ~mask16(in_range16(load16(first), '0', '9')) & ALL16;
+    if (stop != 0) {
+      return first + std::countr_zero(stop);
+    }
+  }
+  return scalar_skip_digits(first, last);
+}
+
+const char *sse2_find(const char *first, const char *last, char c,
+                      unsigned int &newlines) {
+  for (; last - first >= 16; first += 16) {
+    const auto v = load16(first);
+    const uint32_t nl = mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    const uint32_t found = mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    if (found != 0) {
+      newlines += std::popcount(nl & bits_before(found));
+      return first + std::countr_zero(found);
+    }
+    newlines += std::popcount(nl);
+  }
+  return scalar_find(first, last, c, newlines);
+}
+
+const char *sse2_find_newline(const char *first, const char *last) {
+  for (; last - first >= 16; first += 16) {
+    const uint32_t found =
+        mask16(_mm_cmpeq_epi8(load16(first), _mm_set1_epi8('\n')));
+    if (found != 0) {
+      return first + std::countr_zero(found);
+    }
+  }
+  return scalar_find_newline(first, last);
+}
+
+#endif // LOX_SCAN_SSE2
+
+//------------------------------AVX2 (32 bytes)--------------------------------
+#ifdef LOX_SCAN_AVX2
+
+LOX_TARGET_AVX2 __m256i load32(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+LOX_TARGET_AVX2 uint32_t mask32(__m256i v) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+
+LOX_TARGET_AVX2 __m256i in_range32(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+LOX_TARGET_AVX2 const char *avx2_skip_whitespace(const char *first,
+                                                 const char *last,
+                                                 unsigned int &newlines) {
+  for (; last - first >= 32; first += 32) {
+    const auto v = load32(first);
+    const auto nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    const auto ws = _mm256_or_si256(
+        _mm256_or_si256(nl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    const uint32_t stop = ~mask32(ws);
+    if (stop != 0) {
+      newlines += std::popcount(mask32(nl) & bits_before(stop));
+      return first + std::countr_zero(stop);
+    }
+    newlines += std::popcount(mask32(nl));
+  }
+  return sse2_skip_whitespace(first, last, newlines);
+}
+
+LOX_TARGET_AVX2 const char *avx2_skip_identifier(const char *first,
+                                                 const char *last) {
+  for (; last - first >= 32; first += 32) {
+    const auto v = load32(first);
+    const auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    const auto ident =
+        _mm256_or_si256(in_range32(v, '0', '9'), in_range32(lower, 'a', 'z'));
+    const uint32_t stop = ~mask32(ident);
+    if (stop != 0) {
+      return first + std::countr_zero(stop);
+    }
+  }
+  return sse2_skip_identifier(first, last);
+}
+
+LOX_TARGET_AVX2 const char *avx2_skip_digits(const char *first,
+                                             const char *last) {
+  for (; last - first >= 32; first += 32) {
+    const uint32_t stop = ~mask32(in_range32(load32(first), '0', '9'));
+    if (stop != 0) {
+      return first + std::countr_zero(stop);
+    }
+  }
+  return sse2_skip_digits(first, last);
+}
+
+LOX_TARGET_AVX2 const char *avx2_find(const char *first, const char *last,
+                                      char c, unsigned int &newlines) {
+  for (; last - first >= 32; first += 32) {
+    const auto v = load32(first);
+    const uint32_t nl = mask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    const uint32_t found = mask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+    if (found != 0) {
+      newlines += std::popcount(nl & bits_before(found));
+      return first + std::countr_zero(found);
+    }
+    newlines += std::popcount(nl);
+  }
+  return sse2_find(first, last, c, newlines);
+}
+
+LOX_TARGET_AVX2 const char *avx2_find_newline(const char *first,
+                                              const char *last) {
+  for (; last - first >= 32; first += 32) {
+    const uint32_t found =
+        mask32(_mm256_cmpeq_epi8(load32(first), _mm256_set1_epi8('\n')));
+    if (found != 0) {
+      return first + std::countr_zero(found);
+    }
+  }
+  return sse2_find_newline(first, last);
+}
+
+#endif // LOX_SCAN_AVX2
+
+//------------------------------Dispatch---------------------------------------
+
+struct Kernels {
+  Scan::Implementation implementation;
+  const char *(*skip_whitespace)(const char *, const char *, unsigned int &);
+  const char *(*skip_identifier)(const char *, const char *);
+  const char *(*skip_digits)(const char *, const char *);
+  const char *(*find)(const char *, const char *, char, unsigned int &);
+  const char *(*find_newline)(const char *, const char *);
+};
+
+constexpr Kernels scalar_kernels{
+    Scan::Implementation::SCALAR, scalar_skip_whitespace,
+    scalar_skip_identifier,       scalar_skip_digits,
+    scalar_find,                  scalar_find_newline};
+
+#ifdef LOX_SCAN_SSE2
+constexpr Kernels sse2_kernels{Scan::Implementation::SSE2, sse2_skip_whitespace,
+                               sse2_skip_identifier,       sse2_skip_digits,
+                               sse2_find,                  sse2_find_newline};
+#endif
+
+#ifdef LOX_SCAN_AVX2
+constexpr Kernels avx2_kernels{Scan::Implementation::AVX2, avx2_skip_whitespace,
+                               avx2_skip_identifier,       avx2_skip_digits,
+                               avx2_find,                  avx2_find_newline};
+#endif
+
+const Kernels *kernels_for(Scan::Implementation implementation) {
+  switch (implementation) {
+  case Scan::Implementation::AVX2:
+#ifdef LOX_SCAN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+      return &avx2_kernels;
+    }
+#endif
+    [[fallthrough]];
+  case Scan::Implementation::SSE2:
+#ifdef LOX_SCAN_SSE2
+    return &sse2_kernels;
+#endif
+    [[fallthrough]];
+  case Scan::Implementation::SCALAR:
+    break;
+  }
+  return &scalar_kernels;
+}
+
+std::atomic<const Kernels *> active{kernels_for(Scan::Implementation::AVX2)};
+
+const Kernels &kernels() { return *active.load(std::memory_order_relaxed); }
+} // namespace
+
+namespace Scan {
+const char *skip_whitespace(const char *first, const char *last,
+                            unsigned int &newlines) {
+  return kernels().skip_whitespace(first, last, newlines);
+}
+
+const char *skip_identifier(const char *first, const char *last) {
+  return kernels().skip_identifier(first, last);
+}
+
+const char *skip_digits(const char *first, const char *last) {
+  return kernels().skip_digits(first, last);
+}
+
+const char *find(const char *first, const char *last, char c,
+                 unsigned int &newlines) {
+  return kernels().find(first, last, c, newlines);
+}
+
+const char *find_newline(const char *first, const char *last) {
+  return kernels().find_newline(first, last);
+}
+
+Implementation best_implementation() {
+  return kernels_for(Implementation::AVX2)->implementation;
+}
+
+Implementation active_implementation() { return kernels().implementation; }
+
+void set_implementation(Implementation implementation) {
+  active.store(kernels_for(implementation), std::memory_order_relaxed);
+}
+
+std::string_view to_string(Implementation implementation) {
+  switch (implementation) {
+  case Implementation::SCALAR:
+    return "scalar";
+  case Implementation::SSE2:
+    return "sse2";
+  case Implementation::AVX2:
+    return "avx2";
+  }
+  return "";
+}
+} // namespace Scan
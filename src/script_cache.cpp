@@ -0,0 +1,131 @@
+#include "script_cache.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+#include "ast_serializer.hpp"
+#include "binary_format.hpp"
+#include "build_id.hpp"
+#include "hash.hpp"
+#include "logging.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char MAGIC[4] = {'L', 'O', 'X', 'C'};
+
+struct EntryHeader {
+  BinaryFormat::FileHeader file;
+  uint64_t source_hash;
+  uint64_t source_size;
+};
+} // namespace
+
+ScriptCache::ScriptCache(fs::path _directory)
+    : directory(std::move(_directory)) {}
+
+std::optional<fs::path> ScriptCache::default_directory() {
+  if (const char *configured = std::getenv("LOX_CACHE_DIR")) {
+    if (*configured == '\0') {
+      return std::nullopt;
+    }
+    return fs::path{configured};
+  }
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg != '\0') {
+    return fs::path{xdg} / "lox";
+  }
+  if (const char *home = std::getenv("HOME"); home && *home != '\0') {
+    return fs::path{home} / ".cache" / "lox";
+  }
+  return std::nullopt;
+}
+
+fs::path ScriptCache::entry_path(std::string_view source) const {
+  const auto key = fnv1a(source, build_id() ^ ast_schema_fingerprint());
+
+  static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for (size_t i = 0; i < name.size(); ++i) {
+    name[name.size() - 1 - i] = HEX_DIGITS[(key >> (4 * i)) & 0xF];
+  }
+  return directory / (name + ".loxc");
+}
+
+CompilationUnitPtr ScriptCache::load(std::string_view source) const {
+  const auto path = entry_path(source);
+  const SourceFile entry{path};
+  if (!entry) {
+    LOG_DEBUG("Script cache miss: ", path);
+    return nullptr;
+  }
+
+  const auto data = entry.contents();
+  EntryHeader header{};
+  if (data.size() < sizeof(header)) {
+    LOG_INFO("Ignoring truncated script cache entry ", path);
+    return nullptr;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  const auto payload = data.substr(sizeof(header));
+
+  if (!BinaryFormat::is_valid(header.file, MAGIC, payload) ||
+      header.source_hash != fnv1a(source) ||
+      header.source_size != source.size()) {
+    LOG_INFO("Ignoring stale or corrupt script cache entry ", path);
+    return nullptr;
+  }
+
+  auto unit = std::make_shared<CompilationUnit>();
+  auto statements = deserialize_ast(payload, unit->arena);
+  if (!statements.has_value()) {
+    LOG_INFO("Ignoring malformed script cache entry ", path);
+    return nullptr;
+  }
+  unit->statements = std::move(*statements);
+
+  LOG_DEBUG("Script cache hit: ", path);
+  return unit;
+}
+
+void ScriptCache::store(std::string_view source,
+                        const CompilationUnit &unit) const {
+  const auto payload = serialize_ast(unit.statements);
+
+  const EntryHeader header{BinaryFormat::file_header(MAGIC, payload),
+                           fnv1a(source), source.size()};
+
+  std::error_code error;
+  fs::create_directories(directory, error);
+  if (error) {
+    LOG_INFO("Can't create script cache directory ", directory, ": ",
+             error.message());
+    return;
+  }
+
+  // Write to a private temporary and rename it into place, so concurrent
+  // runs never see a partially written entry
+  const auto path = entry_path(source);
+  auto temporary = path;
+  temporary += ".tmp" + std::to_string(std::random_device{}());
+  {
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!out) {
+      LOG_INFO("Can't write script cache entry ", temporary);
+      out.close();
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+
+  fs::rename(temporary, path, error);
+  if (error) {
+    LOG_INFO("Can't write script cache entry ", path, ": ", error.message());
+    fs::remove(temporary, error);
+  }
+}
@@ -0,0 +1,272 @@
+#include "script_server.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+
+#include "error.hpp"
+#include "isolate.hpp"
+#include "server_protocol.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define LOX_HAS_UNIX_SOCKETS
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef LOX_HAS_UNIX_SOCKETS
+namespace {
+using ServerProtocol::Reply;
+
+void reply(int fd, Reply kind, std::string_view payload) {
+  ServerProtocol::write_frame(fd, static_cast<uint8_t>(kind), payload);
+}
+
+void reply_exit(int fd, int32_t status) {
+  reply(fd, Reply::EXIT,
+        {reinterpret_cast<const char *>(&status), sizeof(status)});
+}
+
+/// Script output, sent to the client in frames of up to a buffer
+struct SocketBuffer : public std::streambuf {
+  SocketBuffer() { setp(buffer.data(), buffer.data() + buffer.size()); }
+
+  /// Client connection, -1 while not connected or once the client is gone
+  int fd = -1;
+
+protected:
+  int_type overflow(int_type c) override {
+    sync();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    const std::string_view pending{pbase(),
+                                   static_cast<size_t>(pptr() - pbase())};
+    if (fd >= 0 && !pending.empty() &&
+        !ServerProtocol::write_frame(fd, static_cast<uint8_t>(Reply::OUT),
+                                     pending)) {
+      fd = -1; // Output of scripts whose client left is dropped
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return 0;
+  }
+
+private:
+  std::array<char, 4096> buffer{};
+};
+
+/// Reports errors to the client, formatted like CerrHandler
+struct SocketErrorHandler : public ErrorHandler {
+  explicit SocketErrorHandler(std::ostream &_out) : out(_out) {}
+
+  int fd = -1;
+
+private:
+  void report(unsigned int line, std::string_view where,
+              std::string_view message, bool is_error) override {
+    // Output printed before the error arrives first
+    out.flush();
+    if (fd >= 0) {
+      reply(fd, Reply::ERR, format_report(line, where, message, is_error));
+    }
+  }
+
+  std::ostream &out;
+};
+} // namespace
+
+/// An isolate whose output and errors go to a client
+struct ScriptServer::Session {
+  Session(const Options &options, const Logging::Config &logging)
+      : out(&buffer), errors(std::make_shared<SocketErrorHandler>(out)),
+        isolate(Isolate::Options{&out, errors, {logging.level, &out},
+                                 options.mode}) {
+    if (options.prelude.has_value()) {
+      prelude_loaded = isolate.load_prelude(*options.prelude);
+    }
+  }
+
+  void connect(int fd) {
+    buffer.fd = fd;
+    errors->fd = fd;
+  }
+
+  SocketBuffer buffer;
+  std::ostream out;
+  std::shared_ptr<SocketErrorHandler> errors;
+  Isolate isolate;
+  bool prelude_loaded = true;
+};
+
+ScriptServer::ScriptServer(Options _options)
+    : options(std::move(_options)), logging(Logging::config()) {}
+
+ScriptServer::~ScriptServer() = default;
+
+int ScriptServer::serve() {
+  // Writing to a client that left must fail instead of ending the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  auto first = std::make_unique<Session>(options, logging);
+  if (!first->prelude_loaded) {
+    LOG_ERROR("Snapshot ", *options.prelude, " could not be loaded");
+    return 66;
+  }
+  warm.push_back(std::move(first));
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const auto &socket_path = options.socket.native();
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    LOG_ERROR("Socket path ", options.socket, " is too long");
+    return 64;
+  }
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+  // A socket left behind by a previous server is replaced
+  std::error_code error;
+  if (fs::is_socket(options.socket, error)) {
+    fs::remove(options.socket, error);
+  }
+
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || ::fcntl(listener, F_SETFD, FD_CLOEXEC) != 0 ||
+      ::bind(listener, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listener, SOMAXCONN) != 0) {
+    LOG_ERROR("Can't listen on ", options.socket, ": ", std::strerror(errno));
+    return 71;
+  }
+
+  warmer = std::jthread{[this](const std::stop_token &stop) {
+    keep_warm(stop);
+  }};
+
+  while (true) {
+    const int connection = ::accept(listener, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno != EINTR && errno != ECONNABORTED) {
+        LOG_ERROR("Can't accept a client: ", std::strerror(errno));
+      }
+      continue;
+    }
+    ::fcntl(connection, F_SETFD, FD_CLOEXEC);
+    std::thread{[this, connection] { handle(connection); }}.detach();
+  }
+}
+
+std::unique_ptr<ScriptServer::Session> ScriptServer::take_session() {
+  {
+    const std::scoped_lock lock{mutex};
+    if (!warm.empty()) {
+      auto session = std::move(warm.front());
+      warm.pop_front();
+      taken.notify_one();
+      return session;
+    }
+  }
+  return std::make_unique<Session>(options, logging);
+}
+
+void ScriptServer::keep_warm(const std::stop_token &stop) {
+  while (true) {
+    {
+      std::unique_lock lock{mutex};
+      if (!taken.wait(lock, stop, [this] {
+            return warm.size() < options.warm_isolates;
+          })) {
+        return;
+      }
+    }
+    // Warmed without the lock, so requests can take sessions meanwhile
+    auto session = std::make_unique<Session>(options, logging);
+    const std::scoped_lock lock{mutex};
+    warm.push_back(std::move(session));
+  }
+}
+
+void ScriptServer::handle(int connection) {
+  // Nothing may escape the thread of a connection, as std::terminate would end
+  // the server for every client. A request that fails like that, for example
+  // by running out of memory, still gets an exit frame
+  try {
+    if (const auto status = run_request(connection)) {
+      reply_exit(connection, *status);
+    }
+  } catch (...) {
+    try {
+      reply(connection, Reply::ERR, "The server failed to run the script\n");
+      reply_exit(connection, 70);
+    } catch (...) {
+      // The client sees the connection close
+    }
+  }
+  ::close(connection);
+}
+
+std::optional<int32_t> ScriptServer::run_request(int connection) {
+  auto request =
+      ServerProtocol::read_frame(connection, ServerProtocol::MAX_REQUEST_SIZE);
+  if (!request.has_value()) {
+    return std::nullopt;
+  }
+  int32_t status = 0;
+  auto session = take_session();
+  session->connect(connection);
+  auto &[kind, payload] = *request;
+
+  try {
+    switch (static_cast<ServerProtocol::Request>(kind)) {
+    case ServerProtocol::Request::PATH:
+      if (std::error_code error; !fs::is_regular_file(payload, error)) {
+        reply(connection, Reply::ERR,
+              "File " + payload + " could not be opened\n");
+        status = 42;
+      } else {
+        session->isolate.run_cached(payload);
+      }
+      break;
+    case ServerProtocol::Request::SOURCE:
+      session->isolate.run(payload);
+      break;
+    default:
+      reply(connection, Reply::ERR, "Unknown request\n");
+      status = 64;
+    }
+  } catch (const std::exception &e) {
+    session->errors->runtime_error(0, e.what());
+  }
+
+  session->out.flush();
+  if (status == 0 && session->errors->has_error()) {
+    status = 65;
+  } else if (status == 0 && session->errors->has_runtime_error()) {
+    status = 70;
+  }
+  return status;
+}
+#else
+struct ScriptServer::Session {};
+
+ScriptServer::ScriptServer(Options _options)
+    : options(std::move(_options)), logging(Logging::config()) {}
+
+ScriptServer::~ScriptServer() = default;
+
+int ScriptServer::serve() {
+  LOG_ERROR("--serve needs Unix domain sockets, which this platform lacks");
+  return 69;
+}
+#endif
@@ -0,0 +1,77 @@
+#include "server_protocol.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#else
+#include <io.h>
+#define read _read
+#define write _write
+#endif
+
+namespace {
+constexpr size_t HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+
+bool write_all(int fd, std::string_view bytes) {
+  while (!bytes.empty()) {
+    const auto written = ::write(fd, bytes.data(), bytes.size());
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes.remove_prefix(static_cast<size_t>(written));
+  }
+  return true;
+}
+
+bool read_all(int fd, char *bytes, size_t size) {
+  while (size > 0) {
+    const auto received = ::read(fd, bytes, size);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= static_cast<size_t>(received);
+  }
+  return true;
+}
+} // namespace
+
+namespace ServerProtocol {
+bool write_frame(int fd, uint8_t kind, std::string_view payload) {
+  // One write per frame for small frames
+  std::string frame;
+  frame.reserve(HEADER_SIZE + payload.size());
+  frame.push_back(static_cast<char>(kind));
+  const auto size = static_cast<uint32_t>(payload.size());
+  frame.append(reinterpret_cast<const char *>(&size), sizeof(size));
+  frame.append(payload);
+  return write_all(fd, frame);
+}
+
+std::optional<std::pair<uint8_t, std::string>> read_frame(int fd,
+                                                          uint32_t max_size) {
+  char header[HEADER_SIZE];
+  if (!read_all(fd, header, HEADER_SIZE)) {
+    return std::nullopt;
+  }
+  uint32_t size = 0;
+  std::memcpy(&size, header + sizeof(uint8_t), sizeof(size));
+  if (size > max_size) {
+    return std::nullopt;
+  }
+
+  std::string payload(size, '\0');
+  if (!read_all(fd, payload.data(), size)) {
+    return std::nullopt;
+  }
+  return std::pair{static_cast<uint8_t>(header[0]), std::move(payload)};
+}
+} // namespace ServerProtocol
@@ -0,0 +1,622 @@
+#include "snapshot.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_serializer.hpp"
+#include "binary_format.hpp"
+#include "class.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "instance.hpp"
+#include "interpreter.hpp"
+#include "logging.hpp"
+#include "module.hpp"
+#include "source_file.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+using BinaryFormat::put;
+using BinaryFormat::put_string;
+
+constexpr char MAGIC[4] = {'L', 'O', 'X', 'S'};
+
+// Id of a missing object, like the superclass of a base class
+constexpr uint32_t NO_OBJECT = UINT32_MAX;
+
+enum class ValueTag : uint8_t { NUMBER, STRING, NIL, BOOL, BUILTIN, OBJECT };
+
+// Objects are stored so that everything an object is constructed from comes
+// before it. Variables of environments and fields of instances can form
+// cycles, so they are stored after all objects
+enum class ObjectKind : uint8_t {
+  BUILTINS,
+  GLOBALS,
+  ENVIRONMENT,
+  FUNCTION,
+  CLASS,
+  INSTANCE,
+  MODULE,
+};
+} // namespace
+
+/// Encodes everything reachable from the globals of an interpreter.
+/// Payload layout: units, objects, then contents of environments and instances
+struct SnapshotWriter {
+  explicit SnapshotWriter(const Interpreter &_interpreter)
+      : interpreter(_interpreter) {
+    for (const auto &[name, value] : interpreter.builtins->variables) {
+      if (const auto *builtin = std::get_if<CallablePtr>(&value)) {
+        builtin_names.emplace(builtin->get(), name);
+      }
+    }
+  }
+
+  std::string write() {
+    std::string contents;
+    object(interpreter.globals.get());
+
+    // Writing contents discovers more objects with contents
+    for (size_t i = 0; i < containers.size(); ++i) {
+      if (const auto *environment = std::get_if<const Environment *>(
+              &containers[i])) {
+        write_contents(contents, *environment, (*environment)->variables);
+      } else {
+        write_contents(contents, *std::get<const Instance *>(containers[i]));
+      }
+    }
+
+    std::string payload;
+    put(payload, static_cast<uint32_t>(units.size()));
+    for (const auto &unit : units) {
+      payload += unit;
+    }
+    put(payload, object_count);
+    payload += objects;
+    put(payload, static_cast<uint32_t>(containers.size()));
+    payload += contents;
+    return payload;
+  }
+
+private:
+  const Interpreter &interpreter;
+  std::unordered_map<const Callable *, std::string> builtin_names;
+
+  std::unordered_map<const void *, uint32_t> ids;
+  uint32_t object_count = 0;
+  std::string objects;
+
+  /// Environments and instances in the order their contents are written
+  std::vector<std::variant<const Environment *, const Instance *>> containers;
+
+  std::unordered_map<const CompilationUnit *, uint32_t> unit_ids;
+  std::vector<std::string> units;
+  /// Index of each function declaration in the AST of its unit, by unit id
+  std::vector<std::unordered_map<const void *, uint32_t>> ordinals;
+
+  uint32_t add(const void *address, ObjectKind kind, std::string_view record) {
+    put(objects, kind);
+    objects += record;
+    ids.emplace(address, object_count);
+    return object_count++;
+  }
+
+  [[nodiscard]] std::optional<uint32_t> id(const void *address) const {
+    const auto found = ids.find(address);
+    if (found == ids.end()) {
+      return std::nullopt;
+    }
+    return found->second;
+  }
+
+  uint32_t unit(const CompilationUnit &compiled) {
+    if (const auto found = unit_ids.find(&compiled); found != unit_ids.end()) {
+      return found->second;
+    }
+    if (compiled.mode == ParseMode::LAZY) {
+      throw RuntimeError("Can't snapshot functions of lazily parsed code, "
+                         "run it with --eager");
+    }
+
+    FunctionDeclarations functions;
+    std::string encoded;
+    put_string(encoded, compiled.path.string());
+    put_string(encoded, serialize_ast(compiled.statements, functions));
+    units.push_back(std::move(encoded));
+
+    auto &unit_ordinals = ordinals.emplace_back();
+    for (uint32_t i = 0; i < functions.size(); ++i) {
+      unit_ordinals.emplace(
+          std::visit([](auto *decl) -> const void * { return decl; },
+                     functions[i]),
+          i);
+    }
+    const auto unit_id = static_cast<uint32_t>(units.size() - 1);
+    unit_ids.emplace(&compiled, unit_id);
+    return unit_id;
+  }
+
+  uint32_t object(const Environment *environment) {
+    if (environment == nullptr) {
+      return NO_OBJECT;
+    }
+    if (const auto existing = id(environment)) {
+      return *existing;
+    }
+    if (environment == interpreter.builtins.get()) {
+      return add(environment, ObjectKind::BUILTINS, {});
+    }
+
+    containers.emplace_back(environment);
+    if (environment == interpreter.globals.get()) {
+      return add(environment, ObjectKind::GLOBALS, {});
+    }
+    std::string record;
+    put(record, object(environment->enclosing.get()));
+    return add(environment, ObjectKind::ENVIRONMENT, record);
+  }
+
+  uint32_t object(const Function &function) {
+    if (const auto existing = id(&function)) {
+      return *existing;
+    }
+    if (function.unit == nullptr) {
+      throw RuntimeError("Can't snapshot " + function.to_string() +
+                         ", its code isn't owned by a compilation unit");
+    }
+
+    const auto unit_id = unit(*function.unit);
+    const auto found = ordinals[unit_id].find(std::visit(
+        [](auto *decl) -> const void * { return decl; }, function.declaration));
+    if (found == ordinals[unit_id].end()) {
+      throw RuntimeError("Can't snapshot " + function.to_string() +
+                         ", its declaration isn't part of its unit");
+    }
+
+    std::string record;
+    put(record, unit_id);
+    put(record, found->second);
+    put(record, static_cast<uint8_t>(function.kind));
+    put(record, object(function.closure.get()));
+    put(record, object(function.globals));
+    return add(&function, ObjectKind::FUNCTION, record);
+  }
+
+  uint32_t object(const Class &klass) {
+    if (const auto existing = id(&klass)) {
+      return *existing;
+    }
+
+    std::string record;
+    put(record, klass.superclass != nullptr ? object(*klass.superclass)
+                                            : NO_OBJECT);
+    put_string(record, klass.name());
+    for (const auto *functions : {&klass.methods, &klass.unbounds,
+                                  &klass.getters}) {
+      put(record, static_cast<uint32_t>(functions->size()));
+      for (const auto &[name, function] : *functions) {
+        put_string(record, name);
+        put(record, object(*function));
+      }
+    }
+    // Subclasses of records get their fields from the superclass
+    const auto field_count =
+        klass.superclass == nullptr ? klass.fields().size() : 0;
+    put(record, static_cast<uint32_t>(field_count));
+    for (size_t i = 0; i < field_count; ++i) {
+      put_string(record, klass.fields()[i]);
+    }
+    return add(&klass, ObjectKind::CLASS, record);
+  }
+
+  uint32_t object(const Instance &instance) {
+    if (const auto existing = id(&instance)) {
+      return *existing;
+    }
+
+    containers.emplace_back(&instance);
+    std::string record;
+    put(record, object(*instance.klass));
+    return add(&instance, ObjectKind::INSTANCE, record);
+  }
+
+  uint32_t object(const Module &module) {
+    if (const auto existing = id(&module)) {
+      return *existing;
+    }
+
+    std::string record;
+    put_string(record, module.name);
+    put(record, unit(*module.unit));
+    put(record, object(module.globals.get()));
+    return add(&module, ObjectKind::MODULE, record);
+  }
+
+  void write_contents(std::string &out, const void *container,
+                      const std::unordered_map<std::string, Token::Value> &
+                          variables) {
+    put(out, ids.at(container));
+    put(out, static_cast<uint32_t>(variables.size()));
+    for (const auto &[name, value] : variables) {
+      put_string(out, name);
+      write_value(out, value);
+    }
+  }
+
+  void write_contents(std::string &out, const Instance &instance) {
+    put(out, ids.at(&instance));
+    uint32_t count = 0;
+    instance.for_each_field(
+        [&count](const std::string &, const Token::Value &) { ++count; });
+    put(out, count);
+    instance.for_each_field(
+        [this, &out](const std::string &name, const Token::Value &value) {
+          put_string(out, name);
+          write_value(out, value);
+        });
+  }
+
+  void write_value(std::string &out, const Token::Value &value) {
+    if (const auto *number = std::get_if<double>(&value)) {
+      put(out, ValueTag::NUMBER);
+      put(out, *number);
+    } else if (const auto *string = std::get_if<std::string>(&value)) {
+      put(out, ValueTag::STRING);
+      put_string(out, *string);
+    } else if (std::holds_alternative<NullType>(value)) {
+      put(out, ValueTag::NIL);
+    } else if (const auto *boolean = std::get_if<bool>(&value)) {
+      put(out, ValueTag::BOOL);
+      put(out, static_cast<uint8_t>(*boolean));
+    } else if (const auto *callable = std::get_if<CallablePtr>(&value)) {
+      write_callable(out, *callable);
+    } else if (const auto *instance = std::get_if<InstancePtr>(&value)) {
+      const auto instance_id = object(**instance);
+      put(out, ValueTag::OBJECT);
+      put(out, instance_id);
+    } else {
+      const auto &native = std::get<ObjectPtr>(value);
+      const auto *module = dynamic_cast<const Module *>(native.get());
+      if (module == nullptr) {
+        throw RuntimeError("Can't snapshot " + native->to_string());
+      }
+      const auto module_id = object(*module);
+      put(out, ValueTag::OBJECT);
+      put(out, module_id);
+    }
+  }
+
+  void write_callable(std::string &out, const CallablePtr &callable) {
+    if (const auto found = builtin_names.find(callable.get());
+        found != builtin_names.end()) {
+      put(out, ValueTag::BUILTIN);
+      put_string(out, found->second);
+      return;
+    }
+
+    uint32_t callable_id = 0;
+    if (const auto *function = dynamic_cast<const Function *>(callable.get())) {
+      callable_id = object(*function);
+    } else if (const auto *klass = dynamic_cast<const Class *>(callable.get())) {
+      callable_id = object(*klass);
+    } else {
+      throw RuntimeError("Can't snapshot " + callable->to_string());
+    }
+    put(out, ValueTag::OBJECT);
+    put(out, callable_id);
+  }
+};
+
+/// Decodes a payload written by SnapshotWriter into an interpreter
+struct SnapshotReader {
+  SnapshotReader(std::string_view _data, Interpreter &_interpreter)
+      : data(_data), interpreter(_interpreter) {}
+
+  /// Returns false if the payload is truncated or malformed. The globals are
+  /// only changed on success
+  bool read() {
+    try {
+      read_units();
+      read_objects();
+      read_contents();
+    } catch (const CorruptData &) {
+      return false;
+    } catch (const std::out_of_range &) { // Id or index out of bounds
+      return false;
+    }
+    if (position != data.size()) {
+      return false;
+    }
+
+    for (auto &[name, value] : globals) {
+      interpreter.globals->variables.insert_or_assign(name, std::move(value));
+    }
+    return true;
+  }
+
+private:
+  std::string_view data;
+  size_t position = 0;
+  Interpreter &interpreter;
+
+  // Thrown on truncated or malformed data
+  struct CorruptData {};
+
+  std::vector<CompilationUnitPtr> units;
+  std::vector<FunctionDeclarations> functions;
+
+  /// Objects by id. Environments are only in environments, other objects are
+  /// only in values
+  std::vector<std::shared_ptr<Environment>> environments;
+  std::vector<Token::Value> values;
+
+  /// Variables of the global scope, defined once everything is read
+  std::unordered_map<std::string, Token::Value> globals;
+
+  template <typename T> T get() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (data.size() - position < sizeof(T)) {
+      throw CorruptData{};
+    }
+    T value;
+    std::memcpy(&value, data.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  std::string_view get_string() {
+    const auto size = get<uint32_t>();
+    if (size > data.size() - position) {
+      throw CorruptData{};
+    }
+    const auto string = data.substr(position, size);
+    position += size;
+    return string;
+  }
+
+  template <typename T> static T checked(T value) {
+    if (value == nullptr) {
+      throw CorruptData{};
+    }
+    return value;
+  }
+
+  std::shared_ptr<Environment> environment(uint32_t id) const {
+    if (id == NO_OBJECT) {
+      return nullptr;
+    }
+    return checked(environments.at(id));
+  }
+
+  template <typename T> std::shared_ptr<T> object(uint32_t id) const {
+    if (const auto *callable = std::get_if<CallablePtr>(&values.at(id))) {
+      return checked(std::dynamic_pointer_cast<T>(*callable));
+    }
+    throw CorruptData{};
+  }
+
+  void read_units() {
+    const auto count = get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+      auto unit = std::make_shared<CompilationUnit>();
+      unit->path = get_string();
+      auto statements =
+          deserialize_ast(get_string(), unit->arena, functions.emplace_back());
+      if (!statements.has_value()) {
+        throw CorruptData{};
+      }
+      unit->statements = std::move(*statements);
+      units.push_back(std::move(unit));
+    }
+  }
+
+  void read_objects() {
+    const auto count = get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+      std::shared_ptr<Environment> environment;
+      Token::Value value;
+      switch (get<ObjectKind>()) {
+      case ObjectKind::BUILTINS:
+        environment = interpreter.builtins;
+        break;
+      case ObjectKind::GLOBALS:
+        environment = interpreter.globals;
+        break;
+      case ObjectKind::ENVIRONMENT:
+        environment =
+            std::make_shared<Environment>(this->environment(get<uint32_t>()));
+        break;
+      case ObjectKind::FUNCTION:
+        value = CallablePtr{read_function()};
+        break;
+      case ObjectKind::CLASS:
+        value = CallablePtr{read_class()};
+        break;
+      case ObjectKind::INSTANCE:
+        value = make_instance(object<Class>(get<uint32_t>()));
+        break;
+      case ObjectKind::MODULE:
+        value = ObjectPtr{read_module()};
+        break;
+      default:
+        throw CorruptData{};
+      }
+      environments.push_back(std::move(environment));
+      values.push_back(std::move(value));
+    }
+  }
+
+  FunctionPtr read_function() {
+    const auto unit_id = get<uint32_t>();
+    const auto ordinal = get<uint32_t>();
+    const auto kind = get<uint8_t>();
+    if (kind > static_cast<uint8_t>(FunctionKind::GETTER)) {
+      throw CorruptData{};
+    }
+    auto closure = environment(get<uint32_t>());
+    const auto globals_env = environment(get<uint32_t>());
+    return std::make_shared<Function>(
+        functions.at(unit_id).at(ordinal), std::move(closure),
+        static_cast<FunctionKind>(kind), units.at(unit_id), globals_env.get());
+  }
+
+  ClassPtr read_class() {
+    const auto superclass_id = get<uint32_t>();
+    auto superclass =
+        superclass_id != NO_OBJECT ? object<Class>(superclass_id) : nullptr;
+    std::string name{get_string()};
+
+    Class::ClassFunctions class_functions;
+    std::apply(
+        [this](auto &...maps) {
+          const auto read_map = [this](Class::FunctionMap &map) {
+            const auto count = get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) {
+              std::string function_name{get_string()};
+              map.emplace(std::move(function_name),
+                          object<Function>(get<uint32_t>()));
+            }
+          };
+          (read_map(maps), ...);
+        },
+        class_functions);
+    std::vector<std::string> fields;
+    const auto field_count = get<uint32_t>();
+    for (uint32_t i = 0; i < field_count; ++i) {
+      fields.emplace_back(get_string());
+    }
+    return std::make_shared<Class>(std::move(name), std::move(superclass),
+                                   std::move(class_functions),
+                                   std::move(fields));
+  }
+
+  std::shared_ptr<Module> read_module() {
+    std::string name{get_string()};
+    const auto unit_id = get<uint32_t>();
+    auto module = std::make_shared<Module>(std::move(name), units.at(unit_id),
+                                           environment(get<uint32_t>()));
+    return module;
+  }
+
+  void read_contents() {
+    const auto count = get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+      const auto id = get<uint32_t>();
+      const auto *instance = std::get_if<InstancePtr>(&values.at(id));
+      auto *variables = instance == nullptr ? &this->variables(id) : nullptr;
+      const auto size = get<uint32_t>();
+      for (uint32_t j = 0; j < size; ++j) {
+        std::string name{get_string()};
+        if (instance != nullptr) {
+          (*instance)->restore_field(name, read_value());
+        } else {
+          variables->insert_or_assign(std::move(name), read_value());
+        }
+      }
+    }
+  }
+
+  std::unordered_map<std::string, Token::Value> &variables(uint32_t id) {
+    if (environments.at(id) == interpreter.globals) {
+      return globals;
+    }
+    if (environments[id] != nullptr) {
+      return environments[id]->variables;
+    }
+    throw CorruptData{};
+  }
+
+  Token::Value read_value() {
+    switch (get<ValueTag>()) {
+    case ValueTag::NUMBER:
+      return get<double>();
+    case ValueTag::STRING:
+      return std::string{get_string()};
+    case ValueTag::NIL:
+      return NullType{};
+    case ValueTag::BOOL:
+      return get<uint8_t>() != 0;
+    case ValueTag::BUILTIN: {
+      const auto found =
+          interpreter.builtins->variables.find(std::string{get_string()});
+      if (found == interpreter.builtins->variables.end()) {
+        throw CorruptData{};
+      }
+      return found->second;
+    }
+    case ValueTag::OBJECT: {
+      const auto id = get<uint32_t>();
+      if (environments.at(id) != nullptr) {
+        throw CorruptData{};
+      }
+      return values[id];
+    }
+    }
+    throw CorruptData{};
+  }
+};
+
+bool save_snapshot(const Interpreter &interpreter, const fs::path &path) {
+  const auto payload = SnapshotWriter{interpreter}.write();
+
+  const auto header = BinaryFormat::file_header(MAGIC, payload);
+
+  // Write to a private temporary and rename it into place, so interpreters
+  // starting meanwhile never see a partially written image
+  auto temporary = path;
+  temporary += ".tmp" + std::to_string(std::random_device{}());
+  std::error_code error;
+  {
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!out) {
+      LOG_ERROR("Can't write snapshot ", temporary);
+      out.close();
+      fs::remove(temporary, error);
+      return false;
+    }
+  }
+
+  fs::rename(temporary, path, error);
+  if (error) {
+    LOG_ERROR("Can't write snapshot ", path, ": ", error.message());
+    fs::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+bool load_snapshot(Interpreter &interpreter, const fs::path &path) {
+  const SourceFile image{path};
+  if (!image) {
+    LOG_INFO("Can't read snapshot ", path);
+    return false;
+  }
+
+  const auto data = image.contents();
+  BinaryFormat::FileHeader header{};
+  if (data.size() < sizeof(header)) {
+    LOG_INFO("Truncated snapshot ", path);
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  const auto payload = data.substr(sizeof(header));
+
+  if (!BinaryFormat::is_valid(header, MAGIC, payload)) {
+    LOG_INFO("Snapshot ", path, " is corrupt or from another build");
+    return false;
+  }
+
+  if (!SnapshotReader{payload, interpreter}.read()) {
+    LOG_INFO("Malformed snapshot ", path);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,121 @@
+#include "source_file.hpp"
+
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceFile::SourceFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+  std::stringstream ss;
+  if (path == "-") {
+    ss << std::cin.rdbuf();
+    open = true;
+  } else {
+    std::ifstream ifs{path, std::ios::binary};
+    ss << ifs.rdbuf();
+    open = static_cast<bool>(ifs);
+  }
+  buffer = ss.str();
+#else
+  if (path == "-") {
+    read_from(STDIN_FILENO);
+    return;
+  }
+
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat info {};
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size),
+                          PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      ::madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+      mapping = static_cast<const char *>(mapped);
+      mapping_size = static_cast<size_t>(info.st_size);
+      open = true;
+    }
+  }
+
+  if (!open) { // Empty files, pipes, devices or a failed mmap
+    read_from(fd);
+  }
+  ::close(fd);
+#endif
+}
+
+void SourceFile::read_from([[maybe_unused]] int fd) {
+#ifndef _WIN32
+  constexpr size_t CHUNK_SIZE = 64 * 1024;
+  size_t size = 0;
+  while (true) {
+    buffer.resize(size + CHUNK_SIZE);
+    const auto count = ::read(fd, buffer.data() + size, CHUNK_SIZE);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      buffer.clear();
+      return;
+    }
+    if (count == 0) {
+      break;
+    }
+    size += static_cast<size_t>(count);
+  }
+  buffer.resize(size);
+  open = true;
+#endif
+}
+
+SourceFile::SourceFile(SourceFile &&other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0)),
+      buffer(std::move(other.buffer)), open(std::exchange(other.open, false)) {}
+
+SourceFile &SourceFile::operator=(SourceFile &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    mapping = std::exchange(other.mapping, nullptr);
+    mapping_size = std::exchange(other.mapping_size, 0);
+    buffer = std::move(other.buffer);
+    open = std::exchange(other.open, false);
+  }
+  return *this;
+}
+
+SourceFile::~SourceFile() { unmap(); }
+
+void SourceFile::unmap() {
+#ifndef _WIN32
+  if (mapping != nullptr) {
+    ::munmap(const_cast<char *>(mapping), mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+  }
+#endif
+}
+
+bool SourceFile::is_open() const { return open; }
+
+SourceFile::operator bool() const { return is_open(); }
+
+std::string_view SourceFile::contents() const {
+  if (mapping != nullptr) {
+    return {mapping, mapping_size};
+  }
+  return buffer;
+}
+
+bool SourceFile::is_mapped() const { return mapping != nullptr; }
@@ -26,12 +26,23 @@ std::ostream &operator<<(std::ostream &os, FunctionKind kind) {
   return os << str(kind);
 }
 
+std::ostream &operator<<(std::ostream &os, const DeferredBody *rhs) {
+  if (rhs == nullptr) {
+    return os << "nullptr";
+  }
+  return os << "<deferred body, tokens " << rhs->open << "-" << rhs->close
+            << (rhs->materialized ? ", materialized>" : ">");
+}
+
 std::ostream &operator<<(std::ostream &os, const Statement &rhs) {
   rhs.print(os);
   return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const stmt &rhs) {
+std::ostream &operator<<(std::ostream &os, const Statement *rhs) {
+  if (rhs == nullptr) {
+    return os << "nullptr";
+  }
   rhs->print(os);
   return os;
 }
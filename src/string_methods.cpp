@@ -0,0 +1,131 @@
+#include "string_methods.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+#include "array.hpp"
+#include "error.hpp"
+#include "object.hpp"
+
+namespace {
+using Arguments = std::vector<Token::Value>;
+
+const std::string &string_argument(const Token::Value &argument,
+                                   const Token &name) {
+  const auto *string = std::get_if<std::string>(&argument);
+  if (string == nullptr) {
+    throw RuntimeError(name, "Expected a string, got " + stringify(argument));
+  }
+  return *string;
+}
+
+Token::Value position(size_t found) {
+  return found == std::string_view::npos ? -1.0 : static_cast<double>(found);
+}
+
+/// Parts of string between separators. A single character separator is
+/// searched with memchr
+std::vector<Token::Value> split(std::string_view string,
+                                std::string_view separator) {
+  std::vector<Token::Value> parts;
+  if (separator.empty()) {
+    parts.reserve(string.size());
+    for (const char c : string) {
+      parts.emplace_back(std::string(1, c));
+    }
+    return parts;
+  }
+
+  while (true) {
+    size_t found = std::string_view::npos;
+    if (separator.size() == 1) {
+      const auto *match = static_cast<const char *>(
+          std::memchr(string.data(), separator.front(), string.size()));
+      if (match != nullptr) {
+        found = static_cast<size_t>(match - string.data());
+      }
+    } else {
+      found = string.find(separator);
+    }
+    if (found == std::string_view::npos) {
+      parts.emplace_back(std::string{string});
+      return parts;
+    }
+    parts.emplace_back(std::string{string.substr(0, found)});
+    string.remove_prefix(found + separator.size());
+  }
+}
+
+Token::Value index_of(const std::string &self, const Token &name,
+                      const Arguments &arguments) {
+  return position(self.find(string_argument(arguments[0], name)));
+}
+
+Token::Value last_index_of(const std::string &self, const Token &name,
+                           const Arguments &arguments) {
+  return position(self.rfind(string_argument(arguments[0], name)));
+}
+
+Token::Value split_by(const std::string &self, const Token &name,
+                      const Arguments &arguments) {
+  return ObjectPtr{std::make_shared<Array>(
+      split(self, string_argument(arguments[0], name)))};
+}
+
+Token::Value char_code_at(const std::string &self, const Token &name,
+                          const Arguments &arguments) {
+  const auto *index = std::get_if<double>(&arguments[0]);
+  if (index == nullptr || std::trunc(*index) != *index || *index < 0 ||
+      *index >= static_cast<double>(self.size())) {
+    throw RuntimeError(name, "Expected an index below " +
+                                 std::to_string(self.size()) + ", got " +
+                                 stringify(arguments[0]));
+  }
+  const auto byte =
+      static_cast<unsigned char>(self[static_cast<size_t>(*index)]);
+  return static_cast<double>(byte);
+}
+
+struct Method {
+  std::string_view name;
+  size_t arity;
+  Token::Value (*body)(const std::string &self, const Token &name,
+                       const Arguments &arguments);
+};
+
+constexpr std::array METHODS{
+    Method{"indexOf", 1, index_of}, Method{"lastIndexOf", 1, last_index_of},
+    Method{"split", 1, split_by}, Method{"charCodeAt", 1, char_code_at}};
+
+const Method &find_method(const Token &name) {
+  for (const auto &method : METHODS) {
+    if (method.name == name.lexeme) {
+      return method;
+    }
+  }
+  throw RuntimeError(name, "Undefined string method '" + name.lexeme + "'");
+}
+} // namespace
+
+Token::Value string_method(std::string string, const Token &name) {
+  // Method values evaluate the string into a temporary, which the method
+  // takes over instead of copying it again
+  const auto &method = find_method(name);
+  return CallablePtr{std::make_shared<NativeMethod>(
+      name.lexeme, method.arity,
+      [string = std::move(string), name,
+       body = method.body](Interpreter &, const Arguments &arguments) {
+        return body(string, name, arguments);
+      })};
+}
+
+size_t string_method_arity(const Token &name) {
+  return find_method(name).arity;
+}
+
+Token::Value call_string_method(const std::string &string, const Token &name,
+                                const std::vector<Token::Value> &arguments) {
+  return find_method(name).body(string, name, arguments);
+}
@@ -0,0 +1,75 @@
+#include "task.hpp"
+
+#include "interpreter.hpp"
+#include "thread_pool.hpp"
+#include "value_copier.hpp"
+
+std::shared_ptr<Future> Future::spawn(Interpreter &interpreter,
+                                      const CallablePtr &callable) {
+  auto future = std::make_shared<Future>();
+  future->diagnostics = std::make_shared<BufferedErrorHandler>();
+  future->interpreter =
+      std::make_shared<Interpreter>(future->output, future->diagnostics);
+  future->interpreter->interpreter_path = interpreter.interpreter_path;
+  future->interpreter->runs_event_loop = false;
+
+  // Copied on this thread, which owns the heap of the callable
+  auto task_callable = std::get<CallablePtr>(
+      ValueCopier{interpreter, *future->interpreter,
+                  ValueCopier::GlobalScope::COPY}
+          .copy(Token::Value{callable}));
+
+  ThreadPool::instance().submit(
+      [future, task_callable = std::move(task_callable)] {
+        future->run(task_callable);
+      });
+  return future;
+}
+
+void Future::run(const CallablePtr &callable) {
+  try {
+    result = callable->call(*interpreter, {});
+  } catch (const RuntimeError &e) {
+    error = e.what();
+  } catch (const Exit &) {
+    error = "exit() called in a spawned task";
+  } catch (const std::exception &e) {
+    error = e.what();
+  }
+
+  finished = true;
+  ThreadPool::instance().notify();
+}
+
+Token::Value Future::await(Interpreter &caller) {
+  ThreadPool::instance().wait_until([this] { return finished.load(); });
+
+  if (!reported.exchange(true)) {
+    caller.out_stream << output.str();
+    diagnostics->replay(*caller.err_handler, "In spawned task: ");
+  }
+  if (error.has_value()) {
+    throw RuntimeError("Spawned task failed: " + *error);
+  }
+  return ValueCopier{*interpreter, caller, ValueCopier::GlobalScope::MAP}.copy(
+      result);
+}
+
+std::string Future::to_string() const {
+  return finished ? "<Future done>" : "<Future pending>";
+}
+
+Token::Value Future::get(const Token &name, Interpreter &interpreter) {
+  if (name.lexeme == "get") {
+    return CallablePtr{std::make_shared<NativeMethod>(
+        "get", 0, [future = shared_from_this()](Interpreter &caller, auto &) {
+          return future->await(caller);
+        })};
+  }
+  if (name.lexeme == "done") {
+    return finished.load();
+  }
+  return Object::get(name, interpreter);
+}
+
+bool Future::is_shareable() const { return true; }
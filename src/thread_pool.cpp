@@ -0,0 +1,185 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "logging.hpp"
+
+namespace {
+// The pool and worker index of the calling thread, if it is a worker
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+} // namespace
+
+ThreadPool &ThreadPool::instance() {
+  static ThreadPool pool{[] {
+    if (const char *configured = std::getenv("LOX_THREADS")) {
+      if (const auto threads = std::strtoul(configured, nullptr, 10)) {
+        return static_cast<size_t>(threads);
+      }
+    }
+    return static_cast<size_t>(
+        std::max(1U, std::thread::hardware_concurrency()));
+  }()};
+  return pool;
+}
+
+ThreadPool::ThreadPool(size_t worker_count) {
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    threads.emplace_back(
+        [this, i](const std::stop_token &stop) { run_worker(stop, i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  decltype(spares) stopped_spares;
+  {
+    const std::scoped_lock lock{sleep_mutex};
+    stopping = true;
+    stopped_spares = std::move(spares);
+  }
+  wake.notify_all();
+  for (auto &[thread, retired] : stopped_spares) {
+    thread.request_stop();
+  }
+  stopped_spares.clear();
+
+  for (auto &thread : threads) {
+    thread.request_stop();
+  }
+  threads.clear(); // Joins, before the queues are torn down
+}
+
+size_t ThreadPool::size() const { return workers.size(); }
+
+void ThreadPool::submit(Task task) {
+  // Tasks log like the thread that submitted them, not with the defaults of
+  // the worker that runs them
+  task = [task = std::move(task), logging = Logging::config()]() mutable {
+    const Logging::ScopedConfig scoped_logging{logging};
+    task();
+  };
+  const auto index = current_pool == this && current_index < workers.size()
+                         ? current_index
+                         : next_worker.fetch_add(1) % workers.size();
+  {
+    const std::scoped_lock lock{workers[index]->mutex};
+    workers[index]->tasks.push_back(std::move(task));
+  }
+  ++queued;
+
+  // Taking the lock orders this with sleepers checking queued
+  { const std::scoped_lock lock{sleep_mutex}; }
+  wake.notify_one();
+}
+
+void ThreadPool::notify() {
+  { const std::scoped_lock lock{sleep_mutex}; }
+  wake.notify_all();
+}
+
+std::optional<ThreadPool::Task> ThreadPool::take(size_t index) {
+  if (queued == 0) {
+    return std::nullopt;
+  }
+
+  if (index < workers.size()) {
+    auto &own = *workers[index];
+    const std::scoped_lock lock{own.mutex};
+    if (!own.tasks.empty()) {
+      auto task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued;
+      return task;
+    }
+  }
+
+  for (size_t i = 1; i <= workers.size(); ++i) {
+    auto &victim = *workers[(index + i) % workers.size()];
+    const std::scoped_lock lock{victim.mutex};
+    if (!victim.tasks.empty()) {
+      auto task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued;
+      return task;
+    }
+  }
+  return std::nullopt;
+}
+
+void ThreadPool::run_worker(const std::stop_token &stop, size_t index) {
+  current_pool = this;
+  current_index = index;
+
+  while (!stop.stop_requested()) {
+    if (auto task = take(index)) {
+      (*task)();
+      continue;
+    }
+    std::unique_lock lock{sleep_mutex};
+    wake.wait(lock, stop, [this] { return queued > 0; });
+  }
+}
+
+void ThreadPool::wait_until(const std::function<bool()> &done) {
+  const auto index = current_pool == this ? current_index : workers.size();
+
+  while (!done()) {
+    if (auto task = take(index)) {
+      (*task)();
+      continue;
+    }
+    std::unique_lock lock{sleep_mutex};
+    wake.wait(lock, [this, &done] { return queued > 0 || done(); });
+  }
+}
+
+void ThreadPool::run_spare(const std::stop_token &stop, bool &retired) {
+  current_pool = this;
+  current_index = workers.size();
+
+  while (!stop.stop_requested()) {
+    if (auto task = take(current_index)) {
+      (*task)();
+      continue;
+    }
+    std::unique_lock lock{sleep_mutex};
+    if (spare_count > blocked) {
+      --spare_count;
+      retired = true;
+      return;
+    }
+    wake.wait(lock, stop,
+              [this] { return queued > 0 || spare_count > blocked; });
+  }
+}
+
+bool ThreadPool::block_until(const std::function<bool()> &done) {
+  const bool in_pool = current_pool == this;
+  std::unique_lock lock{sleep_mutex};
+  if (in_pool && !stopping) {
+    ++blocked;
+    if (spare_count < blocked) {
+      ++spare_count;
+      spares.remove_if([](const auto &spare) { return spare.second; });
+      auto &spare = spares.emplace_back();
+      spare.first = std::jthread{[this, &retired = spare.second](
+                                     const std::stop_token &stop) {
+        run_spare(stop, retired);
+      }};
+    }
+  }
+
+  wake.wait(lock, [this, &done] { return stopping || done(); });
+  const bool succeeded = !stopping;
+
+  if (in_pool && succeeded) {
+    --blocked;
+    lock.unlock();
+    wake.notify_all(); // Lets an idle spare retire
+  }
+  return succeeded;
+}
@@ -2,10 +2,12 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 
 #include "callable.hpp"
 #include "error.hpp"
 #include "instance.hpp"
+#include "object.hpp"
 
 Token::Token(TokenType _type, std::string _lexeme, Value _value,
              unsigned int _line)
@@ -17,6 +19,108 @@ bool operator!=(const NullType &, const NullType &) { return false; }
 
 std::ostream &operator<<(std::ostream &os, const NullType &) { return os; }
 
+std::string_view lexeme(Token::TokenType type) {
+  using Type = Token::TokenType;
+  switch (type) {
+  case Type::LEFT_PAREN:
+    return "(";
+  case Type::RIGHT_PAREN:
+    return ")";
+  case Type::LEFT_BRACE:
+    return "{";
+  case Type::RIGHT_BRACE:
+    return "}";
+  case Type::LEFT_BRACKET:
+    return "[";
+  case Type::RIGHT_BRACKET:
+    return "]";
+  case Type::COMMA:
+    return ",";
+  case Type::DOT:
+    return ".";
+  case Type::MINUS:
+    return "-";
+  case Type::PLUS:
+    return "+";
+  case Type::SEMICOLON:
+    return ";";
+  case Type::SLASH:
+    return "/";
+  case Type::STAR:
+    return "*";
+  case Type::QUESTION_MARK:
+    return "?";
+  case Type::COLON:
+    return ":";
+  case Type::PIPE:
+    return "|";
+  case Type::BANG:
+    return "!";
+  case Type::BANG_EQUAL:
+    return "!=";
+  case Type::EQUAL:
+    return "=";
+  case Type::EQUAL_EQUAL:
+    return "==";
+  case Type::GREATER:
+    return ">";
+  case Type::GREATER_EQUAL:
+    return ">=";
+  case Type::LESS:
+    return "<";
+  case Type::LESS_EQUAL:
+    return "<=";
+  case Type::AND:
+    return "and";
+  case Type::CLASS:
+    return "class";
+  case Type::ELSE:
+    return "else";
+  case Type::FALSE:
+    return "false";
+  case Type::FUN:
+    return "fun";
+  case Type::FOR:
+    return "for";
+  case Type::IF:
+    return "if";
+  case Type::NIL:
+    return "nil";
+  case Type::OR:
+    return "or";
+  case Type::PRINT:
+    return "print";
+  case Type::RETURN:
+    return "return";
+  case Type::SUPER:
+    return "super";
+  case Type::THIS:
+    return "this";
+  case Type::TRUE:
+    return "true";
+  case Type::VAR:
+    return "var";
+  case Type::WHILE:
+    return "while";
+  case Type::UNBOUND:
+    return "unbound";
+  case Type::IMPORT:
+    return "import";
+  case Type::YIELD:
+    return "yield";
+  case Type::IDENTIFIER:
+  case Type::STRING:
+  case Type::NUMBER:
+  case Type::EOF_:
+    break;
+  }
+  return "";
+}
+
+std::ostream &operator<<(std::ostream &os, const Operator &op) {
+  return os << lexeme(op.type);
+}
+
 std::ostream &operator<<(std::ostream &os, const Token &t) {
   os << static_cast<std::underlying_type<Token::TokenType>::type>(t.type)
      << "\t" << t.lexeme << "\t" << t.value;
@@ -39,13 +143,15 @@ struct StringifyVisitor {
   std::string operator()(NullType) { return "nil"; }
   std::string operator()(const std::string &arg) { return arg; }
   std::string operator()(double num) {
-    if (std::floor(num) == num) {
-      return std::to_string(static_cast<int>(num));
+    // Whole numbers print without decimals, as long as int64_t holds them
+    if (std::floor(num) == num && num >= -0x1p63 && num < 0x1p63) {
+      return std::to_string(static_cast<int64_t>(num));
     }
     return std::to_string(num);
   }
   std::string operator()(const CallablePtr &arg) { return arg->to_string(); }
   std::string operator()(const InstancePtr &arg) { return arg->to_string(); }
+  std::string operator()(const ObjectPtr &arg) { return arg->to_string(); }
 };
 
 std::string stringify(const Token::Value &arg) {
@@ -0,0 +1,216 @@
+#include "value_copier.hpp"
+
+#include "array.hpp"
+#include "class.hpp"
+#include "environment.hpp"
+#include "error.hpp"
+#include "float64_array.hpp"
+#include "function.hpp"
+#include "instance.hpp"
+#include "interpreter.hpp"
+#include "map.hpp"
+#include "module.hpp"
+
+ValueCopier::ValueCopier(const Interpreter &_from, Interpreter &_to,
+                         GlobalScope _globals)
+    : from(_from), to(_to), globals(_globals) {
+  for (const auto &[name, value] : from.builtins->variables) {
+    const auto *builtin = std::get_if<CallablePtr>(&value);
+    const auto target = to.builtins->variables.find(name);
+    if (builtin != nullptr && target != to.builtins->variables.end()) {
+      builtins.emplace(builtin->get(), std::get<CallablePtr>(target->second));
+    }
+  }
+}
+
+Token::Value ValueCopier::copy(const Token::Value &value) {
+  auto copied = copy_shallow(value);
+  copy_pending();
+  return copied;
+}
+
+Token::Value ValueCopier::copy_shallow(const Token::Value &value) {
+  if (const auto *callable = std::get_if<CallablePtr>(&value)) {
+    return copy(*callable);
+  }
+  if (const auto *instance = std::get_if<InstancePtr>(&value)) {
+    return copy(**instance);
+  }
+  if (const auto *object = std::get_if<ObjectPtr>(&value)) {
+    return copy(*object);
+  }
+  return value; // Numbers, strings, booleans and nil
+}
+
+void ValueCopier::copy_pending() {
+  while (!pending_environments.empty() || !pending_instances.empty() ||
+         !pending_arrays.empty() || !pending_maps.empty()) {
+    if (!pending_arrays.empty()) {
+      const auto [original, copied] = pending_arrays.back();
+      pending_arrays.pop_back();
+      copied->elements.reserve(original->elements.size());
+      for (const auto &element : original->elements) {
+        copied->elements.push_back(copy_shallow(element));
+      }
+    } else if (!pending_maps.empty()) {
+      const auto [original, copied] = pending_maps.back();
+      pending_maps.pop_back();
+      // Keys compared by identity are copied too, and keep their identity
+      // within the copy
+      original->for_each(
+          [this, copied](const Token::Value &key, const Token::Value &value) {
+            copied->insert(copy_shallow(key), 0) = copy_shallow(value);
+          });
+    } else if (!pending_environments.empty()) {
+      const auto [original, copied] = pending_environments.back();
+      pending_environments.pop_back();
+      for (const auto &[name, value] : original->variables) {
+        copied->variables.insert_or_assign(name, copy_shallow(value));
+      }
+    } else {
+      const auto [original, copied] = pending_instances.back();
+      pending_instances.pop_back();
+      original->for_each_field(
+          [this, copied](const std::string &name, const Token::Value &value) {
+            copied->restore_field(name, copy_shallow(value));
+          });
+    }
+  }
+}
+
+std::shared_ptr<Environment>
+ValueCopier::copy(const Environment *environment) {
+  if (environment == nullptr) {
+    return nullptr;
+  }
+  if (environment == from.builtins.get()) {
+    return to.builtins;
+  }
+  if (const auto found = environments.find(environment);
+      found != environments.end()) {
+    return found->second;
+  }
+
+  std::shared_ptr<Environment> copied;
+  if (environment == from.globals.get()) {
+    copied = to.globals;
+    environments.emplace(environment, copied);
+    if (globals == GlobalScope::MAP) {
+      return copied;
+    }
+  } else {
+    copied = std::make_shared<Environment>(copy(environment->enclosing.get()));
+    environments.emplace(environment, copied);
+  }
+  pending_environments.emplace_back(environment, copied.get());
+  return copied;
+}
+
+CallablePtr ValueCopier::copy(const CallablePtr &callable) {
+  if (const auto builtin = builtins.find(callable.get());
+      builtin != builtins.end()) {
+    return builtin->second;
+  }
+  if (const auto *function = dynamic_cast<const Function *>(callable.get())) {
+    return copy(*function);
+  }
+  if (const auto *klass = dynamic_cast<const Class *>(callable.get())) {
+    return copy(*klass);
+  }
+  throw RuntimeError("Can't pass " + callable->to_string() +
+                     " to another interpreter");
+}
+
+std::shared_ptr<Function> ValueCopier::copy(const Function &function) {
+  if (const auto found = values.find(&function); found != values.end()) {
+    return std::static_pointer_cast<Function>(
+        std::get<CallablePtr>(found->second));
+  }
+
+  // The global scope is enclosed by the closure, which keeps it alive
+  auto closure = copy(function.closure.get());
+  const auto function_globals = copy(function.globals);
+  auto copied = std::make_shared<Function>(
+      function.declaration, std::move(closure), function.kind, function.unit,
+      function_globals.get());
+  values.emplace(&function, CallablePtr{copied});
+  return copied;
+}
+
+std::shared_ptr<Class> ValueCopier::copy(const Class &klass) {
+  if (const auto found = values.find(&klass); found != values.end()) {
+    return std::static_pointer_cast<Class>(
+        std::get<CallablePtr>(found->second));
+  }
+
+  auto superclass =
+      klass.superclass != nullptr ? copy(*klass.superclass) : nullptr;
+  Class::ClassFunctions functions;
+  auto &[methods, unbounds, getters] = functions;
+  for (const auto &[name, method] : klass.methods) {
+    methods.emplace(name, copy(*method));
+  }
+  for (const auto &[name, unbound] : klass.unbounds) {
+    unbounds.emplace(name, copy(*unbound));
+  }
+  for (const auto &[name, getter] : klass.getters) {
+    getters.emplace(name, copy(*getter));
+  }
+
+  // Subclasses of records get their fields from the superclass
+  auto fields = superclass == nullptr ? klass.fields()
+                                      : std::vector<std::string>{};
+  auto copied =
+      std::make_shared<Class>(klass.name(), std::move(superclass),
+                              std::move(functions), std::move(fields));
+  values.emplace(&klass, CallablePtr{copied});
+  return copied;
+}
+
+InstancePtr ValueCopier::copy(const Instance &instance) {
+  if (const auto found = values.find(&instance); found != values.end()) {
+    return std::get<InstancePtr>(found->second);
+  }
+
+  auto copied = make_instance(copy(*instance.klass));
+  values.emplace(&instance, copied);
+  pending_instances.emplace_back(&instance, copied.get());
+  return copied;
+}
+
+ObjectPtr ValueCopier::copy(const ObjectPtr &object) {
+  if (object->is_shareable()) {
+    return object;
+  }
+  if (const auto found = values.find(object.get()); found != values.end()) {
+    return std::get<ObjectPtr>(found->second);
+  }
+
+  if (const auto *array = dynamic_cast<const Array *>(object.get())) {
+    auto copied = std::make_shared<Array>();
+    values.emplace(object.get(), ObjectPtr{copied});
+    pending_arrays.emplace_back(array, copied.get());
+    return copied;
+  }
+  if (const auto *floats = dynamic_cast<const Float64Array *>(object.get())) {
+    auto copied = std::make_shared<Float64Array>(floats->elements);
+    values.emplace(object.get(), ObjectPtr{copied});
+    return copied;
+  }
+  if (const auto *map = dynamic_cast<const Map *>(object.get())) {
+    auto copied = std::make_shared<Map>();
+    values.emplace(object.get(), ObjectPtr{copied});
+    pending_maps.emplace_back(map, copied.get());
+    return copied;
+  }
+
+  const auto *module = dynamic_cast<const Module *>(object.get());
+  if (module == nullptr) {
+    throw RuntimeError("Can't pass " + object->to_string() +
+                       " to another interpreter");
+  }
+  auto copied = std::make_shared<Module>(module->name, module->unit,
+                                         copy(module->globals.get()));
+  values.emplace(object.get(), ObjectPtr{copied});
+  return copied;
+}